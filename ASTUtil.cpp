@@ -0,0 +1,300 @@
+#include "ASTUtil.h"
+#include <stdexcept>
+
+// 用显式栈后序遍历，子表达式先拷贝到values中，再由父节点取出
+std::unique_ptr<Expression> cloneExpression(const Expression& expr) {
+    std::vector<std::pair<const Expression*, bool>> stack = {{&expr, false}}; // 节点, 子节点是否已拷贝
+    std::vector<std::unique_ptr<Expression>> values;
+    while (!stack.empty()) {
+        auto node = stack.back();
+        stack.pop_back();
+        if (auto lit = dynamic_cast<const IntegerLiteral*>(node.first)) {
+            values.push_back(std::make_unique<IntegerLiteral>(lit->value));
+        } else if (auto var = dynamic_cast<const Variable*>(node.first)) {
+            values.push_back(std::make_unique<Variable>(var->name));
+        } else if (auto op = dynamic_cast<const BinaryOp*>(node.first)) {
+            if (!node.second) {
+                stack.push_back({op, true});
+                stack.push_back({op->right.get(), false});
+                stack.push_back({op->left.get(), false});
+                continue;
+            }
+            auto right = std::move(values.back());
+            values.pop_back();
+            auto left = std::move(values.back());
+            values.pop_back();
+            values.push_back(std::make_unique<BinaryOp>(std::move(left), std::move(right), op->op));
+        } else if (auto call = dynamic_cast<const FunctionCall*>(node.first)) {
+            if (!node.second) {
+                stack.push_back({call, true});
+                for (auto it = call->args.rbegin(); it != call->args.rend(); ++it) {
+                    stack.push_back({it->get(), false});
+                }
+                continue;
+            }
+            std::vector<std::unique_ptr<Expression>> args;
+            for (auto it = values.end() - call->args.size(); it != values.end(); ++it) {
+                args.push_back(std::move(*it));
+            }
+            values.resize(values.size() - call->args.size());
+            auto copy = std::make_unique<FunctionCall>(call->functionName, std::move(args));
+            copy->profileSite = call->profileSite;
+            values.push_back(std::move(copy));
+        } else if (auto inl = dynamic_cast<const InlinedCall*>(node.first)) {
+            auto copy = std::make_unique<InlinedCall>(inl->functionName, cloneBlock(*inl->body));
+            copy->profileSite = inl->profileSite;
+            values.push_back(std::move(copy));
+        } else {
+            throw std::runtime_error("Unknown expression type");
+        }
+    }
+    return std::move(values.back());
+}
+
+std::unique_ptr<Block> cloneBlock(const Block& block) {
+    auto copy = std::make_unique<Block>();
+    for (const auto& stmt : block.statements) {
+        copy->addStatement(cloneStatement(*stmt));
+    }
+    return copy;
+}
+
+std::unique_ptr<Statement> cloneStatement(const Statement& stmt) {
+    if (auto decl = dynamic_cast<const VariableDecl*>(&stmt)) {
+        return std::make_unique<VariableDecl>(
+            decl->type,
+            std::make_unique<Variable>(decl->varName->name),
+            decl->value ? cloneExpression(*decl->value) : nullptr);
+    } else if (auto assign = dynamic_cast<const Assignment*>(&stmt)) {
+        return std::make_unique<Assignment>(
+            std::make_unique<Variable>(assign->varName->name),
+            cloneExpression(*assign->value));
+    } else if (auto ret = dynamic_cast<const ReturnStmt*>(&stmt)) {
+        auto copy = std::make_unique<ReturnStmt>(
+            ret->value ? cloneExpression(*ret->value) : nullptr);
+        copy->tailCall = ret->tailCall;
+        return copy;
+    } else if (auto print = dynamic_cast<const PrintlnIntStmt*>(&stmt)) {
+        return std::make_unique<PrintlnIntStmt>(cloneExpression(*print->arg));
+    } else if (auto exprStmt = dynamic_cast<const ExpressionStatement*>(&stmt)) {
+        return std::make_unique<ExpressionStatement>(cloneExpression(*exprStmt->expr));
+    } else if (auto block = dynamic_cast<const Block*>(&stmt)) {
+        return cloneBlock(*block);
+    } else if (auto cond = dynamic_cast<const ConditionStatement*>(&stmt)) {
+        auto copy = std::make_unique<ConditionStatement>(
+            cloneExpression(*cond->condition),
+            cloneBlock(*cond->thenBlock),
+            cond->elseBlock ? cloneBlock(*cond->elseBlock) : nullptr);
+        copy->profileSite = cond->profileSite;
+        return copy;
+    } else if (auto loop = dynamic_cast<const LoopStatement*>(&stmt)) {
+        auto copy = std::make_unique<LoopStatement>(
+            cloneExpression(*loop->condition), cloneBlock(*loop->body));
+        copy->profileSite = loop->profileSite;
+        return copy;
+    } else if (dynamic_cast<const BreakStmt*>(&stmt)) {
+        return std::make_unique<BreakStmt>();
+    } else if (dynamic_cast<const ContinueStmt*>(&stmt)) {
+        return std::make_unique<ContinueStmt>();
+    } else if (auto inlRet = dynamic_cast<const InlineReturn*>(&stmt)) {
+        return std::make_unique<InlineReturn>(
+            inlRet->value ? cloneExpression(*inlRet->value) : nullptr);
+    }
+    throw std::runtime_error("Unknown statement type");
+}
+
+int countNodes(const Expression& expr) {
+    int n = 0;
+    std::vector<const Expression*> stack = {&expr};
+    while (!stack.empty()) {
+        const Expression* node = stack.back();
+        stack.pop_back();
+        n++;
+        if (auto op = dynamic_cast<const BinaryOp*>(node)) {
+            stack.push_back(op->right.get());
+            stack.push_back(op->left.get());
+        } else if (auto call = dynamic_cast<const FunctionCall*>(node)) {
+            for (const auto& arg : call->args) {
+                stack.push_back(arg.get());
+            }
+        } else if (auto inl = dynamic_cast<const InlinedCall*>(node)) {
+            n += countNodes(*inl->body);
+        }
+    }
+    return n;
+}
+
+int countNodes(const Statement& stmt) {
+    if (auto decl = dynamic_cast<const VariableDecl*>(&stmt)) {
+        return 1 + (decl->value ? countNodes(*decl->value) : 0);
+    } else if (auto assign = dynamic_cast<const Assignment*>(&stmt)) {
+        return 1 + countNodes(*assign->value);
+    } else if (auto ret = dynamic_cast<const ReturnStmt*>(&stmt)) {
+        return 1 + (ret->value ? countNodes(*ret->value) : 0);
+    } else if (auto print = dynamic_cast<const PrintlnIntStmt*>(&stmt)) {
+        return 1 + countNodes(*print->arg);
+    } else if (auto exprStmt = dynamic_cast<const ExpressionStatement*>(&stmt)) {
+        return 1 + countNodes(*exprStmt->expr);
+    } else if (auto block = dynamic_cast<const Block*>(&stmt)) {
+        int n = 0; // 块本身不生成代码，不计数
+        for (const auto& s : block->statements) {
+            n += countNodes(*s);
+        }
+        return n;
+    } else if (auto cond = dynamic_cast<const ConditionStatement*>(&stmt)) {
+        return 1 + countNodes(*cond->condition) + countNodes(*cond->thenBlock) +
+               (cond->elseBlock ? countNodes(*cond->elseBlock) : 0);
+    } else if (auto loop = dynamic_cast<const LoopStatement*>(&stmt)) {
+        return 1 + countNodes(*loop->condition) + countNodes(*loop->body);
+    } else if (auto inlRet = dynamic_cast<const InlineReturn*>(&stmt)) {
+        return 1 + (inlRet->value ? countNodes(*inlRet->value) : 0);
+    }
+    return 1;
+}
+
+// 用显式栈后序遍历：槽位第一次出栈时压回并压入子节点，第二次出栈时调用fn
+void forEachExprSlot(std::unique_ptr<Expression>& slot, const ExprSlotFn& fn) {
+    std::vector<std::pair<std::unique_ptr<Expression>*, bool>> stack = {{&slot, false}}; // 槽位, 子节点是否已访问
+    while (!stack.empty()) {
+        auto node = stack.back();
+        stack.pop_back();
+        if (node.second) {
+            fn(*node.first);
+            continue;
+        }
+        stack.push_back({node.first, true});
+        if (auto op = dynamic_cast<BinaryOp*>(node.first->get())) {
+            stack.push_back({&op->right, false});
+            stack.push_back({&op->left, false});
+        } else if (auto call = dynamic_cast<FunctionCall*>(node.first->get())) {
+            for (auto it = call->args.rbegin(); it != call->args.rend(); ++it) {
+                stack.push_back({&*it, false});
+            }
+        } else if (auto inl = dynamic_cast<InlinedCall*>(node.first->get())) {
+            forEachExprSlot(*inl->body, fn);
+        }
+    }
+}
+
+void forEachExprSlot(Statement& stmt, const ExprSlotFn& fn) {
+    if (auto decl = dynamic_cast<VariableDecl*>(&stmt)) {
+        if (decl->value) forEachExprSlot(decl->value, fn);
+    } else if (auto assign = dynamic_cast<Assignment*>(&stmt)) {
+        forEachExprSlot(assign->value, fn);
+    } else if (auto ret = dynamic_cast<ReturnStmt*>(&stmt)) {
+        if (ret->value) forEachExprSlot(ret->value, fn);
+    } else if (auto print = dynamic_cast<PrintlnIntStmt*>(&stmt)) {
+        forEachExprSlot(print->arg, fn);
+    } else if (auto exprStmt = dynamic_cast<ExpressionStatement*>(&stmt)) {
+        forEachExprSlot(exprStmt->expr, fn);
+    } else if (auto block = dynamic_cast<Block*>(&stmt)) {
+        for (auto& s : block->statements) {
+            forEachExprSlot(*s, fn);
+        }
+    } else if (auto cond = dynamic_cast<ConditionStatement*>(&stmt)) {
+        forEachExprSlot(cond->condition, fn);
+        forEachExprSlot(*cond->thenBlock, fn);
+        if (cond->elseBlock) forEachExprSlot(*cond->elseBlock, fn);
+    } else if (auto loop = dynamic_cast<LoopStatement*>(&stmt)) {
+        forEachExprSlot(loop->condition, fn);
+        forEachExprSlot(*loop->body, fn);
+    } else if (auto inlRet = dynamic_cast<InlineReturn*>(&stmt)) {
+        if (inlRet->value) forEachExprSlot(inlRet->value, fn);
+    }
+}
+
+void renameVariables(Statement& stmt, const RenameFn& rename) {
+    // 先处理声明与赋值目标，再处理表达式中的引用
+    std::function<void(Statement&)> renameTargets = [&](Statement& s) {
+        if (auto decl = dynamic_cast<VariableDecl*>(&s)) {
+            decl->varName->name = rename(decl->varName->name);
+        } else if (auto assign = dynamic_cast<Assignment*>(&s)) {
+            assign->varName->name = rename(assign->varName->name);
+        } else if (auto block = dynamic_cast<Block*>(&s)) {
+            for (auto& child : block->statements) renameTargets(*child);
+        } else if (auto cond = dynamic_cast<ConditionStatement*>(&s)) {
+            renameTargets(*cond->thenBlock);
+            if (cond->elseBlock) renameTargets(*cond->elseBlock);
+        } else if (auto loop = dynamic_cast<LoopStatement*>(&s)) {
+            renameTargets(*loop->body);
+        }
+    };
+    renameTargets(stmt);
+
+    forEachExprSlot(stmt, [&](std::unique_ptr<Expression>& slot) {
+        if (auto var = dynamic_cast<Variable*>(slot.get())) {
+            var->name = rename(var->name);
+        } else if (auto inl = dynamic_cast<InlinedCall*>(slot.get())) {
+            // 内联体内部的表达式已由forEachExprSlot访问，这里补上声明与赋值目标
+            renameTargets(*inl->body);
+        }
+    });
+}
+
+// 用显式栈前序遍历，长链或深嵌套的表达式不会递归很深
+void forEachVariable(const Expression& expr, const VariableFn& fn) {
+    std::vector<const Expression*> stack = {&expr};
+    while (!stack.empty()) {
+        const Expression* node = stack.back();
+        stack.pop_back();
+        if (auto var = dynamic_cast<const Variable*>(node)) {
+            fn(var->name);
+        } else if (auto op = dynamic_cast<const BinaryOp*>(node)) {
+            stack.push_back(op->right.get());
+            stack.push_back(op->left.get());
+        } else if (auto call = dynamic_cast<const FunctionCall*>(node)) {
+            for (auto it = call->args.rbegin(); it != call->args.rend(); ++it) {
+                stack.push_back(it->get());
+            }
+        } else if (auto inl = dynamic_cast<const InlinedCall*>(node)) {
+            forEachVariable(*inl->body, fn);
+        }
+    }
+}
+
+void forEachVariable(const Statement& stmt, const VariableFn& fn) {
+    if (auto decl = dynamic_cast<const VariableDecl*>(&stmt)) {
+        fn(decl->varName->name);
+        if (decl->value) forEachVariable(*decl->value, fn);
+    } else if (auto assign = dynamic_cast<const Assignment*>(&stmt)) {
+        fn(assign->varName->name);
+        forEachVariable(*assign->value, fn);
+    } else if (auto ret = dynamic_cast<const ReturnStmt*>(&stmt)) {
+        if (ret->value) forEachVariable(*ret->value, fn);
+    } else if (auto print = dynamic_cast<const PrintlnIntStmt*>(&stmt)) {
+        forEachVariable(*print->arg, fn);
+    } else if (auto exprStmt = dynamic_cast<const ExpressionStatement*>(&stmt)) {
+        forEachVariable(*exprStmt->expr, fn);
+    } else if (auto block = dynamic_cast<const Block*>(&stmt)) {
+        for (const auto& s : block->statements) {
+            forEachVariable(*s, fn);
+        }
+    } else if (auto cond = dynamic_cast<const ConditionStatement*>(&stmt)) {
+        forEachVariable(*cond->condition, fn);
+        forEachVariable(*cond->thenBlock, fn);
+        if (cond->elseBlock) forEachVariable(*cond->elseBlock, fn);
+    } else if (auto loop = dynamic_cast<const LoopStatement*>(&stmt)) {
+        forEachVariable(*loop->condition, fn);
+        forEachVariable(*loop->body, fn);
+    } else if (auto inlRet = dynamic_cast<const InlineReturn*>(&stmt)) {
+        if (inlRet->value) forEachVariable(*inlRet->value, fn);
+    }
+}
+
+void forEachStatement(Statement& stmt, const StatementFn& fn) {
+    fn(stmt);
+    if (auto block = dynamic_cast<Block*>(&stmt)) {
+        for (auto& s : block->statements) {
+            forEachStatement(*s, fn);
+        }
+    } else if (auto cond = dynamic_cast<ConditionStatement*>(&stmt)) {
+        forEachStatement(*cond->thenBlock, fn);
+        if (cond->elseBlock) forEachStatement(*cond->elseBlock, fn);
+    } else if (auto loop = dynamic_cast<LoopStatement*>(&stmt)) {
+        forEachStatement(*loop->body, fn);
+    }
+}
+
+void forEachStatement(const Statement& stmt, const ConstStatementFn& fn) {
+    forEachStatement(const_cast<Statement&>(stmt), [&](Statement& s) { fn(s); });
+}
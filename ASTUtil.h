@@ -0,0 +1,38 @@
+#ifndef ASTUTIL_H
+#define ASTUTIL_H
+
+#include "Parser.h"
+#include <functional>
+
+/* AST通用工具：深拷贝、节点计数、遍历与改写，供各优化遍使用 */
+
+// 深拷贝
+std::unique_ptr<Expression> cloneExpression(const Expression& expr);
+std::unique_ptr<Statement> cloneStatement(const Statement& stmt);
+std::unique_ptr<Block> cloneBlock(const Block& block);
+
+// 统计节点个数（内联代价模型等使用）
+int countNodes(const Expression& expr);
+int countNodes(const Statement& stmt);
+
+// 后序遍历语句中的每个表达式槽位，回调可以原地替换表达式
+using ExprSlotFn = std::function<void(std::unique_ptr<Expression>&)>;
+void forEachExprSlot(Statement& stmt, const ExprSlotFn& fn);
+void forEachExprSlot(std::unique_ptr<Expression>& slot, const ExprSlotFn& fn);
+
+// 重命名语句中出现的所有变量（声明、赋值目标、引用）
+using RenameFn = std::function<std::string(const std::string&)>;
+void renameVariables(Statement& stmt, const RenameFn& rename);
+
+// 前序遍历语句树（不进入表达式内部的内联体）
+using StatementFn = std::function<void(Statement&)>;
+using ConstStatementFn = std::function<void(const Statement&)>;
+void forEachStatement(Statement& stmt, const StatementFn& fn);
+void forEachStatement(const Statement& stmt, const ConstStatementFn& fn);
+
+// 按源码顺序访问出现的每个变量名（只读）
+using VariableFn = std::function<void(const std::string&)>;
+void forEachVariable(const Expression& expr, const VariableFn& fn);
+void forEachVariable(const Statement& stmt, const VariableFn& fn);
+
+#endif // ASTUTIL_H
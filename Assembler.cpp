@@ -0,0 +1,461 @@
+#include "Assembler.h"
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+namespace {
+
+struct RegisterInfo {
+    int number;
+    int size;
+};
+
+const std::unordered_map<std::string, RegisterInfo>& registerTable() {
+    static const std::unordered_map<std::string, RegisterInfo> table = {
+        {"al", {0, 8}},
+        {"eax", {0, 32}}, {"ecx", {1, 32}}, {"edx", {2, 32}}, {"ebx", {3, 32}},
+        {"esp", {4, 32}}, {"ebp", {5, 32}}, {"esi", {6, 32}}, {"edi", {7, 32}},
+        {"r8d", {8, 32}}, {"r9d", {9, 32}}, {"r10d", {10, 32}}, {"r11d", {11, 32}},
+        {"r12d", {12, 32}}, {"r13d", {13, 32}}, {"r14d", {14, 32}}, {"r15d", {15, 32}},
+        {"rax", {0, 64}}, {"rcx", {1, 64}}, {"rdx", {2, 64}}, {"rbx", {3, 64}},
+        {"rsp", {4, 64}}, {"rbp", {5, 64}}, {"rsi", {6, 64}}, {"rdi", {7, 64}},
+        {"r8", {8, 64}}, {"r9", {9, 64}}, {"r10", {10, 64}}, {"r11", {11, 64}},
+        {"r12", {12, 64}}, {"r13", {13, 64}}, {"r14", {14, 64}}, {"r15", {15, 64}},
+    };
+    return table;
+}
+
+// setcc/jcc的条件码
+const std::unordered_map<std::string, int>& conditionCodes() {
+    static const std::unordered_map<std::string, int> codes = {
+        {"e", 0x4}, {"z", 0x4}, {"ne", 0x5}, {"nz", 0x5},
+        {"l", 0xC}, {"ge", 0xD}, {"le", 0xE}, {"g", 0xF},
+        {"b", 0x2}, {"ae", 0x3}, // 无符号比较（记忆化表的范围检查）
+    };
+    return codes;
+}
+
+// add/or/and/sub/xor/cmp 在 0x80~0x83 组中的 /digit
+const std::unordered_map<std::string, int>& aluGroups() {
+    static const std::unordered_map<std::string, int> groups = {
+        {"add", 0}, {"or", 1}, {"adc", 2}, {"and", 4}, {"sub", 5}, {"xor", 6}, {"cmp", 7},
+    };
+    return groups;
+}
+
+std::string trim(const std::string& s) {
+    size_t begin = s.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) return "";
+    size_t end = s.find_last_not_of(" \t\r");
+    return s.substr(begin, end - begin + 1);
+}
+
+bool startsWith(const std::string& s, const std::string& prefix) {
+    return s.compare(0, prefix.size(), prefix) == 0;
+}
+
+bool fitsInt8(int64_t value) {
+    return value >= -128 && value <= 127;
+}
+
+bool isIdentifier(const std::string& s) {
+    if (s.empty()) return false;
+    for (char c : s) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '.' && c != '@') return false;
+    }
+    return true;
+}
+
+} // namespace
+
+Assembler::Assembler(bool x64) : x64_(x64) {}
+
+bool Assembler::isGlobal(const std::string& name) const {
+    return std::find(globals_.begin(), globals_.end(), name) != globals_.end();
+}
+
+void Assembler::addLine(const std::string& rawLine) {
+    std::string line = trim(rawLine);
+    if (line.empty()) return;
+
+    // 行首的标签，例如 "main:" 或 "format_str: .asciz ..."
+    size_t colon = line.find(':');
+    if (colon != std::string::npos && isIdentifier(line.substr(0, colon))) {
+        defineLabel(line.substr(0, colon));
+        line = trim(line.substr(colon + 1));
+        if (line.empty()) return;
+    }
+
+    size_t space = line.find_first_of(" \t");
+    std::string name = line.substr(0, space);
+    std::string rest = space == std::string::npos ? "" : trim(line.substr(space));
+
+    if (name[0] == '.') {
+        directive(name, rest);
+        return;
+    }
+
+    std::vector<Operand> ops;
+    size_t begin = 0;
+    while (!rest.empty() && begin <= rest.size()) {
+        size_t comma = rest.find(',', begin);
+        std::string text = rest.substr(begin, comma == std::string::npos ? std::string::npos : comma - begin);
+        ops.push_back(parseOperand(trim(text)));
+        if (comma == std::string::npos) break;
+        begin = comma + 1;
+    }
+
+    if (section_ != Section::Text) {
+        throw std::runtime_error("Assembler: instruction outside .text: " + rawLine);
+    }
+    instruction_start_ = text_.size();
+    rip_fixup_ = -1;
+    instruction(name, ops, rawLine);
+    // rip相对位移以指令末尾为基准，指令后面可能还有立即数
+    if (rip_fixup_ >= 0) {
+        Relocation& fixup = fixups_[rip_fixup_];
+        fixup.addend += static_cast<int32_t>(fixup.offset) - static_cast<int32_t>(text_.size());
+    }
+}
+
+void Assembler::directive(const std::string& name, const std::string& args) {
+    if (name == ".text") {
+        section_ = Section::Text;
+    } else if (name == ".data") {
+        section_ = Section::Data;
+    } else if (name == ".section") {
+        // 只认识.text/.data，其余（如.note.GNU-stack）由ObjectWriter固定生成
+        if (startsWith(args, ".text")) section_ = Section::Text;
+        else if (startsWith(args, ".data")) section_ = Section::Data;
+    } else if (name == ".global" || name == ".globl") {
+        globals_.push_back(args);
+    } else if (name == ".intel_syntax" || name == ".extern") {
+        // 外部符号在引用时自动成为未定义符号
+    } else if (name == ".asciz" || name == ".string") {
+        if (args.size() < 2 || args.front() != '"' || args.back() != '"') {
+            throw std::runtime_error("Assembler: bad string literal: " + args);
+        }
+        for (size_t i = 1; i + 1 < args.size(); ++i) {
+            char c = args[i];
+            if (c == '\\' && i + 2 < args.size()) {
+                char next = args[++i];
+                c = next == 'n' ? '\n' : next == 't' ? '\t' : next == '0' ? '\0' : next;
+            }
+            byte(static_cast<uint8_t>(c));
+        }
+        byte(0);
+    } else if (name == ".zero") {
+        out().resize(out().size() + static_cast<size_t>(std::stoll(args)), 0);
+    } else if (name == ".p2align") {
+        size_t alignment = size_t(1) << std::stoi(args);
+        uint8_t fill = section_ == Section::Text ? 0x90 : 0x00; // 代码用nop填充
+        while (out().size() % alignment != 0) byte(fill);
+    } else {
+        throw std::runtime_error("Assembler: unsupported directive: " + name);
+    }
+}
+
+Assembler::Operand Assembler::parseOperand(const std::string& text) const {
+    Operand op;
+    std::string s = text;
+    if (startsWith(s, "DWORD PTR ")) {
+        op.size = 32;
+        s = trim(s.substr(10));
+    } else if (startsWith(s, "QWORD PTR ")) {
+        op.size = 64;
+        s = trim(s.substr(10));
+    } else if (startsWith(s, "BYTE PTR ")) {
+        op.size = 8;
+        s = trim(s.substr(9));
+    }
+
+    if (!s.empty() && s[0] == '[') {
+        // [base], [base+disp], [base-disp], [rip+symbol], [rip+symbol+disp]，32位时还有[symbol+disp]
+        op.kind = Operand::Mem;
+        std::string inner = s.substr(1, s.find(']') - 1);
+        size_t sign = inner.find_first_of("+-");
+        std::string base = trim(inner.substr(0, sign));
+        std::string disp = sign == std::string::npos ? "" : trim(inner.substr(sign + 1));
+        if (base == "rip") {
+            op.rip = true;
+            size_t plus = disp.find('+');
+            op.symbol = trim(disp.substr(0, plus));
+            if (plus != std::string::npos) op.value = std::stoll(trim(disp.substr(plus + 1)));
+        } else if (!x64_ && !registerTable().count(base) && isIdentifier(base)) {
+            op.absolute = true;
+            op.symbol = base;
+            if (!disp.empty()) {
+                op.value = std::stoll(disp);
+                if (inner[sign] == '-') op.value = -op.value;
+            }
+        } else {
+            auto reg = registerTable().find(base);
+            if (reg == registerTable().end() || reg->second.size < 32) {
+                throw std::runtime_error("Assembler: bad base register: " + text);
+            }
+            op.reg = reg->second.number;
+            if (!disp.empty()) {
+                op.value = std::stoll(disp);
+                if (inner[sign] == '-') op.value = -op.value;
+            }
+        }
+        return op;
+    }
+
+    auto reg = registerTable().find(s);
+    if (reg != registerTable().end()) {
+        op.kind = Operand::Reg;
+        op.reg = reg->second.number;
+        op.size = reg->second.size;
+    } else if (!s.empty() && (std::isdigit(static_cast<unsigned char>(s[0])) || s[0] == '-')) {
+        op.kind = Operand::Imm;
+        op.value = std::stoll(s);
+    } else if (startsWith(s, "offset ")) {
+        op.kind = Operand::Sym;
+        op.offset = true;
+        op.symbol = trim(s.substr(7));
+    } else {
+        op.kind = Operand::Sym;
+        op.symbol = s.substr(0, s.find('@')); // printf@PLT -> printf
+    }
+    return op;
+}
+
+void Assembler::instruction(const std::string& mnemonic, const std::vector<Operand>& ops, const std::string& line) {
+    auto expect = [&](size_t count) {
+        if (ops.size() != count) throw std::runtime_error("Assembler: wrong operand count: " + line);
+    };
+    auto wide = [](const Operand& op) { return op.size == 64; };
+
+    if (mnemonic == "mov") {
+        expect(2);
+        const Operand& dst = ops[0];
+        const Operand& src = ops[1];
+        if (dst.kind == Operand::Reg && src.kind == Operand::Reg) {
+            if (dst.size != src.size) throw std::runtime_error("Assembler: operand size mismatch: " + line);
+            encodeRM({0x89}, src.reg, dst, wide(dst));
+        } else if (dst.kind == Operand::Reg && src.kind == Operand::Imm) {
+            if (wide(dst)) {
+                encodeRM({0xC7}, 0, dst, true);
+            } else {
+                rex(false, 0, dst.reg);
+                byte(static_cast<uint8_t>(0xB8 + (dst.reg & 7)));
+            }
+            imm32(src.value);
+        } else if (dst.kind == Operand::Reg && src.kind == Operand::Sym && src.offset && !x64_) {
+            byte(static_cast<uint8_t>(0xB8 + (dst.reg & 7)));
+            fixups_.push_back({static_cast<uint32_t>(text_.size()), src.symbol, Relocation::Abs32, 0});
+            imm32(0);
+        } else if (dst.kind == Operand::Reg && src.kind == Operand::Mem) {
+            encodeRM({0x8B}, dst.reg, src, wide(dst));
+        } else if (dst.kind == Operand::Mem && src.kind == Operand::Reg) {
+            encodeRM({0x89}, src.reg, dst, wide(src));
+        } else if (dst.kind == Operand::Mem && src.kind == Operand::Imm) {
+            encodeRM({0xC7}, 0, dst, wide(dst));
+            imm32(src.value);
+        } else {
+            throw std::runtime_error("Assembler: unsupported operands: " + line);
+        }
+    } else if (mnemonic == "push" || mnemonic == "pop") {
+        expect(1);
+        const Operand& op = ops[0];
+        bool push = mnemonic == "push";
+        if (op.kind == Operand::Reg) {
+            if (op.size != (x64_ ? 64 : 32)) throw std::runtime_error("Assembler: bad stack operand size: " + line);
+            rex(false, 0, op.reg);
+            byte(static_cast<uint8_t>((push ? 0x50 : 0x58) + (op.reg & 7)));
+        } else if (push && op.kind == Operand::Imm) {
+            if (fitsInt8(op.value)) {
+                byte(0x6A);
+                byte(static_cast<uint8_t>(op.value));
+            } else {
+                byte(0x68);
+                imm32(op.value);
+            }
+        } else if (push && op.kind == Operand::Sym && op.offset && !x64_) {
+            byte(0x68);
+            fixups_.push_back({static_cast<uint32_t>(text_.size()), op.symbol, Relocation::Abs32, 0});
+            imm32(0);
+        } else {
+            throw std::runtime_error("Assembler: unsupported operands: " + line);
+        }
+    } else if (aluGroups().count(mnemonic)) {
+        expect(2);
+        encodeAlu(aluGroups().at(mnemonic), ops[0], ops[1], line);
+    } else if (mnemonic == "imul") {
+        expect(2);
+        const Operand& dst = ops[0];
+        const Operand& src = ops[1];
+        if (dst.kind != Operand::Reg) throw std::runtime_error("Assembler: unsupported operands: " + line);
+        if (src.kind == Operand::Imm) {
+            bool short8 = fitsInt8(src.value);
+            encodeRM({static_cast<uint8_t>(short8 ? 0x6B : 0x69)}, dst.reg, dst, wide(dst));
+            if (short8) byte(static_cast<uint8_t>(src.value));
+            else imm32(src.value);
+        } else {
+            encodeRM({0x0F, 0xAF}, dst.reg, src, wide(dst));
+        }
+    } else if (mnemonic == "idiv") {
+        expect(1);
+        encodeRM({0xF7}, 7, ops[0], wide(ops[0]));
+    } else if (mnemonic == "lea") {
+        expect(2);
+        if (ops[0].kind != Operand::Reg || ops[1].kind != Operand::Mem) {
+            throw std::runtime_error("Assembler: unsupported operands: " + line);
+        }
+        encodeRM({0x8D}, ops[0].reg, ops[1], wide(ops[0]));
+    } else if (mnemonic == "movzx") {
+        expect(2);
+        if (ops[0].kind != Operand::Reg || ops[1].size != 8) {
+            throw std::runtime_error("Assembler: unsupported operands: " + line);
+        }
+        encodeRM({0x0F, 0xB6}, ops[0].reg, ops[1], wide(ops[0]));
+    } else if (startsWith(mnemonic, "set") && conditionCodes().count(mnemonic.substr(3))) {
+        expect(1);
+        if (ops[0].size != 8) throw std::runtime_error("Assembler: setcc needs a byte operand: " + line);
+        encodeRM({0x0F, static_cast<uint8_t>(0x90 + conditionCodes().at(mnemonic.substr(3)))}, 0, ops[0], false);
+    } else if (mnemonic == "jmp" || mnemonic == "call") {
+        expect(1);
+        if (ops[0].kind != Operand::Sym) throw std::runtime_error("Assembler: unsupported operands: " + line);
+        encodeBranch({static_cast<uint8_t>(mnemonic == "jmp" ? 0xE9 : 0xE8)}, ops[0].symbol);
+    } else if (mnemonic[0] == 'j' && conditionCodes().count(mnemonic.substr(1))) {
+        expect(1);
+        if (ops[0].kind != Operand::Sym) throw std::runtime_error("Assembler: unsupported operands: " + line);
+        encodeBranch({0x0F, static_cast<uint8_t>(0x80 + conditionCodes().at(mnemonic.substr(1)))}, ops[0].symbol);
+    } else if (mnemonic == "cdq") {
+        byte(0x99);
+    } else if (mnemonic == "leave") {
+        byte(0xC9);
+    } else if (mnemonic == "ret") {
+        byte(0xC3);
+    } else if (mnemonic == "nop") {
+        byte(0x90);
+    } else {
+        throw std::runtime_error("Assembler: unsupported instruction: " + line);
+    }
+}
+
+void Assembler::encodeAlu(int group, const Operand& dst, const Operand& src, const std::string& line) {
+    bool wide = dst.size == 64;
+    uint8_t base = static_cast<uint8_t>(group * 8);
+    if (src.kind == Operand::Imm && (dst.kind == Operand::Reg || dst.kind == Operand::Mem)) {
+        if (fitsInt8(src.value)) {
+            encodeRM({0x83}, group, dst, wide);
+            byte(static_cast<uint8_t>(src.value));
+        } else {
+            encodeRM({0x81}, group, dst, wide);
+            imm32(src.value);
+        }
+    } else if (src.kind == Operand::Reg && (dst.kind == Operand::Reg || dst.kind == Operand::Mem)) {
+        if (dst.kind == Operand::Reg && dst.size != src.size) {
+            throw std::runtime_error("Assembler: operand size mismatch: " + line);
+        }
+        encodeRM({static_cast<uint8_t>(base + 1)}, src.reg, dst, src.size == 64);
+    } else if (dst.kind == Operand::Reg && src.kind == Operand::Mem) {
+        encodeRM({static_cast<uint8_t>(base + 3)}, dst.reg, src, wide);
+    } else {
+        throw std::runtime_error("Assembler: unsupported operands: " + line);
+    }
+}
+
+void Assembler::imm32(int64_t value) {
+    uint32_t v = static_cast<uint32_t>(value);
+    for (int i = 0; i < 4; ++i) {
+        byte(static_cast<uint8_t>(v >> (8 * i)));
+    }
+}
+
+/**
+ * @brief x86-64下按需输出REX前缀
+ * @param wide 64位操作数（REX.W）
+ * @param reg ModRM.reg字段的寄存器编号（REX.R）
+ * @param rm ModRM.rm字段或opcode中的寄存器编号（REX.B）
+ */
+void Assembler::rex(bool wide, int reg, int rm) {
+    bool extended = reg >= 8 || rm >= 8;
+    if (!x64_) {
+        if (wide || extended) throw std::runtime_error("Assembler: 64-bit register in 32-bit code");
+        return;
+    }
+    uint8_t prefix = static_cast<uint8_t>(0x40 | (wide ? 8 : 0) | (reg >= 8 ? 4 : 0) | (rm >= 8 ? 1 : 0));
+    if (prefix != 0x40) byte(prefix);
+}
+
+void Assembler::modrm(int regField, const Operand& rm) {
+    uint8_t reg = static_cast<uint8_t>((regField & 7) << 3);
+    if (rm.kind == Operand::Reg) {
+        byte(static_cast<uint8_t>(0xC0 | reg | (rm.reg & 7)));
+        return;
+    }
+    if (rm.rip) {
+        // [rip+disp32]，位移在指令结束后修正
+        byte(static_cast<uint8_t>(0x05 | reg));
+        rip_fixup_ = static_cast<int>(fixups_.size());
+        fixups_.push_back({static_cast<uint32_t>(text_.size()), rm.symbol, Relocation::Rel32,
+                           static_cast<int32_t>(rm.value)});
+        imm32(0);
+        return;
+    }
+    if (rm.absolute) {
+        // 32位的[disp32]：mod=00，rm=101
+        byte(static_cast<uint8_t>(0x05 | reg));
+        fixups_.push_back({static_cast<uint32_t>(text_.size()), rm.symbol, Relocation::Abs32,
+                           static_cast<int32_t>(rm.value)});
+        imm32(0);
+        return;
+    }
+
+    int base = rm.reg & 7;
+    int mod = rm.value == 0 && base != 5 ? 0 : fitsInt8(rm.value) ? 1 : 2; // [ebp]必须带位移
+    byte(static_cast<uint8_t>((mod << 6) | reg | base));
+    if (base == 4) {
+        byte(0x24); // esp/r12作基址需要SIB
+    }
+    if (mod == 1) {
+        byte(static_cast<uint8_t>(rm.value));
+    } else if (mod == 2) {
+        imm32(rm.value);
+    }
+}
+
+void Assembler::encodeRM(const std::vector<uint8_t>& opcode, int regField, const Operand& rm, bool wide) {
+    if (rm.kind != Operand::Reg && rm.kind != Operand::Mem) {
+        throw std::runtime_error("Assembler: expected register or memory operand");
+    }
+    rex(wide, regField, rm.kind == Operand::Reg || !(rm.rip || rm.absolute) ? rm.reg : 0);
+    for (uint8_t b : opcode) byte(b);
+    modrm(regField, rm);
+}
+
+void Assembler::encodeBranch(const std::vector<uint8_t>& opcode, const std::string& target) {
+    for (uint8_t b : opcode) byte(b);
+    fixups_.push_back({static_cast<uint32_t>(text_.size()), target, Relocation::Rel32, -4});
+    imm32(0);
+}
+
+void Assembler::defineLabel(const std::string& name) {
+    if (symbols_.count(name)) {
+        throw std::runtime_error("Assembler: duplicate label: " + name);
+    }
+    symbols_[name] = {section_, static_cast<uint32_t>(out().size())};
+    symbol_order_.push_back(name);
+}
+
+/**
+ * @brief 回填.text内的跳转和调用，其余引用留作重定位
+ */
+void Assembler::finish() {
+    relocations_.clear();
+    for (const auto& fixup : fixups_) {
+        auto it = symbols_.find(fixup.symbol);
+        if (it != symbols_.end() && it->second.section == Section::Text && fixup.kind == Relocation::Rel32) {
+            int32_t value = static_cast<int32_t>(it->second.offset) + fixup.addend - static_cast<int32_t>(fixup.offset);
+            for (int i = 0; i < 4; ++i) {
+                text_[fixup.offset + i] = static_cast<uint8_t>(static_cast<uint32_t>(value) >> (8 * i));
+            }
+        } else {
+            relocations_.push_back(fixup);
+        }
+    }
+    fixups_.clear();
+}
@@ -0,0 +1,91 @@
+#ifndef ASSEMBLER_H
+#define ASSEMBLER_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * 内置汇编器
+ * 逐行接收CodeGen/CodeGenX64输出的Intel语法汇编，直接编码为机器码，
+ * 只支持代码生成器用到的指令子集：
+ *   mov push pop add adc sub imul idiv cdq cmp setcc movzx and or xor lea jmp jcc call leave ret
+ * 以及 .text/.data/.asciz/.zero/.p2align 等伪指令。
+ * 同一节内的标签在 finish() 中回填，其余引用（printf、format_str）保留为重定位项，
+ * 由 ObjectWriter 写成ELF重定位，或由JIT直接解析。
+ */
+class Assembler {
+public:
+    enum class Section { Text, Data };
+
+    struct Symbol {
+        Section section;
+        uint32_t offset;
+    };
+
+    struct Relocation {
+        enum Kind {
+            Rel32, // S + A - P，用于call/jmp和rip相对寻址
+            Abs32  // S + A，用于32位的 offset sym
+        };
+        uint32_t offset; // 在.text中的位置
+        std::string symbol;
+        Kind kind;
+        int32_t addend;
+    };
+
+    explicit Assembler(bool x64);
+
+    void addLine(const std::string& line);
+    void finish();
+
+    bool isX64() const { return x64_; }
+    const std::vector<uint8_t>& text() const { return text_; }
+    const std::vector<uint8_t>& data() const { return data_; }
+    const std::vector<Relocation>& relocations() const { return relocations_; }
+    const std::vector<std::string>& symbolOrder() const { return symbol_order_; } // 按定义顺序
+    const std::unordered_map<std::string, Symbol>& symbols() const { return symbols_; }
+    bool isGlobal(const std::string& name) const;
+
+private:
+    struct Operand {
+        enum Kind { None, Reg, Mem, Imm, Sym } kind = None;
+        int reg = -1;     // Reg: 寄存器编号；Mem: 基址寄存器编号
+        int size = 0;     // 8/32/64
+        bool rip = false; // [rip+symbol]
+        bool absolute = false; // 32位的[symbol]
+        bool offset = false; // offset symbol（32位绝对地址）
+        int64_t value = 0;   // 立即数或位移
+        std::string symbol;
+    };
+
+    bool x64_;
+    Section section_ = Section::Text;
+    std::vector<uint8_t> text_;
+    std::vector<uint8_t> data_;
+    std::unordered_map<std::string, Symbol> symbols_;
+    std::vector<std::string> symbol_order_;
+    std::vector<std::string> globals_;
+    std::vector<Relocation> fixups_;      // 等待回填的引用
+    std::vector<Relocation> relocations_; // finish()后仍无法解析的引用
+    size_t instruction_start_ = 0;
+    int rip_fixup_ = -1; // 当前指令中rip相对引用在fixups_中的下标
+
+    void directive(const std::string& name, const std::string& args);
+    void instruction(const std::string& mnemonic, const std::vector<Operand>& ops, const std::string& line);
+    Operand parseOperand(const std::string& text) const;
+
+    // 编码
+    std::vector<uint8_t>& out() { return section_ == Section::Text ? text_ : data_; }
+    void byte(uint8_t b) { out().push_back(b); }
+    void imm32(int64_t value);
+    void rex(bool wide, int reg, int rm);
+    void modrm(int regField, const Operand& rm);
+    void encodeRM(const std::vector<uint8_t>& opcode, int regField, const Operand& rm, bool wide);
+    void encodeBranch(const std::vector<uint8_t>& opcode, const std::string& target);
+    void encodeAlu(int group, const Operand& dst, const Operand& src, const std::string& line);
+    void defineLabel(const std::string& name);
+};
+
+#endif // ASSEMBLER_H
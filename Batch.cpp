@@ -0,0 +1,130 @@
+#include "Batch.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+void fail(BatchResult& result, const std::string& message) {
+    Diagnostic diagnostic;
+    diagnostic.message = message;
+    result.diagnostics.push_back(diagnostic);
+}
+
+std::string trimLine(const std::string& line) {
+    size_t begin = line.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) return "";
+    size_t end = line.find_last_not_of(" \t\r");
+    return line.substr(begin, end - begin + 1);
+}
+
+// 输出文件名：去掉目录和扩展名，换成.s或.o
+std::string outputPathOf(const std::string& input, const std::string& outputDir, bool object) {
+    std::string name = input;
+    size_t slash = name.find_last_of("/\\");
+    if (slash != std::string::npos) name.erase(0, slash + 1);
+    size_t dot = name.find_last_of('.');
+    if (dot != std::string::npos && dot > 0) name.erase(dot);
+    return outputDir + "/" + name + (object ? ".o" : ".s");
+}
+
+void compileOne(BatchResult& result, const DriverOptions& sharedOptions) {
+    std::ifstream inputFile(result.input, std::ios::binary);
+    if (!inputFile.is_open()) {
+        fail(result, "could not open file");
+        return;
+    }
+    std::string source((std::istreambuf_iterator<char>(inputFile)), std::istreambuf_iterator<char>());
+
+    DriverOptions options = sharedOptions;
+    std::ostringstream report;
+    if (options.inlineReport) {
+        options.inlineReport = &report;
+    }
+    if (options.passReport) {
+        options.passReport = &report;
+    }
+    if (options.stats) {
+        options.stats = &result.stats;
+    }
+
+    // 先在内存中生成，编译失败时不留下不完整的输出文件
+    CompileResult compiled = compile(source, options);
+    result.report = report.str();
+    if (!compiled.ok) {
+        result.diagnostics = std::move(compiled.diagnostics);
+        return;
+    }
+
+    std::ofstream outputFile(result.output, std::ios::binary);
+    outputFile << compiled.output;
+    result.ok = static_cast<bool>(outputFile);
+    if (!result.ok) {
+        fail(result, "could not write " + result.output);
+    }
+}
+
+} // namespace
+
+std::vector<std::string> expandInputs(const std::vector<std::string>& args) {
+    std::vector<std::string> inputs;
+    for (const auto& arg : args) {
+        if (arg.empty() || arg[0] != '@') {
+            inputs.push_back(arg);
+            continue;
+        }
+        std::ifstream list(arg.substr(1));
+        if (!list.is_open()) {
+            throw std::runtime_error("could not open list file " + arg.substr(1));
+        }
+        std::string line;
+        while (std::getline(list, line)) {
+            line = trimLine(line);
+            if (!line.empty()) inputs.push_back(line);
+        }
+    }
+    return inputs;
+}
+
+std::vector<BatchResult> compileBatch(const std::vector<std::string>& inputs, const std::string& outputDir,
+                                      const DriverOptions& options, unsigned threads) {
+#ifdef _WIN32
+    _mkdir(outputDir.c_str());
+#else
+    mkdir(outputDir.c_str(), 0755);
+#endif
+
+    // 输出路径在提交任务前确定：重名的文件只有第一个会被编译，结果与调度顺序无关
+    std::vector<BatchResult> results(inputs.size());
+    std::unordered_map<std::string, size_t> owners;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        results[i].input = inputs[i];
+        results[i].output = outputPathOf(inputs[i], outputDir, options.emitObject);
+        auto inserted = owners.emplace(results[i].output, i);
+        if (!inserted.second) {
+            fail(results[i], "output " + results[i].output + " is also produced by " + inputs[inserted.first->second]);
+        }
+    }
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned>(std::min<size_t>(threads, std::max<size_t>(1, inputs.size())));
+    ThreadPool pool(threads);
+    for (auto& result : results) {
+        if (!result.diagnostics.empty()) continue;
+        BatchResult* slot = &result;
+        pool.submit([slot, &options] { compileOne(*slot, options); });
+    }
+    pool.wait();
+    return results;
+}
@@ -0,0 +1,30 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "Compiler.h"
+#include "Stats.h"
+#include <string>
+#include <vector>
+
+/*
+ * 批量编译
+ * 在一个进程中用线程池编译多个源文件，输出到同一个目录（<目录>/<文件名>.s 或 .o）。
+ * 每个文件独立编译，一个文件出错不影响其他文件；结果按输入顺序返回，与线程调度无关。
+ */
+struct BatchResult {
+    std::string input;
+    std::string output;  // 输出文件路径
+    bool ok = false;
+    std::vector<Diagnostic> diagnostics; // 失败原因
+    std::string report;  // --inline-report 的输出（按文件缓冲，避免多线程交错）
+    CompileStats stats;  // options.stats不为空时这个文件的统计（不会写入options.stats）
+};
+
+// 展开 @listfile（每行一个源文件路径，忽略空行），其他参数原样保留；列表文件打不开时抛出runtime_error
+std::vector<std::string> expandInputs(const std::vector<std::string>& args);
+
+// threads为0时使用硬件线程数
+std::vector<BatchResult> compileBatch(const std::vector<std::string>& inputs, const std::string& outputDir,
+                                      const DriverOptions& options, unsigned threads = 0);
+
+#endif // BATCH_H
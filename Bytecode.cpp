@@ -0,0 +1,335 @@
+#include "Bytecode.h"
+#include "ASTUtil.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+struct OpInfo {
+    const char* mnemonic;
+    int operands;
+};
+
+const OpInfo kOpInfo[] = {
+#define BYTECODE_INFO(name, mnemonic, operands) {mnemonic, operands},
+    BYTECODE_OPS(BYTECODE_INFO)
+#undef BYTECODE_INFO
+};
+
+const std::unordered_map<std::string, Op>& binaryOps() {
+    static const std::unordered_map<std::string, Op> ops = {
+        {"+", Op::Add}, {"-", Op::Sub}, {"*", Op::Mul}, {"/", Op::Div}, {"%", Op::Mod},
+        {"&", Op::And}, {"&&", Op::And}, {"|", Op::Or}, {"||", Op::Or}, {"^", Op::Xor},
+        {"==", Op::Eq}, {"!=", Op::Ne}, {"<", Op::Lt}, {"<=", Op::Le}, {">", Op::Gt}, {">=", Op::Ge},
+    };
+    return ops;
+}
+
+} // namespace
+
+void BytecodeProgram::disassemble(std::ostream& out) const {
+    size_t next = 0;
+    for (size_t pc = 0; pc < code.size();) {
+        if (next < functions.size() && functions[next].entry == pc) {
+            const auto& func = functions[next++];
+            out << func.name << ": ; params=" << func.numParams << " registers=" << func.numRegisters << '\n';
+        }
+        const OpInfo& info = kOpInfo[code[pc]];
+        out << "  " << pc << '\t' << info.mnemonic;
+        for (int i = 1; i <= info.operands; ++i) {
+            out << (i == 1 ? " " : ", ") << code[pc + i];
+        }
+        out << '\n';
+        pc += 1 + info.operands;
+    }
+}
+
+BytecodeProgram BytecodeCompiler::compile(const Program& program) {
+    BytecodeProgram result;
+    program_ = &result;
+
+    // 先登记所有函数，调用可以出现在定义之前
+    for (const auto& func : program.functions) {
+        BytecodeFunction info;
+        info.name = func->name;
+        info.numParams = static_cast<int>(func->params.size());
+        result.functionIndex[func->name] = static_cast<int>(result.functions.size());
+        result.functions.push_back(info);
+    }
+    for (const auto& func : program.functions) {
+        compileFunction(*func);
+    }
+
+    program_ = nullptr;
+    return result;
+}
+
+void BytecodeCompiler::compileFunction(const FunctionDecl& func) {
+    variables_.clear();
+    loops_.clear();
+    inline_exits_.clear();
+
+    // 参数在前，局部变量按出现顺序排在其后
+    for (const auto& param : func.params) {
+        variables_.emplace(param.second, static_cast<int>(variables_.size()));
+    }
+    forEachVariable(*func.body, [&](const std::string& name) {
+        variables_.emplace(name, static_cast<int>(variables_.size()));
+    });
+    next_temp_ = static_cast<int>(variables_.size());
+    max_registers_ = next_temp_;
+
+    BytecodeFunction& info = program_->functions[program_->functionIndex.at(func.name)];
+    info.entry = here();
+
+    compileBlock(*func.body);
+    if (func.body->statements.empty() ||
+        !dynamic_cast<const ReturnStmt*>(func.body->statements.back().get())) {
+        int zero = allocTemp();
+        emit(Op::LoadK, {zero, 0}); // 默认返回0
+        emit(Op::Return, {zero});
+    }
+
+    program_->functions[program_->functionIndex.at(func.name)].numRegisters = max_registers_;
+}
+
+void BytecodeCompiler::compileBlock(const Block& block) {
+    for (const auto& stmt : block.statements) {
+        compileStatement(*stmt);
+    }
+}
+
+void BytecodeCompiler::compileStatement(const Statement& stmt) {
+    int mark = next_temp_;
+    if (auto decl = dynamic_cast<const VariableDecl*>(&stmt)) {
+        if (decl->value) {
+            compileInto(*decl->value, variable(decl->varName->name));
+        }
+    } else if (auto assign = dynamic_cast<const Assignment*>(&stmt)) {
+        compileInto(*assign->value, variable(assign->varName->name));
+    } else if (auto ret = dynamic_cast<const ReturnStmt*>(&stmt)) {
+        auto call = dynamic_cast<const FunctionCall*>(ret->value.get());
+        if (ret->tailCall && call) {
+            compileTailCall(*call);
+        } else {
+            emit(Op::Return, {compileAny(*ret->value)});
+        }
+    } else if (auto print = dynamic_cast<const PrintlnIntStmt*>(&stmt)) {
+        emit(Op::Print, {compileAny(*print->arg)});
+    } else if (auto exprStmt = dynamic_cast<const ExpressionStatement*>(&stmt)) {
+        compileAny(*exprStmt->expr);
+    } else if (auto block = dynamic_cast<const Block*>(&stmt)) {
+        compileBlock(*block);
+    } else if (auto cond = dynamic_cast<const ConditionStatement*>(&stmt)) {
+        emit(Op::JumpIfZero, {compileAny(*cond->condition), 0});
+        size_t toElse = here() - 1;
+        freeTemps(mark);
+        compileBlock(*cond->thenBlock);
+        if (cond->elseBlock) {
+            emit(Op::Jump, {0});
+            size_t toEnd = here() - 1;
+            patch(toElse, here());
+            compileBlock(*cond->elseBlock);
+            patch(toEnd, here());
+        } else {
+            patch(toElse, here());
+        }
+    } else if (auto loop = dynamic_cast<const LoopStatement*>(&stmt)) {
+        loops_.push_back({here(), {}});
+        emit(Op::JumpIfZero, {compileAny(*loop->condition), 0});
+        size_t toEnd = here() - 1;
+        freeTemps(mark);
+        compileBlock(*loop->body);
+        emit(Op::Jump, {static_cast<int32_t>(loops_.back().start)});
+        patch(toEnd, here());
+        for (size_t jump : loops_.back().breaks) {
+            patch(jump, here());
+        }
+        loops_.pop_back();
+    } else if (dynamic_cast<const BreakStmt*>(&stmt)) {
+        if (loops_.empty()) throw std::runtime_error("Break statement not inside a loop");
+        emit(Op::Jump, {0});
+        loops_.back().breaks.push_back(here() - 1);
+    } else if (dynamic_cast<const ContinueStmt*>(&stmt)) {
+        if (loops_.empty()) throw std::runtime_error("Continue statement not inside a loop");
+        emit(Op::Jump, {static_cast<int32_t>(loops_.back().start)});
+    } else if (auto inlRet = dynamic_cast<const InlineReturn*>(&stmt)) {
+        // 返回值中可能还有内联调用，不能持有inline_exits_元素的引用
+        size_t exit = inline_exits_.size() - 1;
+        if (inlRet->value) {
+            compileInto(*inlRet->value, inline_exits_[exit].result);
+        } else {
+            emit(Op::LoadK, {inline_exits_[exit].result, 0});
+        }
+        if (inlRet != inline_exits_[exit].tail) {
+            emit(Op::Jump, {0});
+            inline_exits_[exit].patches.push_back(here() - 1);
+        }
+    } else {
+        throw std::runtime_error("Unknown statement type");
+    }
+    freeTemps(mark);
+}
+
+/**
+ * @brief 求值表达式，返回保存结果的寄存器（变量直接返回其寄存器，不复制）
+ */
+int BytecodeCompiler::compileAny(const Expression& expr) {
+    if (auto var = dynamic_cast<const Variable*>(&expr)) {
+        return variable(var->name);
+    }
+    int target = allocTemp();
+    compileInto(expr, target);
+    return target;
+}
+
+/**
+ * @brief 求值表达式到target寄存器
+ *
+ * 二元运算和函数调用用显式栈遍历，不随表达式的长度或嵌套深度递归；
+ * 临时寄存器的分配顺序与逐层调用compileAny相同：作为操作数的变量直接使用其寄存器，
+ * 其他子表达式先分配一个临时寄存器再求值到其中，节点完成时释放它之后分配的临时寄存器。
+ */
+void BytecodeCompiler::compileInto(const Expression& expr, int target) {
+    struct Frame {
+        const Expression* expr;
+        int target;
+        int mark;   // 开始时的next_temp_
+        int stage;  // 二元运算：0 左操作数，1 右操作数，2 运算；函数调用：已求值的实参个数
+        int left;   // 二元运算的操作数寄存器
+        int right;
+        int callee; // 函数调用：被调函数的下标（-1表示尚未开始）和第一个实参的寄存器
+        int base;
+    };
+    std::vector<Frame> stack;
+    stack.push_back({&expr, target, next_temp_, 0, 0, 0, -1, 0});
+    while (!stack.empty()) {
+        Frame& frame = stack.back();
+        const Expression* next = nullptr;
+        int nextTarget = 0;
+        if (auto lit = dynamic_cast<const IntegerLiteral*>(frame.expr)) {
+            emit(Op::LoadK, {frame.target, lit->value});
+        } else if (auto var = dynamic_cast<const Variable*>(frame.expr)) {
+            int source = variable(var->name);
+            if (source != frame.target) emit(Op::Move, {frame.target, source});
+        } else if (auto op = dynamic_cast<const BinaryOp*>(frame.expr)) {
+            auto it = binaryOps().find(op->op);
+            if (it == binaryOps().end()) {
+                throw std::runtime_error("Unknown binary operator: " + op->op);
+            }
+            if (frame.stage == 0) {
+                frame.stage = 1;
+                if (auto var = dynamic_cast<const Variable*>(op->left.get())) {
+                    frame.left = variable(var->name);
+                    continue;
+                }
+                next = op->left.get();
+                nextTarget = frame.left = allocTemp();
+            } else if (frame.stage == 1) {
+                auto lit = dynamic_cast<const IntegerLiteral*>(op->right.get());
+                auto var = dynamic_cast<const Variable*>(op->right.get());
+                if (lit && (it->second == Op::Add || it->second == Op::Sub)) {
+                    uint32_t imm = static_cast<uint32_t>(lit->value);
+                    if (it->second == Op::Sub) imm = 0u - imm;
+                    emit(Op::AddK, {frame.target, frame.left, static_cast<int32_t>(imm)});
+                } else if (var) {
+                    emit(it->second, {frame.target, frame.left, variable(var->name)});
+                } else {
+                    frame.stage = 2;
+                    next = op->right.get();
+                    nextTarget = frame.right = allocTemp();
+                }
+            } else {
+                emit(it->second, {frame.target, frame.left, frame.right});
+            }
+        } else if (auto call = dynamic_cast<const FunctionCall*>(frame.expr)) {
+            if (frame.callee < 0) {
+                frame.callee = beginCall(*call, frame.base);
+            }
+            int argc = static_cast<int>(call->args.size());
+            if (frame.stage < argc) {
+                int i = argc - 1 - frame.stage++; // 实参从右到左求值
+                next = call->args[i].get();
+                nextTarget = frame.base + i;
+            } else {
+                emit(Op::Call, {frame.target, frame.callee, frame.base, argc});
+            }
+        } else if (auto inl = dynamic_cast<const InlinedCall*>(frame.expr)) {
+            // 函数体最后一条InlineReturn之后就是汇合点，不需要跳转
+            const Statement* last = inl->body.get();
+            while (auto block = dynamic_cast<const Block*>(last)) {
+                if (block->statements.empty()) break;
+                last = block->statements.back().get();
+            }
+            inline_exits_.push_back({frame.target, dynamic_cast<const InlineReturn*>(last), {}});
+            compileBlock(*inl->body);
+            for (size_t jump : inline_exits_.back().patches) {
+                patch(jump, here());
+            }
+            inline_exits_.pop_back();
+        } else {
+            throw std::runtime_error("Unknown expression type");
+        }
+
+        if (next) {
+            stack.push_back({next, nextTarget, next_temp_, 0, 0, 0, -1, 0});
+        } else {
+            freeTemps(frame.mark);
+            stack.pop_back();
+        }
+    }
+}
+
+/**
+ * @brief 检查被调函数和实参个数，为实参分配连续的临时寄存器
+ * @param base 输出：第一个实参的寄存器
+ * @return 被调函数的下标
+ */
+int BytecodeCompiler::beginCall(const FunctionCall& call, int& base) {
+    auto it = program_->functionIndex.find(call.functionName);
+    if (it == program_->functionIndex.end()) {
+        throw std::runtime_error("Undefined function: " + call.functionName);
+    }
+    int argc = static_cast<int>(call.args.size());
+    if (program_->functions[it->second].numParams != argc) {
+        throw std::runtime_error("Wrong number of arguments in call to " + call.functionName);
+    }
+
+    base = next_temp_;
+    for (int i = 0; i < argc; ++i) {
+        allocTemp();
+    }
+    return it->second;
+}
+
+/**
+ * @brief 尾调用：实参按CodeGen的顺序（从右到左）求值到连续的临时寄存器中
+ */
+void BytecodeCompiler::compileTailCall(const FunctionCall& call) {
+    int base;
+    int callee = beginCall(call, base);
+    int argc = static_cast<int>(call.args.size());
+    for (int i = argc - 1; i >= 0; --i) {
+        compileInto(*call.args[i], base + i);
+    }
+    emit(Op::TailCall, {callee, base, argc});
+}
+
+int BytecodeCompiler::allocTemp() {
+    int reg = next_temp_++;
+    max_registers_ = std::max(max_registers_, next_temp_);
+    return reg;
+}
+
+int BytecodeCompiler::variable(const std::string& name) {
+    auto it = variables_.find(name);
+    if (it == variables_.end()) {
+        throw std::runtime_error("Unknown variable: " + name);
+    }
+    return it->second;
+}
+
+void BytecodeCompiler::emit(Op op, std::initializer_list<int32_t> operands) {
+    program_->code.push_back(static_cast<int32_t>(op));
+    program_->code.insert(program_->code.end(), operands.begin(), operands.end());
+}
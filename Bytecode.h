@@ -0,0 +1,105 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include "Parser.h"
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * 寄存器式字节码
+ * 每个函数有自己的寄存器窗口：r0..r(n-1)是参数，其后是局部变量和临时值。
+ * 指令是int32序列：操作码后跟固定个数的操作数（寄存器下标、立即数或跳转目标的绝对位置）。
+ * 语义与CodeGen一致：32位补码回绕，&&、||按位运算，比较结果为0/1，
+ * 实参从右到左求值，函数末尾没有return时返回0。
+ */
+
+// 操作码、助记符、操作数个数
+#define BYTECODE_OPS(X)                                                         \
+    X(LoadK, "loadk", 2)      /* a, imm         r[a] = imm                  */ \
+    X(Move, "move", 2)        /* a, b           r[a] = r[b]                 */ \
+    X(Add, "add", 3)          /* a, b, c        r[a] = r[b] + r[c]          */ \
+    X(Sub, "sub", 3)                                                            \
+    X(Mul, "mul", 3)                                                            \
+    X(Div, "div", 3)                                                            \
+    X(Mod, "mod", 3)                                                            \
+    X(And, "and", 3)                                                            \
+    X(Or, "or", 3)                                                              \
+    X(Xor, "xor", 3)                                                            \
+    X(Eq, "eq", 3)                                                              \
+    X(Ne, "ne", 3)                                                              \
+    X(Lt, "lt", 3)                                                              \
+    X(Le, "le", 3)                                                              \
+    X(Gt, "gt", 3)                                                              \
+    X(Ge, "ge", 3)                                                              \
+    X(AddK, "addk", 3)        /* a, b, imm      r[a] = r[b] + imm           */ \
+    X(Jump, "jmp", 1)         /* target                                     */ \
+    X(JumpIfZero, "jz", 2)    /* a, target      if (r[a] == 0) goto target  */ \
+    X(Call, "call", 4)        /* a, f, b, n     r[a] = f(r[b]..r[b+n-1])    */ \
+    X(TailCall, "tailcall", 3) /* f, b, n       return f(r[b]..r[b+n-1])    */ \
+    X(Return, "ret", 1)       /* a              return r[a]                 */ \
+    X(Print, "print", 1)      /* a              println_int(r[a])           */
+
+enum class Op : int32_t {
+#define BYTECODE_ENUM(name, mnemonic, operands) name,
+    BYTECODE_OPS(BYTECODE_ENUM)
+#undef BYTECODE_ENUM
+};
+
+struct BytecodeFunction {
+    std::string name;
+    int numParams = 0;
+    int numRegisters = 0;
+    size_t entry = 0; // 在BytecodeProgram::code中的起始位置
+};
+
+struct BytecodeProgram {
+    std::vector<int32_t> code;
+    std::vector<BytecodeFunction> functions;
+    std::unordered_map<std::string, int> functionIndex;
+
+    void disassemble(std::ostream& out) const;
+};
+
+// 把AST翻译为字节码；未定义的函数、参数个数不符或循环外的break/continue抛出runtime_error
+class BytecodeCompiler {
+public:
+    BytecodeProgram compile(const Program& program);
+
+private:
+    struct InlineExit {
+        int result;                   // 结果寄存器
+        const InlineReturn* tail;     // 函数体末尾的InlineReturn
+        std::vector<size_t> patches;  // 跳到汇合点的jmp
+    };
+    struct LoopLabels {
+        size_t start;
+        std::vector<size_t> breaks;
+    };
+
+    BytecodeProgram* program_ = nullptr;
+    std::unordered_map<std::string, int> variables_; // 变量 -> 寄存器
+    int next_temp_ = 0;
+    int max_registers_ = 0;
+    std::vector<LoopLabels> loops_;
+    std::vector<InlineExit> inline_exits_;
+
+    void compileFunction(const FunctionDecl& func);
+    void compileStatement(const Statement& stmt);
+    void compileBlock(const Block& block);
+    void compileInto(const Expression& expr, int target);
+    int compileAny(const Expression& expr);
+    int beginCall(const FunctionCall& call, int& base);
+    void compileTailCall(const FunctionCall& call);
+
+    int allocTemp();
+    void freeTemps(int mark) { next_temp_ = mark; }
+    int variable(const std::string& name);
+    void emit(Op op, std::initializer_list<int32_t> operands);
+    size_t here() const { return program_->code.size(); }
+    void patch(size_t jumpOperand, size_t target) { program_->code[jumpOperand] = static_cast<int32_t>(target); }
+};
+
+#endif // BYTECODE_H
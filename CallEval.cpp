@@ -0,0 +1,281 @@
+#include "CallEval.h"
+#include "ASTUtil.h"
+#include "ConstantFold.h"
+#include <algorithm>
+
+namespace {
+
+// 放弃求值（输出、除以0、未赋值的变量、超出步数或深度等），调用留到运行时
+struct NotConstant {};
+
+// 语句执行后的去向
+enum class Flow { Next, Break, Continue, Return, InlineReturn };
+
+class Interpreter {
+public:
+    Interpreter(const std::unordered_map<std::string, const FunctionDecl*>& functions,
+                std::map<std::pair<std::string, std::vector<int>>, int>& results, long long steps, int maxDepth)
+        : functions_(functions), results_(results), steps_(steps), maxDepth_(maxDepth) {}
+
+    int call(const std::string& name, const std::vector<int>& args) {
+        auto key = std::make_pair(name, args);
+        auto cached = results_.find(key);
+        if (cached != results_.end()) return cached->second;
+
+        auto it = functions_.find(name);
+        if (it == functions_.end()) throw NotConstant();
+        const FunctionDecl& func = *it->second;
+        if (func.params.size() != args.size()) throw NotConstant();
+
+        Frame frame;
+        for (size_t i = 0; i < args.size(); ++i) {
+            frame.variables[func.params[i].second] = args[i];
+        }
+        Frame* caller = frame_;
+        frame_ = &frame;
+        Flow flow = exec(*func.body);
+        frame_ = caller;
+
+        int value;
+        if (flow == Flow::Return) {
+            value = frame.result;
+        } else if (flow == Flow::Next) {
+            value = 0; // 与代码生成一致，默认返回0
+        } else {
+            throw NotConstant();
+        }
+        results_[key] = value;
+        return value;
+    }
+
+    long long steps() const { return steps_; }
+
+private:
+    struct Frame {
+        std::unordered_map<std::string, int> variables;
+        int result = 0;
+    };
+
+    const std::unordered_map<std::string, const FunctionDecl*>& functions_;
+    std::map<std::pair<std::string, std::vector<int>>, int>& results_;
+    long long steps_; // 剩余步数
+    int maxDepth_;
+    int depth_ = 0;
+    Frame* frame_ = nullptr;
+
+    // 每个语句和表达式节点算一步，同时限制C++递归的深度
+    struct Step {
+        Interpreter& in;
+        explicit Step(Interpreter& in) : in(in) {
+            if (--in.steps_ < 0 || ++in.depth_ > in.maxDepth_) throw NotConstant();
+        }
+        ~Step() { in.depth_--; }
+    };
+
+    Flow exec(const Statement& stmt) {
+        Step step(*this);
+        if (auto decl = dynamic_cast<const VariableDecl*>(&stmt)) {
+            if (decl->value) frame_->variables[decl->varName->name] = eval(*decl->value);
+        } else if (auto assign = dynamic_cast<const Assignment*>(&stmt)) {
+            frame_->variables[assign->varName->name] = eval(*assign->value);
+        } else if (auto ret = dynamic_cast<const ReturnStmt*>(&stmt)) {
+            if (!ret->value) throw NotConstant();
+            frame_->result = eval(*ret->value);
+            return Flow::Return;
+        } else if (dynamic_cast<const PrintlnIntStmt*>(&stmt)) {
+            throw NotConstant();
+        } else if (auto exprStmt = dynamic_cast<const ExpressionStatement*>(&stmt)) {
+            eval(*exprStmt->expr);
+        } else if (auto block = dynamic_cast<const Block*>(&stmt)) {
+            for (const auto& s : block->statements) {
+                Flow flow = exec(*s);
+                if (flow != Flow::Next) return flow;
+            }
+        } else if (auto cond = dynamic_cast<const ConditionStatement*>(&stmt)) {
+            if (eval(*cond->condition) != 0) return exec(*cond->thenBlock);
+            if (cond->elseBlock) return exec(*cond->elseBlock);
+        } else if (auto loop = dynamic_cast<const LoopStatement*>(&stmt)) {
+            while (eval(*loop->condition) != 0) {
+                Flow flow = exec(*loop->body);
+                if (flow == Flow::Break) break;
+                if (flow != Flow::Next && flow != Flow::Continue) return flow;
+            }
+        } else if (dynamic_cast<const BreakStmt*>(&stmt)) {
+            return Flow::Break;
+        } else if (dynamic_cast<const ContinueStmt*>(&stmt)) {
+            return Flow::Continue;
+        } else if (auto inlRet = dynamic_cast<const InlineReturn*>(&stmt)) {
+            frame_->result = inlRet->value ? eval(*inlRet->value) : 0;
+            return Flow::InlineReturn;
+        } else {
+            throw NotConstant();
+        }
+        return Flow::Next;
+    }
+
+    int eval(const Expression& expr) {
+        Step step(*this);
+        if (auto lit = dynamic_cast<const IntegerLiteral*>(&expr)) {
+            return lit->value;
+        } else if (auto var = dynamic_cast<const Variable*>(&expr)) {
+            auto it = frame_->variables.find(var->name);
+            if (it == frame_->variables.end()) throw NotConstant();
+            return it->second;
+        } else if (auto op = dynamic_cast<const BinaryOp*>(&expr)) {
+            int left = eval(*op->left);
+            int right = eval(*op->right);
+            int value;
+            if (!evaluateBinaryOp(op->op, left, right, value)) throw NotConstant();
+            return value;
+        } else if (auto call = dynamic_cast<const FunctionCall*>(&expr)) {
+            std::vector<int> args(call->args.size());
+            for (size_t i = call->args.size(); i-- > 0;) {
+                args[i] = eval(*call->args[i]);
+            }
+            return this->call(call->functionName, args);
+        } else if (auto inl = dynamic_cast<const InlinedCall*>(&expr)) {
+            if (exec(*inl->body) != Flow::InlineReturn) throw NotConstant();
+            return frame_->result;
+        }
+        throw NotConstant();
+    }
+};
+
+} // namespace
+
+int CallEvaluator::run(Program& program) {
+    changedFunctions.clear();
+    analyze(program);
+    results_.clear();
+    failed_.clear();
+    remaining_ = totalBudget;
+
+    int replaced = 0;
+    for (auto& func : program.functions) {
+        int n = 0;
+        forEachExprSlot(*func->body, [&](std::unique_ptr<Expression>& slot) {
+            int value;
+            if (auto call = dynamic_cast<const FunctionCall*>(slot.get())) {
+                if (!evaluate(*call, value)) return;
+                for (const auto& name : reachable(call->functionName)) {
+                    auto& used = func->evaluatedCalls;
+                    if (std::find(used.begin(), used.end(), name) == used.end()) used.push_back(name);
+                }
+            } else if (auto op = dynamic_cast<const BinaryOp*>(slot.get())) {
+                auto left = dynamic_cast<const IntegerLiteral*>(op->left.get());
+                auto right = dynamic_cast<const IntegerLiteral*>(op->right.get());
+                if (!left || !right || !evaluateBinaryOp(op->op, left->value, right->value, value)) return;
+            } else {
+                return;
+            }
+            slot = std::make_unique<IntegerLiteral>(value);
+            n++;
+        });
+        if (n > 0) changedFunctions.push_back(func->name);
+        replaced += n;
+    }
+    return replaced;
+}
+
+std::unordered_set<std::string> pureFunctions(Program& program, CallGraph* graph) {
+    std::unordered_set<std::string> defined, impure;
+    CallGraph callees;
+    for (auto& func : program.functions) {
+        defined.insert(func->name);
+    }
+    for (auto& func : program.functions) {
+        bool prints = false;
+        auto scan = [&](const Statement& body) {
+            forEachStatement(body, [&](const Statement& stmt) {
+                if (dynamic_cast<const PrintlnIntStmt*>(&stmt)) prints = true;
+            });
+        };
+        scan(*func->body);
+        auto& calls = callees[func->name];
+        forEachExprSlot(*func->body, [&](std::unique_ptr<Expression>& slot) {
+            std::string name;
+            if (auto call = dynamic_cast<const FunctionCall*>(slot.get())) {
+                name = call->functionName;
+            } else if (auto inl = dynamic_cast<const InlinedCall*>(slot.get())) {
+                name = inl->functionName;
+                scan(*inl->body); // forEachStatement不进入内联体
+            } else {
+                return;
+            }
+            if (std::find(calls.begin(), calls.end(), name) == calls.end()) {
+                calls.push_back(name);
+            }
+        });
+        if (prints || func->name == "main") impure.insert(func->name);
+    }
+
+    // 调用了非纯函数或未定义函数的函数也不是纯函数，传播到不动点
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (const auto& entry : callees) {
+            if (impure.count(entry.first)) continue;
+            for (const auto& callee : entry.second) {
+                if (!defined.count(callee) || impure.count(callee)) {
+                    impure.insert(entry.first);
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    std::unordered_set<std::string> pure;
+    for (const auto& name : defined) {
+        if (!impure.count(name)) pure.insert(name);
+    }
+    if (graph) *graph = std::move(callees);
+    return pure;
+}
+
+void CallEvaluator::analyze(Program& program) {
+    functions_.clear();
+    for (auto& func : program.functions) {
+        functions_[func->name] = func.get();
+    }
+    pure_ = pureFunctions(program, &callees_);
+}
+
+bool CallEvaluator::evaluate(const FunctionCall& call, int& value) {
+    if (!pure_.count(call.functionName)) return false;
+    std::vector<int> args;
+    for (const auto& arg : call.args) {
+        auto lit = dynamic_cast<const IntegerLiteral*>(arg.get());
+        if (!lit) return false;
+        args.push_back(lit->value);
+    }
+    CallKey key(call.functionName, args);
+    auto cached = results_.find(key);
+    if (cached != results_.end()) {
+        value = cached->second;
+        return true;
+    }
+    if (failed_.count(key) || remaining_ <= 0) return false;
+
+    long long steps = std::min(budget, remaining_);
+    Interpreter interpreter(functions_, results_, steps, maxDepth);
+    bool ok = true;
+    try {
+        value = interpreter.call(call.functionName, args);
+    } catch (const NotConstant&) {
+        failed_.insert(key);
+        ok = false;
+    }
+    remaining_ -= steps - std::max(interpreter.steps(), 0LL);
+    return ok;
+}
+
+std::vector<std::string> CallEvaluator::reachable(const std::string& name) {
+    std::vector<std::string> order = {name};
+    for (size_t i = 0; i < order.size(); ++i) {
+        for (const auto& callee : callees_[order[i]]) {
+            if (std::find(order.begin(), order.end(), callee) == order.end()) order.push_back(callee);
+        }
+    }
+    return order;
+}
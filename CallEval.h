@@ -0,0 +1,63 @@
+#ifndef CALL_EVAL_H
+#define CALL_EVAL_H
+
+#include "Parser.h"
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// 调用图：函数 -> 它调用和内联的函数（去重，保持出现顺序）
+using CallGraph = std::unordered_map<std::string, std::vector<std::string>>;
+
+// 纯函数：函数体和它（传递地）调用的函数中没有println_int，调用的函数都有定义，且不是main。
+// 纯函数的结果只取决于实参（CallEvaluator、Memoizer共用）。graph非空时输出调用图
+std::unordered_set<std::string> pureFunctions(Program& program, CallGraph* graph = nullptr);
+
+/*
+ * 编译时求值
+ * 实参都是整数字面量的FunctionCall，若被调函数是纯函数，就在编译时用AST解释器执行它，
+ * 把调用替换为IntegerLiteral：fib(20)、pow(2, 10) 直接变成常量。
+ *
+ * 被调函数须是纯函数（pureFunctions）。
+ * 解释器的语义与生成的代码相同：32位补码回绕，除法向零截断，&&、||按位计算，
+ * 变量按函数作用域，函数末尾没有return时返回0。以下情况放弃求值，调用留到运行时：
+ *   - 除数为0或INT_MIN / -1（运行时会触发异常）
+ *   - 读取未赋值的变量、实参个数不符
+ *   - 单次求值超过budget步（语句和表达式节点各算一步）或调用/嵌套超过maxDepth层
+ *   - 整个程序的求值步数超过totalBudget
+ * 求值过的 (函数, 实参) 的结果在一次run中记住，递归中重复的子调用只执行一次。
+ * 替换后两边都是常量的二元运算一并折叠，f(2) + 1 整个变成常量。
+ */
+class CallEvaluator {
+public:
+    long long budget = 1 << 20;
+    long long totalBudget = 1 << 24;
+    int maxDepth = 1000;
+
+    // 返回替换的调用和折叠的运算个数
+    int run(Program& program);
+
+    // 最近一次run中有替换的函数
+    std::vector<std::string> changedFunctions;
+
+private:
+    using CallKey = std::pair<std::string, std::vector<int>>;
+
+    std::unordered_map<std::string, const FunctionDecl*> functions_;
+    CallGraph callees_;
+    std::unordered_set<std::string> pure_;
+    std::map<CallKey, int> results_; // 求值成功的调用
+    std::set<CallKey> failed_;       // 放弃求值的调用，不再重试
+    long long remaining_ = 0;
+
+    void analyze(Program& program);
+    bool evaluate(const FunctionCall& call, int& value);
+    // 从name出发能调用到的函数（包括name），按第一次到达的顺序
+    std::vector<std::string> reachable(const std::string& name);
+};
+
+#endif // CALL_EVAL_H
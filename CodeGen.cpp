@@ -1,40 +1,78 @@
 #include "CodeGen.h"
-
-CodeGen::CodeGen(std::unique_ptr<Program> ast) : ast_(std::move(ast)) {
+#include "ASTUtil.h"
+#include "Assembler.h"
+#include "FunctionCache.h"
+#include "Memoize.h"
+#include "Profile.h"
+#include "Stats.h"
+
+// ĴʹõļĴζӦ1~4
+static const char* const kParamRegisters[] = {"ecx", "edx", "esi", "edi"};
+static const int kMaxRegParams = 4;
+
+CodeGen::CodeGen(std::unique_ptr<Program> ast, CodeGenOptions options)
+    : ast_(std::move(ast)), options_(options) {
+    options_.regParams = std::max(0, std::min(options_.regParams, kMaxRegParams));
+    if (!options_.output) options_.output = &std::cout;
     // ʼĴ״̬
     for (const auto& reg : registers_) {
         reg_used_[reg] = false;
     }
 }
 
+CodeGen::CodeGen(CodeGenOptions options) : CodeGen(nullptr, options) {}
+
 void CodeGen::generateCode() {
+    beginProgram();
+    for (const auto& func : ast_->functions) {
+        declareFunction(func->name, static_cast<int>(func->params.size()));
+    }
+    
+    // 
+    for (const auto& func : ast_->functions) {
+        generateFunction(*func);
+    }
+    endProgram();
+}
+
+void CodeGen::beginProgram() {
     // ɻǰ
     emit(".intel_syntax noprefix");
     emit(".global main");
     emit(".extern printf");
+    if (options_.fastPrint) {
+        emit(".extern println_int");
+    }
+    if (options_.profileGenerate) {
+        emit(".extern profile_start");
+    }
 
     emit(".data");
     emit("format_str: .asciz \"%d\\n\""); // printfʽַ
 
     emit(".text");
     emit("");
-    
-    // 
-    genFunction(*ast_);
 }
 
-void CodeGen::genFunction(const Program& program) {
+void CodeGen::declareFunction(const std::string& name, int paramCount) {
+    param_counts_[name] = paramCount;
+}
 
-    // ɺ
-    for (const auto& func : program.functions) {
-        // std::cout  << "Generating function: " << func->name << std::endl;
-        if (auto decl = dynamic_cast<const FunctionDecl*>(func.get())) {
-            genFunctionDecl(*decl);
-        } else {
-            throw std::runtime_error("Unknown function type");
-        }
+void CodeGen::generateFunction(const FunctionDecl& func) {
+    if (options_.cache && options_.cacheKeys) {
+        genCachedFunction(func);
+    } else {
+        genFunctionDecl(func);
+    }
+    // ıֻʱʹãʽʱļ
+    func_params_.erase(func.name);
+    funct_vars_.erase(func.name);
+}
+
+void CodeGen::endProgram() {
+    if (options_.profileGenerate) {
+        emitProfileData();
     }
-    
 }
 
 void CodeGen::genBlock(const Block& block) {
@@ -67,6 +105,11 @@ void CodeGen::genStatement(const Statement& stmt) {
         genBreak(*brk);
     } else if (auto cont = dynamic_cast<const ContinueStmt*>(&stmt)) {
         genContinue(*cont);
+    } else if (auto exprStmt = dynamic_cast<const ExpressionStatement*>(&stmt)) {
+        // ʽ䣨絥ĺã
+        genExpression(*exprStmt->expr);
+    } else if (auto inlRet = dynamic_cast<const InlineReturn*>(&stmt)) {
+        genInlineReturn(*inlRet);
     } else{
         // /
         throw std::runtime_error("Unknown statement type");
@@ -77,35 +120,42 @@ void CodeGen::genStatement(const Statement& stmt) {
 void CodeGen::genPrintlnInt(const PrintlnIntStmt& print) {
     // ɲʽĴ루Ǳã
     genExpression(*print.arg);  // eax
+
+    // printfƻecxedx
+    auto saved = liveRegisters(&print, {"ecx", "edx"});
+    for (const auto& reg : saved) {
+        emit("  push " + reg);
+    }
     
-    // ѹջ׼printf
-    emit("  push eax");
-    emit("  push offset format_str");
-    emit("  call printf");
-    emit("  add esp, 8");
+    if (options_.fastPrint) {
+        // ʱprintln_intҪʽַ
+        emit("  push eax");
+        emit("  call println_int");
+        emit("  add esp, 4");
+    } else {
+        // ѹջ׼printf
+        emit("  push eax");
+        emit("  push offset format_str");
+        emit("  call printf");
+        emit("  add esp, 8");
+    }
+
+    for (auto it = saved.rbegin(); it != saved.rend(); ++it) {
+        emit("  pop " + *it);
+    }
 }
 
 void CodeGen::genVariableDecl(const VariableDecl& decl) {
-    // ӵֲб
-    local_vars_[current_function_name_].push_back(decl.varName->name);
-    
+    // ջgenFunctionDeclз䣬ֻʼֵ
     if (decl.value) {
-        // ʼֵ
-        genAssignment(Assignment(
-            std::make_unique<Variable>(decl.varName->name),
-            std::move(const_cast<std::unique_ptr<Expression>&>(decl.value))
-        ));
+        genExpression(*decl.value);
+        emit("  mov " + varAddress(decl.varName->name) + ", eax");
     }
 }
 
 void CodeGen::genAssignment(const Assignment& assign) {
     genExpression(*assign.value);
-
-    int index = findIndex(assign.varName->name);
-
-    // ȡջеλ
-    int offset = (index + 1) * 4;
-    emit("  mov DWORD PTR [ebp-" + std::to_string(offset) + "], eax");
+    emit("  mov " + varAddress(assign.varName->name) + ", eax");
 }
 
 void CodeGen::genCondition(const ConditionStatement& cond) {
@@ -113,12 +163,30 @@ void CodeGen::genCondition(const ConditionStatement& cond) {
     std::string endLabel = newLabel();
     genExpression(*cond.condition);
     emit("  cmp eax, 0");
+
+    if (cond.elseBlock && options_.profile && options_.profile->preferElse(cond.profileSite)) {
+        // profileelseִ֧Уelseֱ룬thenַں
+        std::string thenLabel = elseLabel;
+        emit("  jne " + thenLabel);
+        emitProfileCount(cond.profileSite, 1);
+        genBlock(*cond.elseBlock);
+        emit("  jmp " + endLabel);
+
+        emit(thenLabel + ":");
+        emitProfileCount(cond.profileSite, 0);
+        genBlock(*cond.thenBlock);
+        emit(endLabel + ":");
+        return;
+    }
+
     emit("  je " + elseLabel); // Ϊ٣תelse
 
+    emitProfileCount(cond.profileSite, 0);
     genBlock(*cond.thenBlock); // thenִ
     emit("  jmp " + endLabel); // else
     
     emit(elseLabel + ":");
+    emitProfileCount(cond.profileSite, 1);
     if(cond.elseBlock){
         genBlock(*cond.elseBlock); // elseִ
     }
@@ -130,20 +198,50 @@ void CodeGen::genLoop(const LoopStatement& loop) {
     std::string startLabel = newLabel();
     std::string endLabel = newLabel();
     
+    auto outerLabels = loop_labels_[current_function_name_]; // ֧Ƕѭ
     loop_labels_[current_function_name_] = {startLabel, endLabel};
 
+    const Profile* profile = options_.profile;
+    bool hot = profile && profile->hotLoop(loop.profileSite);
+    emitProfileCount(loop.profileSite, 0);
+
+    if (profile && profile->rotateLoop(loop.profileSite)) {
+        // profileƽֹһεжϷѭ֮ÿεһת
+        // continueȻжϣstartLabel
+        std::string bodyLabel = newLabel();
+        emit("  jmp " + startLabel);
+        if (hot) {
+            emit(".p2align 4");
+        }
+        emit(bodyLabel + ":");
+        emitProfileCount(loop.profileSite, 1);
+        genBlock(*loop.body);
+
+        emit(startLabel + ":");
+        genExpression(*loop.condition);
+        emit("  cmp eax, 0");
+        emit("  jne " + bodyLabel);
+        emit(endLabel + ":");
+        loop_labels_[current_function_name_] = outerLabels;
+        return;
+    }
+
+    if (hot) {
+        emit(".p2align 4");
+    }
     emit(startLabel + ":");
 
     genExpression(*loop.condition);
     emit("  cmp eax, 0");
     emit("  je " + endLabel); // Ϊ٣תѭ
 
+    emitProfileCount(loop.profileSite, 1);
     genBlock(*loop.body); // ѭ
 
     emit("  jmp " + startLabel); // ѭʼ
     emit(endLabel + ":");
 
-    loop_labels_.erase(current_function_name_); // ǰѭǩ
+    loop_labels_[current_function_name_] = outerLabels; // ָѭıǩ
 }
 
 void CodeGen::genBreak(const BreakStmt& breakStmt) {
@@ -167,106 +265,502 @@ void CodeGen::genContinue(const ContinueStmt& continueStmt) {
 
 
 void CodeGen::genReturn(const ReturnStmt& ret) {
+    auto call = ret.tailCall ? dynamic_cast<const FunctionCall*>(ret.value.get()) : nullptr;
+    if (call && genTailCall(*call)) {
+        return;
+    }
     if (ret.value) {
         genExpression(*ret.value); // ֵeax
     } else {
         emit("  mov eax, 0"); // ĬϷ0
     }
-    emit("  leave");
+    emitLeave();
     emit("  ret");
 }
 
+/**
+ * @brief ɱʽeax
+ *
+ * Ԫͺʽջֵ˳Ԫңʵδҵ󣩣
+ * ʽĳȻǶȵݹ顣ջÿ¼ڵѾӽڵ
+ * ӽڵصڵʱʵεֵѹջ档
+ */
 void CodeGen::genExpression(const Expression& expr) {
-    if (auto lit = dynamic_cast<const IntegerLiteral*>(&expr)) {
-        genIntegerLiteral(*lit);
-    } else if (auto var = dynamic_cast<const Variable*>(&expr)) {
-        genVariable(*var);
-    } else if (auto op = dynamic_cast<const BinaryOp*>(&expr)) {
-        genBinaryOp(*op);
-    } else if (auto call = dynamic_cast<const FunctionCall*>(&expr)) {
-        genFunctionCall(*call);  // Ӻ֧
+    struct Frame {
+        const Expression* expr;
+        size_t done;                    // ɵӽڵ
+        std::vector<std::string> saved; // ãǰĲĴ
+    };
+    std::vector<Frame> stack;
+    stack.push_back({&expr, 0, {}});
+    while (!stack.empty()) {
+        Frame& frame = stack.back();
+        const Expression* next = nullptr;
+        if (auto op = dynamic_cast<const BinaryOp*>(frame.expr)) {
+            if (frame.done == 0) {
+                next = op->left.get();
+            } else if (frame.done == 1) {
+                emit("  push eax"); // 
+                next = op->right.get();
+            } else {
+                genBinaryOp(*op);
+            }
+        } else if (auto call = dynamic_cast<const FunctionCall*>(frame.expr)) {
+            size_t argCount = call->args.size();
+            if (frame.done == 0) {
+                frame.saved = beginFunctionCall(*call);
+            } else {
+                emit("  push eax");
+            }
+            if (frame.done < argCount) {
+                next = call->args[argCount - 1 - frame.done].get(); // ѹ(ҵ)
+            } else {
+                endFunctionCall(*call, frame.saved);
+            }
+        } else if (auto lit = dynamic_cast<const IntegerLiteral*>(frame.expr)) {
+            genIntegerLiteral(*lit);
+        } else if (auto var = dynamic_cast<const Variable*>(frame.expr)) {
+            genVariable(*var);
+        } else if (auto inl = dynamic_cast<const InlinedCall*>(frame.expr)) {
+            genInlinedCall(*inl);
+        }
+        // ʽ͵Ĵ
+
+        if (next) {
+            frame.done++;
+            stack.push_back({next, 0, {}});
+        } else {
+            stack.pop_back();
+        }
     }
-    // ʽ͵Ĵ
 }
 
 void CodeGen::genIntegerLiteral(const IntegerLiteral& lit) {
     emit("  mov eax, " + std::to_string(lit.value));
 }
 
-void CodeGen::genFunctionCall(const FunctionCall& call) {
-    emit("  push ecx");
-    emit("  push edx");
-    
-    // ѹ(ҵ)
-    for (int i = call.args.size() - 1; i >= 0; --i) {
-        genExpression(*call.args[i]);
-        emit("  push eax");
+/**
+ * @brief õĿʼȻԾĲĴرļĴ
+ * ֮genExpressionҵֵѹʵΣٵendFunctionCall
+ */
+std::vector<std::string> CodeGen::beginFunctionCall(const FunctionCall& call) {
+    // ֻȻԾĲĴڲʹȫμĴ
+    std::vector<std::string> clobbered = {"ecx", "edx"};
+    if (param_counts_.count(call.functionName)) {
+        for (int i = 2; i < options_.regParams; ++i) {
+            clobbered.push_back(kParamRegisters[i]);
+        }
+    }
+    auto saved = liveRegisters(&call, clobbered);
+    for (const auto& reg : saved) {
+        emit("  push " + reg);
+    }
+    return saved;
+}
+
+/**
+ * @brief õĽʵȫѹջáջָsavedеļĴ
+ */
+void CodeGen::endFunctionCall(const FunctionCall& call, const std::vector<std::string>& saved) {
+    int argCount = static_cast<int>(call.args.size());
+
+    // ĴΣȫʵֵϺǰջĴ
+    int regArgs = regArgCount(call.functionName, argCount);
+    for (int i = 0; i < regArgs; ++i) {
+        emit("  pop " + std::string(kParamRegisters[i]));
     }
     
+    emitProfileCount(call.profileSite, 0);
     emit("  call " + call.functionName);
     
     // ջ
-    if (!call.args.empty()) {
-        emit("  add esp, " + std::to_string(call.args.size() * 4));
+    if (argCount > regArgs) {
+        emit("  add esp, " + std::to_string((argCount - regArgs) * 4));
     }
     
     // ָ߱ļĴ
-    emit("  pop edx");
-    emit("  pop ecx");
+    for (auto it = saved.rbegin(); it != saved.rend(); ++it) {
+        emit("  pop " + *it);
+    }
+}
+
+/**
+ * @brief ͨ뻺ɺʱֱĻ࣬δʱɲ
+ */
+void CodeGen::genCachedFunction(const FunctionDecl& func) {
+    std::string key = options_.cacheKeys->key(func);
+    std::string text;
+    if (!options_.cache->lookup(key, text)) {
+        capture_ = &text;
+        try {
+            genFunctionDecl(func);
+        } catch (...) {
+            capture_ = nullptr;
+            throw;
+        }
+        capture_ = nullptr;
+        options_.cache->store(key, text);
+    }
+    emitText(text);
 }
 
 void CodeGen::genFunctionDecl(const FunctionDecl& func) {
+    label_count_ = 0;
+    // Ϣ
+    param_counts_[func.name] = func.params.size();
+    for (const auto& param : func.params) {
+        func_params_[func.name].push_back(param.second);
+    }
+    current_function_name_ = func.name;
+    if (!func.memoTarget.empty()) {
+        genMemoWrapper(func);
+        return;
+    }
+
+    // ԤΪоֲıջ
+    auto& params = func_params_[func.name];
+    forEachVariable(*func.body, [&](const std::string& name) {
+        if (std::find(params.begin(), params.end(), name) == params.end()) {
+            findIndex(name);
+        }
+    });
+
+    // ڲesiediΣmainҪΪⲿ߱
+    callee_saved_.clear();
+    if (!usesRegCall(func.name)) {
+        for (int i = 2; i < options_.regParams; ++i) {
+            callee_saved_.push_back(kParamRegisters[i]);
+            findIndex("." + callee_saved_.back());
+        }
+    }
+
     emit(func.name + ":");
     emit("  push ebp");
     emit("  mov ebp, esp");
     
-    // Ϊֲռ (ÿ4ֽ)
-    int local_var_size = 16; // ռ
+    // Ϊֲռ (ÿ4ֽڣ16ֽڶ룬16ֽ)
+    int local_var_size = (static_cast<int>(funct_vars_[func.name].size()) * 4 + 15) / 16 * 16;
+    local_var_size = std::max(local_var_size, 16);
     emit("  sub esp, " + std::to_string(local_var_size));
-    
-    // Ϣ
-    param_counts_[func.name] = func.params.size();
-    for (const auto& param : func.params) {
-        func_params_[func.name].push_back(param.second);
+
+    // Եݹβջ֡γѭ
+    body_label_.clear();
+    forEachStatement(*func.body, [&](const Statement& stmt) {
+        auto ret = dynamic_cast<const ReturnStmt*>(&stmt);
+        auto call = ret && ret->tailCall ? dynamic_cast<const FunctionCall*>(ret->value.get()) : nullptr;
+        if (call && call->functionName == func.name && body_label_.empty()) {
+            body_label_ = newLabel();
+        }
+    });
+    liveness_.reset(new ParamLiveness(func, !body_label_.empty()));
+
+    for (const auto& reg : callee_saved_) {
+        emit("  mov " + varAddress("." + reg) + ", " + reg);
+    }
+    if (options_.profileGenerate && func.name == "main") {
+        emitProfileStart();
+    }
+
+    if (!body_label_.empty()) {
+        emit(body_label_ + ":");
     }
     
-    current_function_name_ = func.name;
     genBlock(*func.body);
-    
+
+    // ĩβûreturnʱĬϷأһ
+    if (func.body->statements.empty() ||
+        !dynamic_cast<const ReturnStmt*>(func.body->statements.back().get())) {
+        emit("  mov eax, 0");
+        emitLeave();
+        emit("  ret");
+    }
+}
+
+/**
+ * @brief 仯İװMemoizerʵβʱֱӷأfunc.memoTargetд
+ *        ʵȴջֻ֡ʹeaxecxedxfunc.memoTargetʱͬԼ´
+ */
+void CodeGen::genMemoWrapper(const FunctionDecl& func) {
+    int paramCount = static_cast<int>(func.params.size());
+    std::vector<MemoLayout> parts = memoLayout(paramCount);
+    std::vector<std::string> lookups, misses;
+    for (size_t i = 0; i < parts.size(); ++i) {
+        lookups.push_back(i > 0 ? newLabel() : std::string()); // һֽŲı
+        misses.push_back(newLabel());
+    }
+    auto slot = [](int index) { return "DWORD PTR [ebp-" + std::to_string(4 * (index + 1)) + "]"; };
+    auto field = [](const std::string& base, int offset) {
+        return "DWORD PTR [" + base + (offset ? "+" + std::to_string(offset) : std::string()) + "]";
+    };
+    const std::string entry = slot(kMemoMaxParams); // ַ
+
+    emit(func.name + ":");
+    emit("  push ebp");
+    emit("  mov ebp, esp");
+    emit("  sub esp, 16");
+    for (int i = 0; i < paramCount; ++i) {
+        std::string home = argHome(func.name, paramCount, i);
+        if (home.find('[') == std::string::npos) {
+            emit("  mov " + slot(i) + ", " + home);
+        } else {
+            emit("  mov eax, " + home);
+            emit("  mov " + slot(i) + ", eax");
+        }
+    }
+
+    for (size_t part = 0; part < parts.size(); ++part) {
+        const MemoLayout& layout = parts[part];
+        if (part > 0) emit(lookups[part] + ":");
+        emit("  mov eax, " + slot(0));
+        if (layout.direct) {
+            // ֱӳķΧʱĹϣ
+            emit("  cmp eax, " + std::to_string(layout.entries));
+            emit("  jae " + lookups[part + 1]);
+        } else {
+            for (int i = 1; i < paramCount; ++i) {
+                emit("  imul eax, " + std::to_string(kMemoHashMultiplier));
+                emit("  add eax, " + slot(i));
+            }
+            emit("  and eax, " + std::to_string(layout.entries - 1));
+        }
+        emit("  imul eax, " + std::to_string(layout.entrySize));
+        emit("  mov ecx, offset " + memoTableSymbol(func.name));
+        emit("  add eax, ecx");
+        if (layout.offset) {
+            emit("  add eax, " + std::to_string(layout.offset));
+        }
+        emit("  mov " + entry + ", eax");
+        emit("  cmp " + field("eax", layout.validOffset) + ", 0");
+        emit("  je " + misses[part]);
+        if (!layout.direct) {
+            for (int i = 0; i < paramCount; ++i) {
+                emit("  mov ecx, " + slot(i));
+                emit("  cmp " + field("eax", i * 4) + ", ecx");
+                emit("  jne " + misses[part]);
+            }
+        }
+        emit("  mov eax, " + field("eax", layout.valueOffset));
+        emit("  leave");
+        emit("  ret");
+    }
+
+    int regArgs = regArgCount(func.memoTarget, paramCount);
+    for (size_t part = 0; part < parts.size(); ++part) {
+        const MemoLayout& layout = parts[part];
+        emit(misses[part] + ":");
+        for (int i = paramCount - 1; i >= 0; --i) {
+            emit("  mov eax, " + slot(i));
+            emit("  push eax");
+        }
+        for (int i = 0; i < regArgs; ++i) {
+            emit("  pop " + std::string(kParamRegisters[i]));
+        }
+        emit("  call " + func.memoTarget);
+        if (paramCount > regArgs) {
+            emit("  add esp, " + std::to_string((paramCount - regArgs) * 4));
+        }
+        emit("  mov ecx, " + entry);
+        if (!layout.direct) {
+            for (int i = 0; i < paramCount; ++i) {
+                emit("  mov edx, " + slot(i));
+                emit("  mov " + field("ecx", i * 4) + ", edx");
+            }
+        }
+        emit("  mov " + field("ecx", layout.valueOffset) + ", eax");
+        emit("  mov " + field("ecx", layout.validOffset) + ", 1");
+        emit("  leave");
+        emit("  ret");
+    }
+
+    emit(".data");
+    emit(".p2align 3");
+    emit(memoTableSymbol(func.name) + ":");
+    emit(".zero " + std::to_string(memoTableSize(paramCount)));
+    emit(".text");
 }
 
+void CodeGen::emitProfileCount(int site, int index) {
+    if (!options_.profileGenerate || site < 0) return;
+    // 64λ32λ1λӵ32λֻڷ֧֮󡢵֮ǰʹãӰԾı־λ
+    int offset = (site * 2 + index) * 8;
+    emit("  add DWORD PTR [profile_counters+" + std::to_string(offset) + "], 1");
+    emit("  adc DWORD PTR [profile_counters+" + std::to_string(offset + 4) + "], 0");
+}
+
+// mainʼʱʱǼǼprofileļ·
+void CodeGen::emitProfileStart() {
+    emit("  push offset profile_path");
+    emit("  push offset profile_counters_end");
+    emit("  push offset profile_counters");
+    emit("  call profile_start");
+    emit("  add esp, 12");
+}
+
+void CodeGen::emitProfileData() {
+    std::string path;
+    for (char c : options_.profilePath) {
+        if (c == '\\' || c == '"') path += '\\';
+        path += c;
+    }
+    emit(".data");
+    emit(".p2align 3");
+    emit("profile_counters:");
+    emit(".zero " + std::to_string(options_.profileSites * 16));
+    emit("profile_counters_end:");
+    emit("profile_path: .asciz \"" + path + "\"");
+}
+
+void CodeGen::emitLeave() {
+    for (const auto& reg : callee_saved_) {
+        emit("  mov " + reg + ", " + varAddress("." + reg));
+    }
+    emit("  leave");
+}
+
+bool CodeGen::usesRegCall(const std::string& funcName) const {
+    return options_.regParams > 0 && funcName != "main" && param_counts_.count(funcName);
+}
+
+int CodeGen::regArgCount(const std::string& funcName, int argCount) const {
+    return usesRegCall(funcName) ? std::min(argCount, options_.regParams) : 0;
+}
+
+/**
+ * @brief indexڵǰջ֡еλãĴ[ebp+n]
+ * @param funcName ĺǰβõĿ꣩
+ */
+std::string CodeGen::argHome(const std::string& funcName, int argCount, int index) const {
+    int regArgs = regArgCount(funcName, argCount);
+    if (index < regArgs) {
+        return kParamRegisters[index];
+    }
+    return "DWORD PTR [ebp+" + std::to_string(8 + (index - regArgs) * 4) + "]";
+}
+
+/**
+ * @brief siteҪļĴſsiteԾһᱻsiteƻļĴ
+ */
+std::vector<std::string> CodeGen::liveRegisters(const ASTNode* site, const std::vector<std::string>& clobbered) {
+    std::vector<std::string> result;
+    if (!liveness_) return result;
+    for (const auto& name : liveness_->liveAfter(site)) {
+        std::string home = varAddress(name);
+        if (std::find(clobbered.begin(), clobbered.end(), home) != clobbered.end() &&
+            std::find(result.begin(), result.end(), home) == result.end()) {
+            result.push_back(home);
+        }
+    }
+    return result;
+}
+
+
+/**
+ * @brief βãʵдصǰĲתջ
+ * @return ޷ջ֡ʱfalseɵ߰ͨô
+ */
+bool CodeGen::genTailCall(const FunctionCall& call) {
+    bool self = call.functionName == current_function_name_;
+    int argCount = static_cast<int>(call.args.size());
+    int paramCount = static_cast<int>(func_params_[current_function_name_].size());
+
+    // ջϵĲɵ߷ֻбջڵǰʱܸã
+    // main뿪ǰҪָesiediܰ
+    if (!self) {
+        int calleeStackArgs = argCount - regArgCount(call.functionName, argCount);
+        int ownStackParams = paramCount - regArgCount(current_function_name_, paramCount);
+        if (calleeStackArgs > ownStackParams || !callee_saved_.empty()) {
+            return false;
+        }
+    }
+    emitProfileCount(call.profileSite, 0);
+
+    // ʵοõǰȫֵҵͨһ£ͳһд
+    for (int i = argCount - 1; i > 0; --i) {
+        genExpression(*call.args[i]);
+        emit("  push eax");
+    }
+    if (argCount > 0) {
+        genExpression(*call.args[0]);
+        emit("  mov " + argHome(call.functionName, argCount, 0) + ", eax");
+    }
+    for (int i = 1; i < argCount; ++i) {
+        std::string home = argHome(call.functionName, argCount, i);
+        if (home.find('[') == std::string::npos) {
+            emit("  pop " + home);
+        } else {
+            emit("  pop eax");
+            emit("  mov " + home + ", eax");
+        }
+    }
+
+    if (self) {
+        emit("  jmp " + body_label_);
+    } else {
+        emitLeave();
+        emit("  jmp " + call.functionName);
+    }
+    return true;
+}
 
 void CodeGen::genVariable(const Variable& var) {
+    emit("  mov eax, " + varAddress(var.name));
+}
+
+std::string CodeGen::varAddress(const std::string& name) {
     // ȼǷǲ
     auto& params = func_params_[current_function_name_];
-    auto param_it = std::find(params.begin(), params.end(), var.name);
+    auto param_it = std::find(params.begin(), params.end(), name);
     
     if (param_it != params.end()) {
-        //  (ƫ)
+        //  (Ĵƫƣebp+8ǵһջϲ)
         int param_index = std::distance(params.begin(), param_it);
-        int offset = 8 + param_index * 4;  // ebp+8һ
-        emit("  mov eax, DWORD PTR [ebp+" + std::to_string(offset) + "]");
+        return argHome(current_function_name_, static_cast<int>(params.size()), param_index);
+    }
+    // ֲ (ƫ)
+    int offset = (findIndex(name) + 1) * 4;  // ebp-4һֲ
+    return "DWORD PTR [ebp-" + std::to_string(offset) + "]";
+}
+
+void CodeGen::genInlinedCall(const InlinedCall& call) {
+    std::string joinLabel = newLabel();
+
+    // һreturnתĻϵǶ
+    const InlineReturn* outerTail = inline_tail_;
+    inline_tail_ = nullptr;
+    const Statement* last = call.body.get();
+    while (auto block = dynamic_cast<const Block*>(last)) {
+        if (block->statements.empty()) break;
+        last = block->statements.back().get();
+    }
+    if (auto ret = dynamic_cast<const InlineReturn*>(last)) {
+        inline_tail_ = ret;
+    }
+
+    emitProfileCount(call.profileSite, 0);
+    inline_exits_.push_back(joinLabel);
+    genBlock(*call.body);
+    inline_exits_.pop_back();
+    inline_tail_ = outerTail;
+
+    emit(joinLabel + ":"); // ֵeax
+}
+
+void CodeGen::genInlineReturn(const InlineReturn& ret) {
+    if (ret.value) {
+        genExpression(*ret.value);
     } else {
-        // ֲ (ƫ)
-        auto& locals = local_vars_[current_function_name_];
-        auto local_it = std::find(locals.begin(), locals.end(), var.name);
-        
-        if (local_it == locals.end()) {
-            locals.push_back(var.name);
-            local_it = locals.end() - 1;
-        }
-        
-        int local_index = std::distance(locals.begin(), local_it);
-        int offset = (local_index + 1) * 4;  // ebp-4һֲ
-        emit("  mov eax, DWORD PTR [ebp-" + std::to_string(offset) + "]");
+        emit("  mov eax, 0");
+    }
+    if (&ret != inline_tail_) {
+        emit("  jmp " + inline_exits_.back());
     }
 }
 
 
+/**
+ * @brief Ԫ㣺ѹջҲeaxУgenExpressionֵ
+ */
 void CodeGen::genBinaryOp(const BinaryOp& op) {
-    genExpression(*op.left);
-    emit("  push eax"); // 
-    genExpression(*op.right);
     emit("  mov ebx, eax");
     emit("  pop eax"); // ָ
     
@@ -276,14 +770,20 @@ void CodeGen::genBinaryOp(const BinaryOp& op) {
         emit("  sub eax, ebx");
     } else if (op.op == "*") {
         emit("  imul eax, ebx");
-    } else if (op.op == "/") {
-        // emit("  xchg eax, ebx");
-        emit("  cdq");
-        emit("  idiv ebx");
-    } else if (op.op == "%") {
+    } else if (op.op == "/" || op.op == "%") {
+        // cdq/idivƻedxedxеĲԻԾʱҪ
+        auto saved = liveRegisters(&op, {"edx"});
+        for (const auto& reg : saved) {
+            emit("  push " + reg);
+        }
         emit("  cdq");
         emit("  idiv ebx");
-        emit("  mov eax, edx"); // edx
+        if (op.op == "%") {
+            emit("  mov eax, edx"); // edx
+        }
+        for (auto it = saved.rbegin(); it != saved.rend(); ++it) {
+            emit("  pop " + *it);
+        }
     } 
     else if (op.op == "==") {
         emit("  cmp eax, ebx");
@@ -342,11 +842,41 @@ void CodeGen::freeRegister(const std::string& reg) {
 }
 
 void CodeGen::emit(const std::string& code) {
-    std::cout << code << std::endl;
+    if (capture_) {
+        *capture_ += code;
+        *capture_ += '\n';
+        return; // emitTextͳ
+    }
+    if (options_.stats) {
+        options_.stats->countAsmLine(code);
+    }
+    if (options_.assembler) {
+        options_.assembler->addLine(code);
+    } else {
+        *options_.output << code << '\n';
+    }
+}
+
+void CodeGen::emitText(const std::string& text) {
+    if (options_.stats) {
+        options_.stats->countAsmText(text);
+    }
+    if (options_.assembler) {
+        size_t begin = 0;
+        while (begin < text.size()) {
+            size_t end = text.find('\n', begin);
+            if (end == std::string::npos) end = text.size();
+            options_.assembler->addLine(text.substr(begin, end - begin));
+            begin = end + 1;
+        }
+    } else {
+        *options_.output << text;
+    }
 }
 
+// ǩţĻ಻Ļֱƴ
 std::string CodeGen::newLabel() {
-    return "label_" + std::to_string(label_count_++);
+    return ".L" + current_function_name_ + "_" + std::to_string(label_count_++);
 }
 
 // std::string CodeGen::newLabel() {
@@ -2,42 +2,92 @@
 #define CODEGEN_H
 
 #include "Parser.h"
+#include "Liveness.h"
 #include <iostream>
 #include <string>
 #include <unordered_map>
 #include <algorithm>
 
+class Assembler;
+class FunctionCache;
+class CacheKeys;
+struct CompileStats;
+class Profile;
+
+// 代码生成选项
+struct CodeGenOptions {
+    // 内部函数用寄存器传递的参数个数（0为全部cdecl，最多4个，依次为ecx、edx、esi、edi）
+    // main由外部调用，始终使用cdecl
+    int regParams = 0;
+    // 汇编文本的输出流，为空时输出到std::cout
+    std::ostream* output = nullptr;
+    // 不为空时汇编代码逐行交给内置汇编器，而不是输出到文本
+    Assembler* assembler = nullptr;
+    // println_int调用运行时库（Runtime.c）的println_int，而不是printf
+    bool fastPrint = false;
+    // 增量编译缓存：两者都不为空时，按函数查找/保存生成的汇编
+    FunctionCache* cache = nullptr;
+    const CacheKeys* cacheKeys = nullptr;
+    // 不为空时统计输出的指令和标签个数（--stats）
+    CompileStats* stats = nullptr;
+    // --profile-generate：条件、循环和调用处累加计数器，main开始时向运行时库登记，退出时写入profilePath
+    bool profileGenerate = false;
+    std::string profilePath;
+    int profileSites = 0; // 计数器按编号两个一组（Program::profileSites）
+    // --profile-use：按profile安排条件分支的布局、循环的形式和对齐
+    const Profile* profile = nullptr;
+};
+
 class CodeGen {
 public:
-    CodeGen(std::unique_ptr<Program> ast);
+    CodeGen(std::unique_ptr<Program> ast, CodeGenOptions options = CodeGenOptions());
     void generateCode();
 
+    // 流式生成（不持有整个程序）：beginProgram，声明所有函数的签名，再逐个generateFunction，最后endProgram。
+    // generateCode()就是按这个顺序处理ast中的函数
+    explicit CodeGen(CodeGenOptions options);
+    void beginProgram();
+    void declareFunction(const std::string& name, int paramCount);
+    // 代码生成是否依赖declareFunction声明的签名（寄存器传参时要知道哪些是内部函数）
+    bool needsSignatures() const { return options_.regParams > 0; }
+    void generateFunction(const FunctionDecl& func);
+    void endProgram();
+
 private:
     std::unique_ptr<Program> ast_;
+    CodeGenOptions options_;
     std::unordered_map<std::string, int> var_map_; // 变量到栈偏移的映射
     int stack_offset_ = 0; // 当前栈偏移量
-    int label_count_ = 0;  // 标签计数器
+    int label_count_ = 0;  // 标签计数器（每个函数从0开始）
+    std::string* capture_ = nullptr; // 不为空时emit写入这里（生成缓存条目）
     
     // 寄存器管理
     const std::vector<std::string> registers_ = {"eax", "ebx", "ecx", "edx", "esi", "edi"};
     std::unordered_map<std::string, bool> reg_used_;
 
     std::unordered_map<std::string, std::vector<std::string>> func_params_;  // 函数参数映射
-    std::unordered_map<std::string, std::vector<std::string>> local_vars_;   // 局部变量映射
-    std::unordered_map<std::string, int> param_counts_;                      // 函数参数计数
+    std::unordered_map<std::string, int> param_counts_;                      // 程序中定义的函数及其参数个数
 
     std::unordered_map<std::string, std::pair<std::string, std::string>> loop_labels_;
 
+    // 内联展开的汇合点标签栈，以及可以省略跳转的最后一条InlineReturn
+    std::vector<std::string> inline_exits_;
+    const InlineReturn* inline_tail_ = nullptr;
+
     std::unordered_map<std::string, std::vector<std::string>> funct_vars_; // 函数调用列表
     // functionName, vars[]
     int current_function_stack_size_ = 0; // 当前函数栈大小
     std::string current_function_name_;
+    std::string body_label_; // 函数体起点，自递归尾调用的跳转目标
+
+    // 寄存器传参
+    std::unique_ptr<ParamLiveness> liveness_;   // 当前函数参数的活跃性
+    std::vector<std::string> callee_saved_;     // main需要为外部调用者保留的寄存器
 
     std::string getRegister();
     void freeRegister(const std::string& reg);
     
     // AST节点代码生成方法
-    void genFunction(const Program& program);
     void genBlock(const Block& block);
     void genStatement(const Statement& stmt);
     void genExpression(const Expression& expr);
@@ -48,15 +98,31 @@ private:
     void genBinaryOp(const BinaryOp& op);
     void genVariable(const Variable& var);
     void genIntegerLiteral(const IntegerLiteral& lit);
-    void genFunctionCall(const FunctionCall& call);
+    std::vector<std::string> beginFunctionCall(const FunctionCall& call);
+    void endFunctionCall(const FunctionCall& call, const std::vector<std::string>& saved);
     void genFunctionDecl(const FunctionDecl& func);
+    void genCachedFunction(const FunctionDecl& func);
     void genCondition(const ConditionStatement& cond);
     void genLoop(const LoopStatement& loop);
     void genBreak(const BreakStmt& breakStmt);
     void genContinue(const ContinueStmt& continueStmt);
+    void genInlinedCall(const InlinedCall& call);
+    void genInlineReturn(const InlineReturn& ret);
+    bool genTailCall(const FunctionCall& call);
+    void genMemoWrapper(const FunctionDecl& func);
     
     // 工具方法
     void emit(const std::string& code);
+    void emitText(const std::string& text); // 输出多行汇编（缓存命中的函数）
+    std::string varAddress(const std::string& name); // 参数或局部变量的操作数（内存或寄存器）
+    bool usesRegCall(const std::string& funcName) const;
+    int regArgCount(const std::string& funcName, int argCount) const;
+    std::string argHome(const std::string& funcName, int argCount, int index) const;
+    std::vector<std::string> liveRegisters(const ASTNode* site, const std::vector<std::string>& clobbered);
+    void emitLeave();
+    void emitProfileCount(int site, int index); // --profile-generate时累加第site组的第index个计数器
+    void emitProfileStart();
+    void emitProfileData();
     int findIndex(const std::string& varName) {    
         auto& vars = funct_vars_[current_function_name_]; 
         auto it = std::find(vars.begin(), vars.end(), varName);
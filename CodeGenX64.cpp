@@ -0,0 +1,1000 @@
+#include "CodeGenX64.h"
+#include "ASTUtil.h"
+#include "Assembler.h"
+#include "FunctionCache.h"
+#include "Memoize.h"
+#include "Profile.h"
+#include "Stats.h"
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+// System V 整数参数寄存器
+static const char* const kArgRegisters32[] = {"edi", "esi", "edx", "ecx", "r8d", "r9d"};
+static const char* const kArgRegisters64[] = {"rdi", "rsi", "rdx", "rcx", "r8", "r9"};
+static const int kArgRegisterCount = 6;
+
+// 变量可用的被调用者保存寄存器
+static const char* const kVariableRegisters[] = {"ebx", "r12d", "r13d", "r14d", "r15d"};
+static const int kVariableRegisterCount = 5;
+
+static const int kRedZoneSize = 128;
+
+// 32位寄存器名 -> 64位寄存器名
+static std::string reg64(const std::string& reg32) {
+    if (reg32[0] == 'r') {
+        return reg32.substr(0, reg32.size() - 1); // r8d -> r8
+    }
+    return "r" + reg32.substr(1);                 // eax -> rax
+}
+
+static bool isRegister(const std::string& operand) {
+    return operand.find('[') == std::string::npos &&
+           !(std::isdigit(static_cast<unsigned char>(operand[0])) || operand[0] == '-');
+}
+
+namespace {
+
+// 表达式求值需要的临时寄存器数（右操作数是常量或变量时不需要保存左操作数）
+int tempsNeeded(const Expression& expr);
+
+int tempsNeeded(const Statement& stmt) {
+    int need = 0;
+    forEachStatement(stmt, [&](const Statement& s) {
+        auto visit = [&](const Expression* e) {
+            if (e) need = std::max(need, tempsNeeded(*e));
+        };
+        if (auto decl = dynamic_cast<const VariableDecl*>(&s)) visit(decl->value.get());
+        else if (auto assign = dynamic_cast<const Assignment*>(&s)) visit(assign->value.get());
+        else if (auto ret = dynamic_cast<const ReturnStmt*>(&s)) visit(ret->value.get());
+        else if (auto print = dynamic_cast<const PrintlnIntStmt*>(&s)) visit(print->arg.get());
+        else if (auto exprStmt = dynamic_cast<const ExpressionStatement*>(&s)) visit(exprStmt->expr.get());
+        else if (auto cond = dynamic_cast<const ConditionStatement*>(&s)) visit(cond->condition.get());
+        else if (auto loop = dynamic_cast<const LoopStatement*>(&s)) visit(loop->condition.get());
+        else if (auto inlRet = dynamic_cast<const InlineReturn*>(&s)) visit(inlRet->value.get());
+    });
+    return need;
+}
+
+// 用显式栈后序遍历，values中是已处理完的子表达式需要的临时寄存器个数
+int tempsNeeded(const Expression& expr) {
+    std::vector<std::pair<const Expression*, bool>> stack = {{&expr, false}}; // 节点, 子节点是否已处理
+    std::vector<int> values;
+    while (!stack.empty()) {
+        auto node = stack.back();
+        stack.pop_back();
+        auto op = dynamic_cast<const BinaryOp*>(node.first);
+        if (op && !node.second) {
+            stack.push_back({op, true});
+            stack.push_back({op->right.get(), false});
+            stack.push_back({op->left.get(), false});
+        } else if (op) {
+            int right = values.back();
+            values.pop_back();
+            bool simpleRight = dynamic_cast<const IntegerLiteral*>(op->right.get()) ||
+                               dynamic_cast<const Variable*>(op->right.get());
+            if (!simpleRight) values.back() = std::max(values.back(), right + 1);
+        } else if (auto inl = dynamic_cast<const InlinedCall*>(node.first)) {
+            values.push_back(tempsNeeded(*inl->body));
+        } else {
+            values.push_back(0);
+        }
+    }
+    return values.back();
+}
+
+// 表达式中是否有函数调用
+bool hasCalls(const Expression& expr);
+
+// 语句中是否有调用（包括println_int和内联体中的调用）
+bool hasCalls(const Statement& stmt) {
+    bool found = false;
+    forEachStatement(stmt, [&](const Statement& s) {
+        auto check = [&](const Expression* e) {
+            if (e && hasCalls(*e)) found = true;
+        };
+        if (dynamic_cast<const PrintlnIntStmt*>(&s)) found = true;
+        else if (auto decl = dynamic_cast<const VariableDecl*>(&s)) check(decl->value.get());
+        else if (auto assign = dynamic_cast<const Assignment*>(&s)) check(assign->value.get());
+        else if (auto ret = dynamic_cast<const ReturnStmt*>(&s)) check(ret->value.get());
+        else if (auto exprStmt = dynamic_cast<const ExpressionStatement*>(&s)) check(exprStmt->expr.get());
+        else if (auto cond = dynamic_cast<const ConditionStatement*>(&s)) check(cond->condition.get());
+        else if (auto loop = dynamic_cast<const LoopStatement*>(&s)) check(loop->condition.get());
+        else if (auto inlRet = dynamic_cast<const InlineReturn*>(&s)) check(inlRet->value.get());
+    });
+    return found;
+}
+
+bool hasCalls(const Expression& expr) {
+    std::vector<const Expression*> stack = {&expr};
+    while (!stack.empty()) {
+        const Expression* node = stack.back();
+        stack.pop_back();
+        if (auto op = dynamic_cast<const BinaryOp*>(node)) {
+            stack.push_back(op->right.get());
+            stack.push_back(op->left.get());
+        } else if (auto inl = dynamic_cast<const InlinedCall*>(node)) {
+            if (hasCalls(*inl->body)) return true;
+        } else if (dynamic_cast<const FunctionCall*>(node)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 变量引用次数，循环内的引用乘以8
+void weighVariables(const Statement& stmt, int weight, std::unordered_map<std::string, int>& weights);
+
+void weighVariables(const Expression& expr, int weight, std::unordered_map<std::string, int>& weights) {
+    std::vector<const Expression*> stack = {&expr};
+    while (!stack.empty()) {
+        const Expression* node = stack.back();
+        stack.pop_back();
+        if (auto var = dynamic_cast<const Variable*>(node)) {
+            weights[var->name] += weight;
+        } else if (auto op = dynamic_cast<const BinaryOp*>(node)) {
+            stack.push_back(op->right.get());
+            stack.push_back(op->left.get());
+        } else if (auto call = dynamic_cast<const FunctionCall*>(node)) {
+            for (auto it = call->args.rbegin(); it != call->args.rend(); ++it) {
+                stack.push_back(it->get());
+            }
+        } else if (auto inl = dynamic_cast<const InlinedCall*>(node)) {
+            weighVariables(*inl->body, weight, weights);
+        }
+    }
+}
+
+void weighVariables(const Statement& stmt, int weight, std::unordered_map<std::string, int>& weights) {
+    if (auto decl = dynamic_cast<const VariableDecl*>(&stmt)) {
+        weights[decl->varName->name] += weight;
+        if (decl->value) weighVariables(*decl->value, weight, weights);
+    } else if (auto assign = dynamic_cast<const Assignment*>(&stmt)) {
+        weights[assign->varName->name] += weight;
+        weighVariables(*assign->value, weight, weights);
+    } else if (auto ret = dynamic_cast<const ReturnStmt*>(&stmt)) {
+        if (ret->value) weighVariables(*ret->value, weight, weights);
+    } else if (auto print = dynamic_cast<const PrintlnIntStmt*>(&stmt)) {
+        weighVariables(*print->arg, weight, weights);
+    } else if (auto exprStmt = dynamic_cast<const ExpressionStatement*>(&stmt)) {
+        weighVariables(*exprStmt->expr, weight, weights);
+    } else if (auto block = dynamic_cast<const Block*>(&stmt)) {
+        for (const auto& s : block->statements) weighVariables(*s, weight, weights);
+    } else if (auto cond = dynamic_cast<const ConditionStatement*>(&stmt)) {
+        weighVariables(*cond->condition, weight, weights);
+        weighVariables(*cond->thenBlock, weight, weights);
+        if (cond->elseBlock) weighVariables(*cond->elseBlock, weight, weights);
+    } else if (auto loop = dynamic_cast<const LoopStatement*>(&stmt)) {
+        int inner = std::min(weight * 8, 1 << 24);
+        weighVariables(*loop->condition, inner, weights);
+        weighVariables(*loop->body, inner, weights);
+    } else if (auto inlRet = dynamic_cast<const InlineReturn*>(&stmt)) {
+        if (inlRet->value) weighVariables(*inlRet->value, weight, weights);
+    }
+}
+
+} // namespace
+
+CodeGenX64::CodeGenX64(std::unique_ptr<Program> ast, CodeGenOptions options)
+    : ast_(std::move(ast)), options_(options) {
+    if (!options_.output) options_.output = &std::cout;
+}
+
+CodeGenX64::CodeGenX64(CodeGenOptions options) : CodeGenX64(nullptr, options) {}
+
+void CodeGenX64::generateCode() {
+    beginProgram();
+    for (const auto& func : ast_->functions) {
+        declareFunction(func->name, static_cast<int>(func->params.size()));
+    }
+    for (const auto& func : ast_->functions) {
+        generateFunction(*func);
+    }
+    endProgram();
+}
+
+void CodeGenX64::beginProgram() {
+    emit(".intel_syntax noprefix");
+    emit(".global main");
+    emit(".extern printf");
+    if (options_.fastPrint) {
+        emit(".extern println_int");
+    }
+    if (options_.profileGenerate) {
+        emit(".extern profile_start");
+    }
+
+    emit(".data");
+    emit("format_str: .asciz \"%d\\n\""); // printf格式字符串
+
+    emit(".text");
+    emit("");
+}
+
+void CodeGenX64::declareFunction(const std::string& name, int paramCount) {
+    // 调用约定与被调用者无关，不需要其他函数的签名
+    (void)name;
+    (void)paramCount;
+}
+
+void CodeGenX64::generateFunction(const FunctionDecl& func) {
+    if (options_.cache && options_.cacheKeys) {
+        genCachedFunction(func);
+    } else {
+        genFunctionDecl(func);
+    }
+}
+
+void CodeGenX64::endProgram() {
+    if (options_.profileGenerate) {
+        emitProfileData();
+    }
+    emit(".section .note.GNU-stack,\"\",@progbits"); // 不需要可执行栈
+}
+
+/**
+ * @brief 为参数和局部变量分配位置
+ * @param leaf 函数中没有调用
+ * @param redZone 输出：栈帧是否放在红区中
+ * @param frameSize 输出：需要从rsp中减去的字节数
+ */
+void CodeGenX64::allocateHomes(const FunctionDecl& func, bool leaf, bool& redZone, int& frameSize) {
+    homes_.clear();
+    saved_regs_.clear();
+
+    // 变量按出现顺序收集，参数在前
+    std::vector<std::string> names;
+    for (const auto& param : func.params) {
+        names.push_back(param.second);
+    }
+    forEachVariable(*func.body, [&](const std::string& name) {
+        if (std::find(names.begin(), names.end(), name) == names.end()) {
+            names.push_back(name);
+        }
+    });
+
+    std::unordered_map<std::string, int> weights;
+    weighVariables(*func.body, 1, weights);
+    std::vector<std::string> byWeight = names;
+    std::stable_sort(byWeight.begin(), byWeight.end(), [&](const std::string& a, const std::string& b) {
+        return weights[a] > weights[b];
+    });
+
+    for (int i = 0; i < static_cast<int>(byWeight.size()) && i < kVariableRegisterCount; ++i) {
+        if (weights[byWeight[i]] == 0) break;
+        homes_[byWeight[i]] = kVariableRegisters[i];
+    }
+
+    // 被调用者保存寄存器的保存区在最上方，其后是栈上的变量
+    int offset = 0;
+    for (int i = 0; i < kVariableRegisterCount; ++i) {
+        bool used = false;
+        for (const auto& entry : homes_) {
+            if (entry.second == kVariableRegisters[i]) used = true;
+        }
+        if (!used) continue;
+        offset += 8;
+        saved_regs_.push_back({reg64(kVariableRegisters[i]), "QWORD PTR [rbp-" + std::to_string(offset) + "]"});
+    }
+    for (size_t i = 0; i < func.params.size(); ++i) {
+        const std::string& name = func.params[i].second;
+        if (homes_.count(name)) continue;
+        if (static_cast<int>(i) >= kArgRegisterCount) {
+            // 栈上传入的参数直接使用调用者的参数区
+            homes_[name] = "DWORD PTR [rbp+" + std::to_string(16 + (i - kArgRegisterCount) * 8) + "]";
+            continue;
+        }
+        offset += 4;
+        homes_[name] = "DWORD PTR [rbp-" + std::to_string(offset) + "]";
+    }
+    for (const auto& name : names) {
+        if (homes_.count(name)) continue;
+        offset += 4;
+        homes_[name] = "DWORD PTR [rbp-" + std::to_string(offset) + "]";
+    }
+
+    frameSize = (offset + 15) / 16 * 16;
+    // 叶子函数不会压栈时，变量可以直接放在rsp下方的红区
+    redZone = leaf && body_label_.empty() && frameSize <= kRedZoneSize &&
+              tempsNeeded(*func.body) <= static_cast<int>(temp_registers_.size());
+    if (redZone) frameSize = 0;
+}
+
+/**
+ * @brief 通过增量编译缓存生成函数：命中时直接输出缓存的汇编，未命中时生成并保存
+ */
+void CodeGenX64::genCachedFunction(const FunctionDecl& func) {
+    std::string key = options_.cacheKeys->key(func);
+    std::string text;
+    if (!options_.cache->lookup(key, text)) {
+        capture_ = &text;
+        try {
+            genFunctionDecl(func);
+        } catch (...) {
+            capture_ = nullptr;
+            throw;
+        }
+        capture_ = nullptr;
+        options_.cache->store(key, text);
+    }
+    emitText(text);
+}
+
+void CodeGenX64::genFunctionDecl(const FunctionDecl& func) {
+    current_function_name_ = func.name;
+    current_function_ = &func;
+    label_count_ = 0;
+    temps_in_use_.clear();
+    loop_labels_ = {};
+    stack_depth_ = 0;
+    if (!func.memoTarget.empty()) {
+        genMemoWrapper(func);
+        return;
+    }
+
+    // 有自递归尾调用时函数体是一个循环
+    body_label_.clear();
+    bool hasTailCalls = false;
+    forEachStatement(*func.body, [&](const Statement& stmt) {
+        auto ret = dynamic_cast<const ReturnStmt*>(&stmt);
+        auto call = ret && ret->tailCall ? dynamic_cast<const FunctionCall*>(ret->value.get()) : nullptr;
+        if (call) hasTailCalls = true;
+        if (call && call->functionName == func.name && body_label_.empty()) {
+            body_label_ = newLabel();
+        }
+    });
+
+    bool redZone = false;
+    int frameSize = 0;
+    // 插桩的main要调用profile_start，不是叶子函数
+    bool profileStart = options_.profileGenerate && func.name == "main";
+    allocateHomes(func, !hasCalls(*func.body) && !hasTailCalls && !profileStart, redZone, frameSize);
+
+    emit(func.name + ":");
+    emit("  push rbp");
+    emit("  mov rbp, rsp");
+    if (frameSize > 0) {
+        emit("  sub rsp, " + std::to_string(frameSize));
+    }
+    for (const auto& saved : saved_regs_) {
+        emit("  mov " + saved.second + ", " + saved.first);
+    }
+    for (size_t i = 0; i < func.params.size(); ++i) {
+        std::string target = home(func.params[i].second);
+        if (static_cast<int>(i) < kArgRegisterCount) {
+            emit("  mov " + target + ", " + kArgRegisters32[i]);
+        } else if (isRegister(target)) {
+            emit("  mov " + target + ", DWORD PTR [rbp+" + std::to_string(16 + (i - kArgRegisterCount) * 8) + "]");
+        }
+    }
+    if (profileStart) {
+        emitProfileStart();
+    }
+
+    if (!body_label_.empty()) {
+        emit(body_label_ + ":");
+    }
+
+    genBlock(*func.body);
+
+    if (func.body->statements.empty() ||
+        !dynamic_cast<const ReturnStmt*>(func.body->statements.back().get())) {
+        emit("  mov eax, 0");
+        emitEpilogue();
+    }
+    emit("");
+}
+
+/**
+ * @brief 记忆化的包装函数（Memoizer）：按实参查表，命中时直接返回，否则调用func.memoTarget并写入表项。
+ *        只使用eax、rcx、edx（最多3个参数，在edi、esi、edx中，查表时保持不变）
+ */
+void CodeGenX64::genMemoWrapper(const FunctionDecl& func) {
+    int paramCount = static_cast<int>(func.params.size());
+    std::vector<MemoLayout> parts = memoLayout(paramCount);
+    std::string table = memoTableSymbol(func.name);
+    std::vector<std::string> lookups, misses;
+    for (size_t i = 0; i < parts.size(); ++i) {
+        lookups.push_back(i > 0 ? newLabel() : std::string()); // 第一部分从函数入口开始
+        misses.push_back(newLabel());
+    }
+    auto field = [](int offset) {
+        return "DWORD PTR [rcx" + (offset ? "+" + std::to_string(offset) : std::string()) + "]";
+    };
+
+    emit(func.name + ":");
+    for (size_t part = 0; part < parts.size(); ++part) {
+        const MemoLayout& layout = parts[part];
+        if (part > 0) emit(lookups[part] + ":");
+        emit("  mov eax, edi");
+        if (layout.direct) {
+            emit("  cmp eax, " + std::to_string(layout.entries));
+            emit("  jae " + lookups[part + 1]); // 超出直接映射的范围（包括负数）时查后面的哈希表
+        } else {
+            for (int i = 1; i < paramCount; ++i) {
+                emit("  imul eax, " + std::to_string(kMemoHashMultiplier));
+                emit("  add eax, " + std::string(kArgRegisters32[i]));
+            }
+            emit("  and eax, " + std::to_string(layout.entries - 1));
+        }
+        emit("  imul rax, " + std::to_string(layout.entrySize));
+        emit("  lea rcx, [rip+" + table + "]");
+        emit("  add rcx, rax");
+        if (layout.offset) {
+            emit("  add rcx, " + std::to_string(layout.offset));
+        }
+        emit("  cmp " + field(layout.validOffset) + ", 0");
+        emit("  je " + misses[part]);
+        if (!layout.direct) {
+            for (int i = 0; i < paramCount; ++i) {
+                emit("  cmp " + field(i * 4) + ", " + kArgRegisters32[i]);
+                emit("  jne " + misses[part]);
+            }
+        }
+        emit("  mov eax, " + field(layout.valueOffset));
+        emit("  ret");
+    }
+
+    // 未命中：保存表项地址（哈希表还有实参），调用原函数体后写入表项
+    for (size_t part = 0; part < parts.size(); ++part) {
+        const MemoLayout& layout = parts[part];
+        emit(misses[part] + ":");
+        emit("  push rbp");
+        emit("  mov rbp, rsp");
+        emit("  push rcx");
+        int keys = layout.direct ? 0 : paramCount;
+        for (int i = 0; i < keys; ++i) {
+            emit("  push " + std::string(kArgRegisters64[i]));
+        }
+        if (keys % 2 == 0) {
+            emit("  sub rsp, 8"); // 调用前rsp按16字节对齐
+        }
+        emit("  call " + func.memoTarget);
+        emit("  mov rcx, QWORD PTR [rbp-8]");
+        for (int i = 0; i < keys; ++i) {
+            emit("  mov edx, DWORD PTR [rbp-" + std::to_string(16 + i * 8) + "]");
+            emit("  mov " + field(i * 4) + ", edx");
+        }
+        emit("  mov " + field(layout.valueOffset) + ", eax");
+        emit("  mov " + field(layout.validOffset) + ", 1");
+        emit("  leave");
+        emit("  ret");
+    }
+
+    emit(".data");
+    emit(".p2align 3");
+    emit(table + ":");
+    emit(".zero " + std::to_string(memoTableSize(paramCount)));
+    emit(".text");
+    emit("");
+}
+
+void CodeGenX64::emitEpilogue() {
+    for (const auto& saved : saved_regs_) {
+        emit("  mov " + saved.first + ", " + saved.second);
+    }
+    emit("  leave");
+    emit("  ret");
+}
+
+void CodeGenX64::genBlock(const Block& block) {
+    for (const auto& stmt : block.statements) {
+        genStatement(*stmt);
+    }
+}
+
+void CodeGenX64::genStatement(const Statement& stmt) {
+    if (auto decl = dynamic_cast<const VariableDecl*>(&stmt)) {
+        if (decl->value) {
+            genExpression(*decl->value);
+            emit("  mov " + home(decl->varName->name) + ", eax");
+        }
+    } else if (auto assign = dynamic_cast<const Assignment*>(&stmt)) {
+        genExpression(*assign->value);
+        emit("  mov " + home(assign->varName->name) + ", eax");
+    } else if (auto ret = dynamic_cast<const ReturnStmt*>(&stmt)) {
+        genReturn(*ret);
+    } else if (auto print = dynamic_cast<const PrintlnIntStmt*>(&stmt)) {
+        genPrintlnInt(*print);
+    } else if (auto block = dynamic_cast<const Block*>(&stmt)) {
+        genBlock(*block);
+    } else if (auto cond = dynamic_cast<const ConditionStatement*>(&stmt)) {
+        genCondition(*cond);
+    } else if (auto loop = dynamic_cast<const LoopStatement*>(&stmt)) {
+        genLoop(*loop);
+    } else if (dynamic_cast<const BreakStmt*>(&stmt)) {
+        if (loop_labels_.second.empty()) throw std::runtime_error("Break statement not inside a loop");
+        emit("  jmp " + loop_labels_.second);
+    } else if (dynamic_cast<const ContinueStmt*>(&stmt)) {
+        if (loop_labels_.first.empty()) throw std::runtime_error("Continue statement not inside a loop");
+        emit("  jmp " + loop_labels_.first);
+    } else if (auto exprStmt = dynamic_cast<const ExpressionStatement*>(&stmt)) {
+        genExpression(*exprStmt->expr);
+    } else if (auto inlRet = dynamic_cast<const InlineReturn*>(&stmt)) {
+        genInlineReturn(*inlRet);
+    } else {
+        throw std::runtime_error("Unknown statement type");
+    }
+}
+
+void CodeGenX64::genCondition(const ConditionStatement& cond) {
+    std::string elseLabel = newLabel();
+    std::string endLabel = newLabel();
+    genExpression(*cond.condition);
+    emit("  cmp eax, 0");
+
+    if (cond.elseBlock && options_.profile && options_.profile->preferElse(cond.profileSite)) {
+        // profile中else分支更常执行：else部分直接落入，then部分放在后面
+        std::string thenLabel = elseLabel;
+        emit("  jne " + thenLabel);
+        emitProfileCount(cond.profileSite, 1);
+        genBlock(*cond.elseBlock);
+        emit("  jmp " + endLabel);
+
+        emit(thenLabel + ":");
+        emitProfileCount(cond.profileSite, 0);
+        genBlock(*cond.thenBlock);
+        emit(endLabel + ":");
+        return;
+    }
+
+    emit("  je " + elseLabel);
+
+    emitProfileCount(cond.profileSite, 0);
+    genBlock(*cond.thenBlock);
+    emit("  jmp " + endLabel);
+
+    emit(elseLabel + ":");
+    emitProfileCount(cond.profileSite, 1);
+    if (cond.elseBlock) {
+        genBlock(*cond.elseBlock);
+    }
+    emit(endLabel + ":");
+}
+
+void CodeGenX64::genLoop(const LoopStatement& loop) {
+    std::string startLabel = newLabel();
+    std::string endLabel = newLabel();
+
+    auto outerLabels = loop_labels_;
+    loop_labels_ = {startLabel, endLabel};
+
+    const Profile* profile = options_.profile;
+    bool hot = profile && profile->hotLoop(loop.profileSite);
+    emitProfileCount(loop.profileSite, 0);
+
+    if (profile && profile->rotateLoop(loop.profileSite)) {
+        // profile中平均不止一次迭代：条件判断放在循环体之后，continue跳到条件判断
+        std::string bodyLabel = newLabel();
+        emit("  jmp " + startLabel);
+        if (hot) {
+            emit(".p2align 4");
+        }
+        emit(bodyLabel + ":");
+        emitProfileCount(loop.profileSite, 1);
+        genBlock(*loop.body);
+
+        emit(startLabel + ":");
+        genExpression(*loop.condition);
+        emit("  cmp eax, 0");
+        emit("  jne " + bodyLabel);
+        emit(endLabel + ":");
+        loop_labels_ = outerLabels;
+        return;
+    }
+
+    if (hot) {
+        emit(".p2align 4");
+    }
+    emit(startLabel + ":");
+    genExpression(*loop.condition);
+    emit("  cmp eax, 0");
+    emit("  je " + endLabel);
+
+    emitProfileCount(loop.profileSite, 1);
+    genBlock(*loop.body);
+
+    emit("  jmp " + startLabel);
+    emit(endLabel + ":");
+
+    loop_labels_ = outerLabels;
+}
+
+void CodeGenX64::genReturn(const ReturnStmt& ret) {
+    auto call = ret.tailCall ? dynamic_cast<const FunctionCall*>(ret.value.get()) : nullptr;
+    if (call && genTailCall(*call)) {
+        return;
+    }
+    if (ret.value) {
+        genExpression(*ret.value);
+    } else {
+        emit("  mov eax, 0");
+    }
+    emitEpilogue();
+}
+
+/**
+ * @brief 尾调用：自递归把实参写入参数位置后跳回函数体开头，
+ *        其他不超过6个参数的调用装入参数寄存器后 leave + jmp
+ */
+bool CodeGenX64::genTailCall(const FunctionCall& call) {
+    bool self = call.functionName == current_function_name_;
+    int argCount = static_cast<int>(call.args.size());
+    if (!self && argCount > kArgRegisterCount) {
+        return false;
+    }
+    emitProfileCount(call.profileSite, 0);
+
+    // 实参可能引用当前参数，先全部求值再统一写回
+    for (int i = argCount - 1; i >= 0; --i) {
+        genExpression(*call.args[i]);
+        emitPush("eax");
+    }
+    if (self) {
+        const FunctionDecl& func = *current_function_;
+        for (int i = 0; i < argCount; ++i) {
+            std::string target = home(func.params[i].second);
+            if (isRegister(target)) {
+                emitPop(target);
+            } else {
+                emitPop("eax");
+                emit("  mov " + target + ", eax");
+            }
+        }
+        emit("  jmp " + body_label_);
+    } else {
+        for (int i = 0; i < argCount; ++i) {
+            emitPop(kArgRegisters32[i]);
+        }
+        for (const auto& saved : saved_regs_) {
+            emit("  mov " + saved.first + ", " + saved.second);
+        }
+        emit("  leave");
+        emit("  jmp " + call.functionName);
+    }
+    return true;
+}
+
+void CodeGenX64::genPrintlnInt(const PrintlnIntStmt& print) {
+    genExpression(*print.arg);
+
+    auto saved = saveTemps();
+    bool pad = stack_depth_ % 16 != 0;
+    if (pad) {
+        emit("  sub rsp, 8");
+    }
+    if (options_.fastPrint) {
+        emit("  mov edi, eax");
+        emit("  call println_int@PLT");
+    } else {
+        emit("  mov esi, eax");
+        emit("  lea rdi, [rip+format_str]");
+        emit("  xor eax, eax"); // 可变参数函数：al为向量寄存器参数个数
+        emit("  call printf@PLT");
+    }
+    if (pad) {
+        emit("  add rsp, 8");
+    }
+    restoreTemps(saved);
+}
+
+/**
+ * @brief 生成表达式，结果在eax中
+ *
+ * 与CodeGen::genExpression相同，二元运算和函数调用用显式栈按求值顺序遍历，
+ * 不随表达式的长度或嵌套深度递归。右操作数不是常量或变量时，
+ * 求值右操作数期间左操作数放在临时寄存器中，没有空闲的寄存器时压栈。
+ */
+void CodeGenX64::genExpression(const Expression& expr) {
+    struct Frame {
+        const Expression* expr;
+        size_t done;        // 已生成的子节点个数
+        std::string temp;   // 二元运算：保存左操作数的临时寄存器，为空时在栈上
+        PendingCall call;   // 函数调用：beginFunctionCall的结果
+    };
+    std::vector<Frame> stack;
+    stack.push_back({&expr, 0, "", {}});
+    while (!stack.empty()) {
+        Frame& frame = stack.back();
+        const Expression* next = nullptr;
+        if (auto op = dynamic_cast<const BinaryOp*>(frame.expr)) {
+            if (frame.done == 0) {
+                next = op->left.get();
+            } else if (frame.done == 1 && isSimple(*op->right)) {
+                genBinaryOp(*op, simpleOperand(*op->right));
+            } else if (frame.done == 1) {
+                frame.temp = acquireTemp();
+                if (!frame.temp.empty()) {
+                    emit("  mov " + frame.temp + ", eax");
+                } else {
+                    emitPush("eax");
+                }
+                next = op->right.get();
+            } else {
+                emit("  mov ecx, eax");
+                if (!frame.temp.empty()) {
+                    emit("  mov eax, " + frame.temp);
+                    releaseTemp(frame.temp);
+                } else {
+                    emitPop("eax");
+                }
+                genBinaryOp(*op, "ecx");
+            }
+        } else if (auto call = dynamic_cast<const FunctionCall*>(frame.expr)) {
+            if (frame.done == 0) {
+                frame.call = beginFunctionCall(*call);
+            } else {
+                emitPush("eax");
+            }
+            if (frame.done < frame.call.order.size()) {
+                next = call->args[frame.call.order[frame.done]].get();
+            } else {
+                endFunctionCall(*call, frame.call);
+            }
+        } else if (auto lit = dynamic_cast<const IntegerLiteral*>(frame.expr)) {
+            emit("  mov eax, " + std::to_string(lit->value));
+        } else if (auto var = dynamic_cast<const Variable*>(frame.expr)) {
+            emit("  mov eax, " + home(var->name));
+        } else if (auto inl = dynamic_cast<const InlinedCall*>(frame.expr)) {
+            genInlinedCall(*inl);
+        }
+
+        if (next) {
+            frame.done++;
+            stack.push_back({next, 0, "", {}});
+        } else {
+            stack.pop_back();
+        }
+    }
+}
+
+/**
+ * @brief 函数调用的开始：保存正在使用的临时寄存器，按需对齐栈，
+ *        返回需要求值并压栈的实参（从右到左；不超过6个参数时跳过常量和变量）
+ */
+CodeGenX64::PendingCall CodeGenX64::beginFunctionCall(const FunctionCall& call) {
+    // 调用者保存：只保存正在使用的临时寄存器
+    PendingCall pending;
+    pending.saved = saveTemps();
+
+    int argCount = static_cast<int>(call.args.size());
+    int stackArgs = std::max(0, argCount - kArgRegisterCount);
+    bool pad = (stack_depth_ + stackArgs * 8) % 16 != 0;
+    if (pad) {
+        emit("  sub rsp, 8");
+        stack_depth_ += 8;
+    }
+    pending.cleanup = stackArgs * 8 + (pad ? 8 : 0);
+
+    for (int i = argCount - 1; i >= 0; --i) {
+        if (argCount <= kArgRegisterCount && isSimple(*call.args[i])) continue;
+        pending.order.push_back(i);
+    }
+    return pending;
+}
+
+/**
+ * @brief 函数调用的结束：pending.order中的实参已依次压栈，装入参数寄存器后调用并恢复临时寄存器
+ */
+void CodeGenX64::endFunctionCall(const FunctionCall& call, const PendingCall& pending) {
+    int argCount = static_cast<int>(call.args.size());
+    if (argCount <= kArgRegisterCount) {
+        // 复杂实参依次弹出到参数寄存器；常量和变量最后直接装入
+        for (auto it = pending.order.rbegin(); it != pending.order.rend(); ++it) {
+            emitPop(kArgRegisters32[*it]);
+        }
+        for (int i = 0; i < argCount; ++i) {
+            if (isSimple(*call.args[i])) {
+                emit("  mov " + std::string(kArgRegisters32[i]) + ", " + simpleOperand(*call.args[i]));
+            }
+        }
+    } else {
+        for (int i = 0; i < kArgRegisterCount; ++i) {
+            emitPop(kArgRegisters32[i]);
+        }
+    }
+
+    emitProfileCount(call.profileSite, 0);
+    emit("  call " + call.functionName);
+
+    if (pending.cleanup > 0) {
+        emit("  add rsp, " + std::to_string(pending.cleanup));
+        stack_depth_ -= pending.cleanup;
+    }
+    restoreTemps(pending.saved);
+}
+
+/**
+ * @brief 二元运算：左操作数在eax中，右操作数为rhs（ecx、常量或变量的位置）
+ */
+void CodeGenX64::genBinaryOp(const BinaryOp& op, std::string rhs) {
+    if (op.op == "+") {
+        emit("  add eax, " + rhs);
+    } else if (op.op == "-") {
+        emit("  sub eax, " + rhs);
+    } else if (op.op == "*") {
+        emit("  imul eax, " + rhs);
+    } else if (op.op == "/" || op.op == "%") {
+        if (!isRegister(rhs) && rhs.find('[') == std::string::npos) {
+            emit("  mov ecx, " + rhs); // idiv不接受立即数
+            rhs = "ecx";
+        }
+        emit("  cdq");
+        emit("  idiv " + rhs);
+        if (op.op == "%") {
+            emit("  mov eax, edx");
+        }
+    } else if (op.op == "==" || op.op == "!=" || op.op == "<" ||
+               op.op == "<=" || op.op == ">" || op.op == ">=") {
+        static const std::unordered_map<std::string, std::string> setcc = {
+            {"==", "sete"}, {"!=", "setne"}, {"<", "setl"},
+            {"<=", "setle"}, {">", "setg"}, {">=", "setge"}};
+        emit("  cmp eax, " + rhs);
+        emit("  " + setcc.at(op.op) + " al");
+        emit("  movzx eax, al");
+    } else if (op.op == "|" || op.op == "||") {
+        emit("  or eax, " + rhs);
+    } else if (op.op == "&" || op.op == "&&") {
+        emit("  and eax, " + rhs);
+    } else if (op.op == "^") {
+        emit("  xor eax, " + rhs);
+    } else {
+        throw std::runtime_error("Unknown binary operator: " + op.op);
+    }
+}
+
+void CodeGenX64::genInlinedCall(const InlinedCall& call) {
+    std::string joinLabel = newLabel();
+
+    const InlineReturn* outerTail = inline_tail_;
+    inline_tail_ = nullptr;
+    const Statement* last = call.body.get();
+    while (auto block = dynamic_cast<const Block*>(last)) {
+        if (block->statements.empty()) break;
+        last = block->statements.back().get();
+    }
+    if (auto ret = dynamic_cast<const InlineReturn*>(last)) {
+        inline_tail_ = ret;
+    }
+
+    emitProfileCount(call.profileSite, 0);
+    inline_exits_.push_back(joinLabel);
+    genBlock(*call.body);
+    inline_exits_.pop_back();
+    inline_tail_ = outerTail;
+
+    emit(joinLabel + ":");
+}
+
+void CodeGenX64::emitProfileCount(int site, int index) {
+    if (!options_.profileGenerate || site < 0) return;
+    emit("  add QWORD PTR [rip+profile_counters+" + std::to_string((site * 2 + index) * 8) + "], 1");
+}
+
+// main开始时（栈帧建立后rsp按16字节对齐）向运行时库登记计数器和profile文件的路径
+void CodeGenX64::emitProfileStart() {
+    emit("  lea rdi, [rip+profile_counters]");
+    emit("  lea rsi, [rip+profile_counters_end]");
+    emit("  lea rdx, [rip+profile_path]");
+    emit("  call profile_start@PLT");
+}
+
+void CodeGenX64::emitProfileData() {
+    std::string path;
+    for (char c : options_.profilePath) {
+        if (c == '\\' || c == '"') path += '\\';
+        path += c;
+    }
+    emit(".data");
+    emit(".p2align 3");
+    emit("profile_counters:");
+    emit(".zero " + std::to_string(options_.profileSites * 16));
+    emit("profile_counters_end:");
+    emit("profile_path: .asciz \"" + path + "\"");
+}
+
+void CodeGenX64::genInlineReturn(const InlineReturn& ret) {
+    if (ret.value) {
+        genExpression(*ret.value);
+    } else {
+        emit("  mov eax, 0");
+    }
+    if (&ret != inline_tail_) {
+        emit("  jmp " + inline_exits_.back());
+    }
+}
+
+std::string CodeGenX64::acquireTemp() {
+    for (const auto& reg : temp_registers_) {
+        if (std::find(temps_in_use_.begin(), temps_in_use_.end(), reg) == temps_in_use_.end()) {
+            temps_in_use_.push_back(reg);
+            return reg;
+        }
+    }
+    return "";
+}
+
+void CodeGenX64::releaseTemp(const std::string& reg) {
+    temps_in_use_.erase(std::find(temps_in_use_.begin(), temps_in_use_.end(), reg));
+}
+
+std::vector<std::string> CodeGenX64::saveTemps() {
+    std::vector<std::string> saved = temps_in_use_;
+    for (const auto& reg : saved) {
+        emitPush(reg);
+    }
+    return saved;
+}
+
+void CodeGenX64::restoreTemps(const std::vector<std::string>& saved) {
+    for (auto it = saved.rbegin(); it != saved.rend(); ++it) {
+        emitPop(*it);
+    }
+}
+
+void CodeGenX64::emitPush(const std::string& reg) {
+    emit("  push " + reg64(reg));
+    stack_depth_ += 8;
+}
+
+void CodeGenX64::emitPop(const std::string& reg) {
+    emit("  pop " + reg64(reg));
+    stack_depth_ -= 8;
+}
+
+bool CodeGenX64::isSimple(const Expression& expr) const {
+    return dynamic_cast<const IntegerLiteral*>(&expr) || dynamic_cast<const Variable*>(&expr);
+}
+
+std::string CodeGenX64::simpleOperand(const Expression& expr) {
+    if (auto lit = dynamic_cast<const IntegerLiteral*>(&expr)) {
+        return std::to_string(lit->value);
+    }
+    return home(static_cast<const Variable&>(expr).name);
+}
+
+std::string CodeGenX64::home(const std::string& name) {
+    auto it = homes_.find(name);
+    if (it == homes_.end()) {
+        throw std::runtime_error("Unknown variable: " + name);
+    }
+    return it->second;
+}
+
+void CodeGenX64::emit(const std::string& code) {
+    if (capture_) {
+        *capture_ += code;
+        *capture_ += '\n';
+        return; // 由emitText统计
+    }
+    if (options_.stats) {
+        options_.stats->countAsmLine(code);
+    }
+    if (options_.assembler) {
+        options_.assembler->addLine(code);
+    } else {
+        *options_.output << code << '\n';
+    }
+}
+
+void CodeGenX64::emitText(const std::string& text) {
+    if (options_.stats) {
+        options_.stats->countAsmText(text);
+    }
+    if (options_.assembler) {
+        size_t begin = 0;
+        while (begin < text.size()) {
+            size_t end = text.find('\n', begin);
+            if (end == std::string::npos) end = text.size();
+            options_.assembler->addLine(text.substr(begin, end - begin));
+            begin = end + 1;
+        }
+    } else {
+        *options_.output << text;
+    }
+}
+
+// 标签按函数编号，函数的汇编不依赖于其他函数，缓存的汇编可以直接拼接
+std::string CodeGenX64::newLabel() {
+    return ".L" + current_function_name_ + "_" + std::to_string(label_count_++);
+}
@@ -0,0 +1,99 @@
+#ifndef CODEGENX64_H
+#define CODEGENX64_H
+
+#include "CodeGen.h"
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * x86-64 System V 后端
+ *   - 参数依次通过 edi、esi、edx、ecx、r8d、r9d 传递，其余参数在栈上
+ *   - 调用前保持rsp按16字节对齐
+ *   - 变量按引用次数（循环内加权）分配到被调用者保存寄存器 ebx、r12d~r15d，其余放在栈上
+ *   - 表达式临时值优先放在 r8d~r11d，只在调用前后保存正在使用的临时寄存器
+ *   - 叶子函数的栈帧放在红区中，不调整rsp
+ * 运算仍按32位int进行，ecx作为右操作数的暂存寄存器，edx被idiv使用。
+ */
+class CodeGenX64 {
+public:
+    CodeGenX64(std::unique_ptr<Program> ast, CodeGenOptions options = CodeGenOptions());
+    void generateCode();
+
+    // 流式生成，与CodeGen相同
+    explicit CodeGenX64(CodeGenOptions options);
+    void beginProgram();
+    void declareFunction(const std::string& name, int paramCount);
+    bool needsSignatures() const { return false; }
+    void generateFunction(const FunctionDecl& func);
+    void endProgram();
+
+private:
+    std::unique_ptr<Program> ast_;
+    CodeGenOptions options_;
+    int label_count_ = 0;            // 每个函数从0开始
+    std::string* capture_ = nullptr; // 不为空时emit写入这里（生成缓存条目）
+
+    // 当前函数的状态
+    std::string current_function_name_;
+    const FunctionDecl* current_function_ = nullptr;
+    std::unordered_map<std::string, std::string> homes_;          // 变量 -> 寄存器或 DWORD PTR [rbp-n]
+    std::vector<std::pair<std::string, std::string>> saved_regs_; // 被调用者保存寄存器及其保存位置
+    std::string body_label_;                                      // 自递归尾调用的跳转目标
+    std::pair<std::string, std::string> loop_labels_;             // 当前循环的 continue/break 目标
+    std::vector<std::string> inline_exits_;
+    const InlineReturn* inline_tail_ = nullptr;
+    int stack_depth_ = 0; // 栈帧建立后压栈的字节数，用于调用前对齐
+
+    // 表达式临时寄存器
+    const std::vector<std::string> temp_registers_ = {"r8d", "r9d", "r10d", "r11d"};
+    std::vector<std::string> temps_in_use_;
+
+    // 进行中的函数调用（genExpression的显式栈中保存）
+    struct PendingCall {
+        std::vector<std::string> saved; // 调用前保存的临时寄存器
+        std::vector<int> order;         // 依次求值并压栈的实参下标
+        int cleanup = 0;                // 调用后释放的栈字节数
+    };
+
+    void genFunctionDecl(const FunctionDecl& func);
+    void genCachedFunction(const FunctionDecl& func);
+    void genBlock(const Block& block);
+    void genStatement(const Statement& stmt);
+    void genExpression(const Expression& expr);
+    void genReturn(const ReturnStmt& ret);
+    void genPrintlnInt(const PrintlnIntStmt& print);
+    void genBinaryOp(const BinaryOp& op, std::string rhs);
+    PendingCall beginFunctionCall(const FunctionCall& call);
+    void endFunctionCall(const FunctionCall& call, const PendingCall& pending);
+    void genCondition(const ConditionStatement& cond);
+    void genLoop(const LoopStatement& loop);
+    void genInlinedCall(const InlinedCall& call);
+    void genInlineReturn(const InlineReturn& ret);
+    bool genTailCall(const FunctionCall& call);
+    void genMemoWrapper(const FunctionDecl& func);
+
+    // 栈帧与寄存器
+    void allocateHomes(const FunctionDecl& func, bool leaf, bool& redZone, int& frameSize);
+    std::string acquireTemp();
+    void releaseTemp(const std::string& reg);
+    std::vector<std::string> saveTemps();
+    void restoreTemps(const std::vector<std::string>& saved);
+    void emitPush(const std::string& reg);
+    void emitPop(const std::string& reg);
+    void emitEpilogue();
+    void emitProfileCount(int site, int index); // 与CodeGen相同
+    void emitProfileStart();
+    void emitProfileData();
+
+    // 工具方法
+    bool isSimple(const Expression& expr) const;
+    std::string simpleOperand(const Expression& expr);
+    std::string home(const std::string& name);
+    void emit(const std::string& code);
+    void emitText(const std::string& text);
+    std::string newLabel();
+};
+
+#endif // CODEGENX64_H
@@ -0,0 +1,62 @@
+#include "Compiler.h"
+#include <sstream>
+
+Diagnostic diagnosticAt(const std::string& source, const std::string& message, size_t offset) {
+    Diagnostic diagnostic;
+    diagnostic.message = message;
+    diagnostic.line = 1;
+    diagnostic.column = 1;
+    for (size_t i = 0; i < offset && i < source.size(); ++i) {
+        if (source[i] == '\n') {
+            diagnostic.line++;
+            diagnostic.column = 1;
+        } else {
+            diagnostic.column++;
+        }
+    }
+    return diagnostic;
+}
+
+CompileResult compile(const std::string& source, const DriverOptions& options) noexcept {
+    CompileResult result;
+    try {
+        std::ostringstream out;
+        result = compile(source, options, out);
+        if (result.ok) {
+            result.output = out.str();
+        }
+    } catch (...) {
+        result = CompileResult();
+        Diagnostic diagnostic;
+        diagnostic.message = "internal compiler error";
+        result.diagnostics.push_back(diagnostic);
+    }
+    return result;
+}
+
+CompileResult compile(const std::string& source, const DriverOptions& options, std::ostream& out) noexcept {
+    CompileResult result;
+    try {
+        compileSource(source, options, out);
+        result.ok = true;
+    } catch (const SyntaxError& e) {
+        result.diagnostics.push_back(diagnosticAt(source, e.what(), e.offset));
+    } catch (const std::exception& e) {
+        Diagnostic diagnostic;
+        diagnostic.message = e.what();
+        result.diagnostics.push_back(diagnostic);
+    } catch (...) {
+        Diagnostic diagnostic;
+        diagnostic.message = "internal compiler error";
+        result.diagnostics.push_back(diagnostic);
+    }
+    return result;
+}
+
+std::string formatDiagnostic(const std::string& file, const Diagnostic& diagnostic) {
+    std::string text = file;
+    if (diagnostic.line > 0) {
+        text += ":" + std::to_string(diagnostic.line) + ":" + std::to_string(diagnostic.column);
+    }
+    return text + ": error: " + diagnostic.message;
+}
@@ -0,0 +1,39 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include "Driver.h"
+#include <ostream>
+#include <string>
+#include <vector>
+
+/*
+ * 编译器库接口（compilerlab库）
+ * compile()不抛出异常：词法、语法错误和代码生成中的错误都作为诊断信息返回。
+ * 每次调用只使用自己的局部状态，可以在多个线程中同时调用；
+ * options中的inlineReport、cache由调用者提供，共享时由调用者负责（FunctionCache本身是线程安全的）。
+ */
+struct Diagnostic {
+    std::string message;
+    int line = 0;   // 从1开始，0表示没有位置信息（例如代码生成阶段的错误）
+    int column = 0; // 从1开始，按字节计
+};
+
+struct CompileResult {
+    bool ok = false;
+    std::string output; // 汇编文本；options.emitObject时为ELF目标文件
+    std::vector<Diagnostic> diagnostics;
+};
+
+CompileResult compile(const std::string& source, const DriverOptions& options = DriverOptions()) noexcept;
+
+// 输出直接写到out而不在result.output中缓存（与options.streaming一起使用时内存不随输出增长）；
+// 出错时out中可能已有部分输出
+CompileResult compile(const std::string& source, const DriverOptions& options, std::ostream& out) noexcept;
+
+// 源码中offset处的诊断信息（SyntaxError::offset换算为行号、列号）
+Diagnostic diagnosticAt(const std::string& source, const std::string& message, size_t offset);
+
+// "file:line:column: error: message"，没有位置时为 "file: error: message"
+std::string formatDiagnostic(const std::string& file, const Diagnostic& diagnostic);
+
+#endif // COMPILER_H
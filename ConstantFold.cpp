@@ -0,0 +1,69 @@
+#include "ConstantFold.h"
+#include "ASTUtil.h"
+#include <climits>
+#include <cstdint>
+
+bool evaluateBinaryOp(const std::string& op, int left, int right, int& result) {
+    uint32_t a = static_cast<uint32_t>(left);
+    uint32_t b = static_cast<uint32_t>(right);
+    uint32_t value;
+    if (op == "+") {
+        value = a + b;
+    } else if (op == "-") {
+        value = a - b;
+    } else if (op == "*") {
+        value = a * b;
+    } else if (op == "/" || op == "%") {
+        if (right == 0 || (left == INT_MIN && right == -1)) return false; // idiv会触发异常，留到运行时
+        value = static_cast<uint32_t>(op == "/" ? left / right : left % right);
+    } else if (op == "==") {
+        value = left == right;
+    } else if (op == "!=") {
+        value = left != right;
+    } else if (op == "<") {
+        value = left < right;
+    } else if (op == "<=") {
+        value = left <= right;
+    } else if (op == ">") {
+        value = left > right;
+    } else if (op == ">=") {
+        value = left >= right;
+    } else if (op == "&" || op == "&&") {
+        value = a & b;
+    } else if (op == "|" || op == "||") {
+        value = a | b;
+    } else if (op == "^") {
+        value = a ^ b;
+    } else {
+        return false;
+    }
+    result = static_cast<int>(value);
+    return true;
+}
+
+int ConstantFolder::run(Program& program) {
+    changedFunctions.clear();
+    int folded = 0;
+    for (auto& func : program.functions) {
+        int n = runFunction(*func);
+        if (n > 0) changedFunctions.push_back(func->name);
+        folded += n;
+    }
+    return folded;
+}
+
+int ConstantFolder::runFunction(FunctionDecl& func) {
+    int folded = 0;
+    forEachExprSlot(*func.body, [&](std::unique_ptr<Expression>& slot) {
+        auto op = dynamic_cast<BinaryOp*>(slot.get());
+        if (!op) return;
+        auto left = dynamic_cast<const IntegerLiteral*>(op->left.get());
+        auto right = dynamic_cast<const IntegerLiteral*>(op->right.get());
+        int value;
+        if (left && right && evaluateBinaryOp(op->op, left->value, right->value, value)) {
+            slot = std::make_unique<IntegerLiteral>(value);
+            folded++;
+        }
+    });
+    return folded;
+}
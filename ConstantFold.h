@@ -0,0 +1,27 @@
+#ifndef CONSTANT_FOLD_H
+#define CONSTANT_FOLD_H
+
+#include "Parser.h"
+#include <string>
+#include <vector>
+
+/*
+ * 常量折叠
+ * 两个操作数都是整数字面量的二元运算在编译时求值，按32位补码回绕，结果与生成的代码相同
+ * （&&、||与代码生成一致按位计算）。除数为0和INT_MIN / -1在运行时会触发异常，不折叠。
+ * 后序进行，(1 + 2) * 3 整个折叠为9。
+ */
+class ConstantFolder {
+public:
+    // 返回折叠的运算个数
+    int run(Program& program);
+    int runFunction(FunctionDecl& func);
+
+    // 最近一次run中有折叠的函数（PassManager据此使这些函数的分析结果失效）
+    std::vector<std::string> changedFunctions;
+};
+
+// 计算 left op right（与生成的代码语义相同），不能在编译时求值时返回false
+bool evaluateBinaryOp(const std::string& op, int left, int right, int& result);
+
+#endif // CONSTANT_FOLD_H
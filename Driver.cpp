@@ -0,0 +1,457 @@
+#include "Driver.h"
+#include "Assembler.h"
+#include "CodeGenX64.h"
+#include "ConstantFold.h"
+#include "FunctionCache.h"
+#include "ObjectWriter.h"
+#include "PassManager.h"
+#include "Stats.h"
+#include "SpscQueue.h"
+#include "TailCall.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <thread>
+
+namespace {
+
+// 缓存键包含所有影响代码生成的选项
+std::string cacheSalt(const DriverOptions& options, const CodeGenOptions& codeGen) {
+    std::string passes;
+    for (const auto& pass : options.passes) {
+        passes += (passes.empty() ? "" : ",") + pass;
+    }
+    return std::string(options.targetX64 ? "x86-64" : "i386") +
+           " regcall=" + std::to_string(codeGen.regParams) +
+           " fast-print=" + std::to_string(codeGen.fastPrint) +
+           " passes=" + passes;
+}
+
+bool hasPass(const DriverOptions& options, const char* name) {
+    return std::find(options.passes.begin(), options.passes.end(), name) != options.passes.end();
+}
+
+// 常量折叠和尾调用改写可以逐个函数进行（只需要预扫描得到的签名），流式和流水线编译可用；
+// 内联、遍之间的检查和报告需要整个程序
+bool perFunctionPasses(const DriverOptions& options) {
+    if (options.verifyPasses || options.passReport) return false;
+    for (const auto& pass : options.passes) {
+        if (pass != "fold-constants" && pass != "tail-calls") return false;
+    }
+    return true;
+}
+
+// --profile-generate/--profile-use不带文件名时的profile文件
+const char* const kDefaultProfile = "default.profile";
+
+bool profiling(const DriverOptions& options) {
+    return !options.profileGenerate.empty() || !options.profileUse.empty();
+}
+
+// 每批至少这么多token（流水线编译时词法分析线程交给语法分析线程的单位）
+const size_t kBatchTokens = 1u << 14;
+const size_t kBatchQueueSize = 8;
+const size_t kFunctionQueueSize = 256;
+
+// 流式和流水线编译共用：按顺序运行逐函数的优化遍，再生成这个函数和尾调用改写引入的累加器辅助函数
+template <typename Backend>
+void emitFunction(Backend& backend, std::unique_ptr<FunctionDecl> func, const DriverOptions& options,
+                  CompileStats* stats, TailCallOptimizer& tco, std::unordered_map<std::string, int>& arities) {
+    std::vector<std::unique_ptr<FunctionDecl>> functions;
+    functions.push_back(std::move(func));
+    for (const auto& pass : options.passes) {
+        PhaseTimer timer(stats, pass.c_str());
+        if (pass == "fold-constants") {
+            ConstantFolder folder;
+            for (const auto& function : functions) {
+                folder.runFunction(*function);
+            }
+        } else {
+            std::vector<std::unique_ptr<FunctionDecl>> rewritten;
+            for (auto& function : functions) {
+                tco.runFunction(std::move(function), arities, rewritten);
+            }
+            functions = std::move(rewritten);
+        }
+    }
+
+    PhaseTimer timer(stats, "codegen");
+    // 排在后面的是累加器辅助函数：预扫描时还不存在，要在生成调用它的原函数之前声明
+    for (size_t i = 1; i < functions.size(); ++i) {
+        backend.declareFunction(functions[i]->name, static_cast<int>(functions[i]->params.size()));
+    }
+    for (const auto& generated : functions) {
+        backend.generateFunction(*generated);
+    }
+    if (stats) {
+        stats->functions += functions.size();
+    }
+}
+
+template <typename Backend>
+void streamFunctions(const TokenStream& tokens, const DriverOptions& options, const CodeGenOptions& codeGen) {
+    Backend backend(codeGen);
+    backend.beginProgram();
+
+    Parser parser(tokens);
+    std::unordered_map<std::string, int> arities;
+    {
+        PhaseTimer timer(options.stats, "parse");
+        for (const auto& signature : parser.scanSignatures()) {
+            arities[signature.first] = signature.second;
+        }
+    }
+    for (const auto& entry : arities) {
+        backend.declareFunction(entry.first, entry.second);
+    }
+
+    TailCallOptimizer tco;
+    for (;;) {
+        std::unique_ptr<FunctionDecl> func;
+        {
+            PhaseTimer timer(options.stats, "parse");
+            func = parser.parseNext();
+        }
+        if (!func) break;
+        if (options.stats) {
+            options.stats->countFunction(*func);
+        }
+        emitFunction(backend, std::move(func), options, options.stats, tco, arities);
+    }
+    backend.endProgram();
+}
+
+// 流水线各阶段之间共享的状态。各阶段的统计先记在自己的CompileStats中，结束后合并
+struct Pipeline {
+    SpscQueue<std::unique_ptr<TokenStream>> batches{kBatchQueueSize};    // nullptr表示词法分析结束
+    SpscQueue<std::unique_ptr<FunctionDecl>> functions{kFunctionQueueSize}; // nullptr表示语法分析结束
+    std::vector<std::pair<std::string, int>> signatures; // 词法分析线程写入，lexed之后才能读
+    std::atomic<bool> lexed{false};
+    std::exception_ptr lexError;
+    std::exception_ptr parseError;
+    CompileStats lexStats;
+    CompileStats parseStats;
+};
+
+// 词法分析线程：按函数边界分批，每批带一个END，可以单独做语法分析
+void lexStage(const std::string& source, const DriverOptions& options, bool scanSignatures, Pipeline& pipeline) {
+    CompileStats* stats = options.stats ? &pipeline.lexStats : nullptr;
+    try {
+        Lexer lexer(source);
+        size_t pos = 0;
+        do {
+            std::unique_ptr<TokenStream> batch(new TokenStream);
+            {
+                PhaseTimer timer(stats, "lex");
+                pos = lexer.scanFunctions(pos, kBatchTokens, *batch);
+            }
+            if (stats) {
+                stats->tokens += batch->size() - 1; // 中间的END不算
+            }
+            if (scanSignatures) {
+                PhaseTimer timer(stats, "lex");
+                for (const auto& signature : Parser(*batch).scanSignatures()) {
+                    pipeline.signatures.push_back(signature);
+                }
+            }
+            pipeline.batches.push(std::move(batch));
+        } while (pos < source.size());
+    } catch (...) {
+        pipeline.lexError = std::current_exception();
+    }
+    if (stats) {
+        stats->files++;
+        stats->sourceBytes += source.size();
+        stats->tokens++;
+    }
+    pipeline.lexed.store(true, std::memory_order_release);
+    pipeline.batches.push(nullptr);
+}
+
+// 语法分析线程：出错后不再分析，但继续取走剩下的批，词法分析线程不会因为队列满而停住
+void parseStage(const DriverOptions& options, Pipeline& pipeline) {
+    CompileStats* stats = options.stats ? &pipeline.parseStats : nullptr;
+    while (std::unique_ptr<TokenStream> batch = pipeline.batches.pop()) {
+        if (pipeline.parseError) continue;
+        try {
+            Parser parser(*batch);
+            for (;;) {
+                std::unique_ptr<FunctionDecl> func;
+                {
+                    PhaseTimer timer(stats, "parse");
+                    func = parser.parseNext();
+                }
+                if (!func) break;
+                if (stats) {
+                    stats->countFunction(*func);
+                }
+                pipeline.functions.push(std::move(func));
+            }
+        } catch (...) {
+            pipeline.parseError = std::current_exception();
+        }
+    }
+    pipeline.functions.push(nullptr);
+}
+
+// 代码生成在调用线程中进行，返回代码生成中的错误。
+// 尾调用改写和寄存器传参要知道整个文件的函数签名，此时先等词法分析结束：
+// 等待期间收下已经分析好的函数，语法分析线程不会因为队列满而停住
+template <typename Backend>
+std::exception_ptr generateStage(Backend& backend, const DriverOptions& options, bool needSignatures,
+                                 CompileStats* stats, Pipeline& pipeline) {
+    std::exception_ptr error;
+    std::unordered_map<std::string, int> arities;
+    std::deque<std::unique_ptr<FunctionDecl>> pending;
+    bool parsed = false;
+    try {
+        backend.beginProgram();
+        if (needSignatures) {
+            while (!pipeline.lexed.load(std::memory_order_acquire)) {
+                std::unique_ptr<FunctionDecl> func;
+                if (!pipeline.functions.tryPop(func)) {
+                    std::this_thread::yield();
+                } else if (func) {
+                    pending.push_back(std::move(func));
+                } else {
+                    parsed = true;
+                    break;
+                }
+            }
+            for (const auto& signature : pipeline.signatures) {
+                arities[signature.first] = signature.second;
+            }
+            for (const auto& entry : arities) {
+                backend.declareFunction(entry.first, entry.second);
+            }
+        }
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    TailCallOptimizer tco;
+    for (;;) {
+        std::unique_ptr<FunctionDecl> func;
+        if (!pending.empty()) {
+            func = std::move(pending.front());
+            pending.pop_front();
+        } else if (parsed || !(func = pipeline.functions.pop())) {
+            break;
+        }
+        if (error) continue; // 出错后只取走剩下的函数
+        try {
+            emitFunction(backend, std::move(func), options, stats, tco, arities);
+        } catch (...) {
+            error = std::current_exception();
+        }
+    }
+    if (!error) {
+        try {
+            backend.endProgram();
+        } catch (...) {
+            error = std::current_exception();
+        }
+    }
+    return error;
+}
+
+template <typename Backend>
+void runPipeline(const std::string& source, const DriverOptions& options, CodeGenOptions codeGen) {
+    Pipeline pipeline;
+    CompileStats codeGenStats;
+    CompileStats* stats = options.stats ? &codeGenStats : nullptr;
+    codeGen.stats = stats;
+    Backend backend(codeGen);
+    bool needSignatures = hasPass(options, "tail-calls") || backend.needsSignatures();
+
+    std::thread lexer(lexStage, std::cref(source), std::cref(options), needSignatures, std::ref(pipeline));
+    std::thread parser(parseStage, std::cref(options), std::ref(pipeline));
+    std::exception_ptr codeGenError = generateStage(backend, options, needSignatures, stats, pipeline);
+    lexer.join();
+    parser.join();
+
+    if (options.stats) {
+        options.stats->merge(pipeline.lexStats);
+        options.stats->merge(pipeline.parseStats);
+        options.stats->merge(codeGenStats);
+    }
+    // 与顺序编译报告同一个错误：词法错误优先，其次是语法错误（都是最靠前的那个），最后是代码生成的错误
+    for (const auto& error : {pipeline.lexError, pipeline.parseError, codeGenError}) {
+        if (error) std::rethrow_exception(error);
+    }
+}
+
+} // namespace
+
+bool parseDriverOption(const std::string& arg, DriverOptions& options) {
+    if (PassManager::optimizationLevel(arg, options.passes)) {
+        // 优化级别替换之前选择的遍
+    } else if (arg.compare(0, 9, "--passes=") == 0) {
+        options.passes = PassManager::parseList(arg.substr(9));
+    } else if (arg == "--inline") {
+        PassManager::addPass(options.passes, "inline");
+    } else if (arg == "--tail-calls") {
+        PassManager::addPass(options.passes, "tail-calls");
+    } else if (arg == "--memoize") {
+        PassManager::addPass(options.passes, "memoize");
+    } else if (arg == "--verify-passes") {
+        options.verifyPasses = true;
+    } else if (arg == "--regcall") {
+        options.codeGen.regParams = 2; // ecx、edx
+    } else if (arg.compare(0, 10, "--regcall=") == 0) {
+        options.codeGen.regParams = std::atoi(arg.c_str() + 10);
+    } else if (arg == "--target=x86-64") {
+        options.targetX64 = true;
+    } else if (arg == "--target=i386") {
+        options.targetX64 = false;
+    } else if (arg == "--fast-print") {
+        options.codeGen.fastPrint = true;
+    } else if (arg == "-c") {
+        options.emitObject = true;
+    } else if (arg == "--stream") {
+        options.streaming = true;
+    } else if (arg == "--pipeline") {
+        options.pipeline = true;
+    } else if (arg == "--profile-generate") {
+        options.profileGenerate = kDefaultProfile;
+    } else if (arg.compare(0, 19, "--profile-generate=") == 0) {
+        options.profileGenerate = arg.substr(19);
+    } else if (arg == "--profile-use" || arg.compare(0, 14, "--profile-use=") == 0) {
+        options.profileUse = arg.size() > 14 ? arg.substr(14) : kDefaultProfile;
+        options.profile.reset();
+    } else {
+        return false;
+    }
+    return true;
+}
+
+TokenStream lexSource(const std::string& source, const DriverOptions& options) {
+    TokenStream tokens;
+    {
+        PhaseTimer timer(options.stats, "lex");
+        Lexer lexer(source);
+        tokens = options.threads == 1 ? lexer.tokenize() : lexer.tokenizeParallel(options.threads);
+    }
+    if (options.stats) {
+        options.stats->files++;
+        options.stats->sourceBytes += source.size();
+        options.stats->tokens += tokens.size();
+    }
+    return tokens;
+}
+
+std::unique_ptr<Program> parseProgram(const TokenStream& tokens, const DriverOptions& options) {
+    std::unique_ptr<Program> program;
+    {
+        PhaseTimer timer(options.stats, "parse");
+        Parser parser(tokens);
+        program = options.threads == 1 ? parser.parse() : parser.parseParallel(options.threads);
+    }
+    if (options.stats) {
+        options.stats->countProgram(*program);
+    }
+    // 在优化遍之前编号，编号只取决于源码
+    if (profiling(options)) {
+        numberProfileSites(*program);
+        if (options.profile && options.profile->size() != static_cast<size_t>(program->profileSites) * 2) {
+            throw std::runtime_error("profile " + options.profileUse + " does not match the source (" +
+                                     std::to_string(options.profile->size()) + " counters, expected " +
+                                     std::to_string(program->profileSites * 2) + ")");
+        }
+    }
+
+    if (!options.passes.empty() || options.verifyPasses) {
+        PassManager passManager(options.passes);
+        passManager.verify = options.verifyPasses;
+        passManager.report = options.passReport;
+        passManager.inlineReport = options.inlineReport;
+        passManager.profile = options.profile.get();
+        passManager.run(*program, options.stats);
+    }
+    return program;
+}
+
+void generateProgram(std::unique_ptr<Program> program, const TokenStream& tokens,
+                     const DriverOptions& options, CodeGenOptions codeGen) {
+    PhaseTimer timer(options.stats, "codegen");
+    codeGen.stats = options.stats;
+    if (options.stats) {
+        options.stats->functions += program->functions.size();
+    }
+    codeGen.profileGenerate = !options.profileGenerate.empty();
+    codeGen.profilePath = options.profileGenerate;
+    codeGen.profileSites = program->profileSites;
+    codeGen.profile = options.profile.get();
+    // 插桩的计数器编号与整个文件有关，不能按函数缓存
+    std::unique_ptr<CacheKeys> cacheKeys;
+    if (options.cache && !profiling(options)) {
+        cacheKeys.reset(new CacheKeys(tokens, *program, cacheSalt(options, codeGen)));
+        codeGen.cache = options.cache;
+        codeGen.cacheKeys = cacheKeys.get();
+    }
+
+    if (options.targetX64) {
+        CodeGenX64 codeGenerator(std::move(program), codeGen);
+        codeGenerator.generateCode();
+    } else {
+        CodeGen codeGenerator(std::move(program), codeGen);
+        codeGenerator.generateCode();
+    }
+}
+
+void streamProgram(const TokenStream& tokens, const DriverOptions& options, CodeGenOptions codeGen) {
+    codeGen.stats = options.stats;
+    if (options.targetX64) {
+        streamFunctions<CodeGenX64>(tokens, options, codeGen);
+    } else {
+        streamFunctions<CodeGen>(tokens, options, codeGen);
+    }
+}
+
+void pipelineProgram(const std::string& source, const DriverOptions& options, CodeGenOptions codeGen) {
+    if (options.targetX64) {
+        runPipeline<CodeGenX64>(source, options, codeGen);
+    } else {
+        runPipeline<CodeGen>(source, options, codeGen);
+    }
+}
+
+void compileSource(const std::string& source, const DriverOptions& sourceOptions, std::ostream& out) {
+    PassManager::checkNames(sourceOptions.passes);
+    DriverOptions options = sourceOptions;
+    if (!options.profileUse.empty() && !options.profile) {
+        options.profile = Profile::load(options.profileUse);
+    }
+    bool wholeProgram = !perFunctionPasses(options) || options.cache || profiling(options);
+    bool pipelined = options.pipeline && !wholeProgram;
+    bool streaming = options.streaming && !wholeProgram;
+    TokenStream tokens;
+    if (!pipelined) {
+        tokens = lexSource(source, options);
+    }
+    auto generate = [&](const CodeGenOptions& codeGen) {
+        if (pipelined) {
+            pipelineProgram(source, options, codeGen);
+        } else if (streaming) {
+            streamProgram(tokens, options, codeGen);
+        } else {
+            generateProgram(parseProgram(tokens, options), tokens, options, codeGen);
+        }
+    };
+
+    CodeGenOptions codeGen = options.codeGen;
+    codeGen.output = &out;
+    if (!options.emitObject) {
+        generate(codeGen);
+        return;
+    }
+
+    Assembler assembler(options.targetX64);
+    codeGen.assembler = &assembler;
+    generate(codeGen);
+    PhaseTimer timer(options.stats, "object");
+    assembler.finish();
+    ObjectWriter(assembler).write(out);
+}
@@ -0,0 +1,63 @@
+#ifndef DRIVER_H
+#define DRIVER_H
+
+#include "CodeGen.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "Profile.h"
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/*
+ * 编译流水线：词法分析 → 语法分析 → 优化遍（PassManager） → 代码生成
+ * 单文件编译与批量编译共用。除增量编译缓存（自己加锁）外只使用局部状态，可以在多个线程中同时调用。
+ */
+struct DriverOptions {
+    std::vector<std::string> passes;      // 按顺序运行的优化遍：-O0/-O1/-O2/-Os、--passes=、--inline、--tail-calls、--memoize
+    bool verifyPasses = false;            // --verify-passes: 每个遍之后检查AST结构
+    std::ostream* passReport = nullptr;   // --pass-report: 每个遍的耗时和改动的输出流
+    std::ostream* inlineReport = nullptr; // --inline-report: 内联决策的输出流
+    bool targetX64 = false;               // --target=x86-64
+    bool emitObject = false;              // -c: 输出ELF目标文件而不是汇编文本
+    CodeGenOptions codeGen;               // output、assembler、cache由流水线设置
+    FunctionCache* cache = nullptr;       // --cache-dir
+    CompileStats* stats = nullptr;        // --stats: 各阶段计时和计数，累加到这里
+    unsigned threads = 1;                 // 词法分析和语法分析的线程数（Lexer::tokenizeParallel、Parser::parseParallel），0为CPU核数
+    bool streaming = false;               // --stream: 逐个函数分析、生成并释放AST（内联和缓存需要整个程序，此时不生效）
+    bool pipeline = false;                // --pipeline: 词法分析、语法分析、代码生成在三个线程中流水线进行（同样不用于内联和缓存）
+    std::string profileGenerate;          // --profile-generate[=FILE]: 插桩，程序退出时把计数写入FILE
+    std::string profileUse;               // --profile-use[=FILE]: 按FILE中的计数安排代码布局和内联
+    std::shared_ptr<const Profile> profile; // profileUse读入的内容，为空时compileSource按需读取
+};
+
+// 解析影响编译结果的命令行选项（-O0/-O1/-O2/-Os、--passes=、--inline、--tail-calls、--memoize、--verify-passes、
+// --regcall[=N]、--target=、--fast-print、-c、--stream、--pipeline、--profile-generate、--profile-use），
+// 不是这些选项时返回false。命令行和编译服务器的请求共用
+bool parseDriverOption(const std::string& arg, DriverOptions& options);
+
+// 词法分析
+TokenStream lexSource(const std::string& source, const DriverOptions& options);
+
+// 语法分析并按选项优化AST；tokens在AST使用期间需要保持有效（缓存键引用它）
+std::unique_ptr<Program> parseProgram(const TokenStream& tokens, const DriverOptions& options);
+
+// 用选定的后端生成代码，输出位置由codeGen.output/assembler决定；设置了缓存时按函数查找/保存
+void generateProgram(std::unique_ptr<Program> program, const TokenStream& tokens,
+                     const DriverOptions& options, CodeGenOptions codeGen);
+
+// 流式编译：预扫描函数签名后逐个函数做语法分析、逐函数的优化遍（常量折叠、尾调用改写）和代码生成，生成完就释放该函数的AST，
+// AST的峰值内存取决于最大的函数而不是整个文件。输出与generateProgram(parseProgram(...))逐字节相同；
+// 源码有错时已经写出的前面函数的代码留在输出中
+void streamProgram(const TokenStream& tokens, const DriverOptions& options, CodeGenOptions codeGen);
+
+// 流水线编译：词法分析线程按函数边界分批产生token，语法分析线程把每批分析成函数，
+// 调用线程做逐函数的优化遍和代码生成；阶段之间用有界无锁队列（SpscQueue）连接。
+// 输出与顺序编译逐字节相同，有多个错误时报告的也是顺序编译会报告的那个
+void pipelineProgram(const std::string& source, const DriverOptions& options, CodeGenOptions codeGen);
+
+// 编译一份源码，把汇编文本或目标文件写到out；源码有错时抛出runtime_error
+void compileSource(const std::string& source, const DriverOptions& options, std::ostream& out);
+
+#endif // DRIVER_H
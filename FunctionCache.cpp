@@ -0,0 +1,196 @@
+#include "FunctionCache.h"
+#include "ASTUtil.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// 缓存格式或生成的代码变化时修改，使旧条目失效
+const char* const kCacheVersion = "function-cache-3";
+
+// 两路FNV-1a（不同初值），合成128位键
+const uint64_t kFnvPrime = 1099511628211ull;
+
+void mix(uint64_t* state, const std::string& data) {
+    for (int lane = 0; lane < 2; ++lane) {
+        uint64_t h = state[lane];
+        for (unsigned char c : data) {
+            h = (h ^ c) * kFnvPrime;
+        }
+        state[lane] = (h ^ 0xFF) * kFnvPrime; // 分隔符，避免 "ab"+"c" 与 "a"+"bc" 相同
+    }
+}
+
+std::string hex(const uint64_t* state) {
+    static const char digits[] = "0123456789abcdef";
+    std::string out;
+    for (int lane = 0; lane < 2; ++lane) {
+        for (int shift = 60; shift >= 0; shift -= 4) {
+            out += digits[(state[lane] >> shift) & 0xF];
+        }
+    }
+    return out;
+}
+
+// 按出现顺序收集函数调用和内联展开的函数名
+void collectCalls(const Statement& stmt, std::vector<std::pair<std::string, bool>>& calls);
+
+void collectCalls(const Expression& expr, std::vector<std::pair<std::string, bool>>& calls) {
+    std::vector<const Expression*> stack = {&expr}; // 前序遍历，子节点逆序压栈
+    while (!stack.empty()) {
+        const Expression* node = stack.back();
+        stack.pop_back();
+        if (auto op = dynamic_cast<const BinaryOp*>(node)) {
+            stack.push_back(op->right.get());
+            stack.push_back(op->left.get());
+        } else if (auto call = dynamic_cast<const FunctionCall*>(node)) {
+            calls.emplace_back(call->functionName, false);
+            for (auto it = call->args.rbegin(); it != call->args.rend(); ++it) {
+                stack.push_back(it->get());
+            }
+        } else if (auto inl = dynamic_cast<const InlinedCall*>(node)) {
+            calls.emplace_back(inl->functionName, true);
+            collectCalls(*inl->body, calls);
+        }
+    }
+}
+
+void collectCalls(const Statement& stmt, std::vector<std::pair<std::string, bool>>& calls) {
+    forEachStatement(stmt, [&](const Statement& s) {
+        auto visit = [&](const Expression* e) {
+            if (e) collectCalls(*e, calls);
+        };
+        if (auto decl = dynamic_cast<const VariableDecl*>(&s)) visit(decl->value.get());
+        else if (auto assign = dynamic_cast<const Assignment*>(&s)) visit(assign->value.get());
+        else if (auto ret = dynamic_cast<const ReturnStmt*>(&s)) visit(ret->value.get());
+        else if (auto print = dynamic_cast<const PrintlnIntStmt*>(&s)) visit(print->arg.get());
+        else if (auto exprStmt = dynamic_cast<const ExpressionStatement*>(&s)) visit(exprStmt->expr.get());
+        else if (auto cond = dynamic_cast<const ConditionStatement*>(&s)) visit(cond->condition.get());
+        else if (auto loop = dynamic_cast<const LoopStatement*>(&s)) visit(loop->condition.get());
+        else if (auto inlRet = dynamic_cast<const InlineReturn*>(&s)) visit(inlRet->value.get());
+    });
+}
+
+} // namespace
+
+FunctionCache::FunctionCache(const std::string& directory) : directory_(directory) {
+    if (directory_.empty()) return;
+#ifdef _WIN32
+    _mkdir(directory_.c_str());
+#else
+    mkdir(directory_.c_str(), 0755);
+#endif
+}
+
+std::string FunctionCache::pathOf(const std::string& key) const {
+    return directory_ + "/" + key + ".s";
+}
+
+bool FunctionCache::lookup(const std::string& key, std::string& text) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = memory_.find(key);
+        if (it != memory_.end()) {
+            text = it->second;
+            hits_++;
+            return true;
+        }
+    }
+    if (!directory_.empty()) {
+        std::ifstream file(pathOf(key), std::ios::binary);
+        if (file.is_open()) {
+            std::ostringstream content;
+            content << file.rdbuf();
+            text = content.str();
+            std::lock_guard<std::mutex> lock(mutex_);
+            memory_[key] = text;
+            hits_++;
+            return true;
+        }
+    }
+    misses_++;
+    return false;
+}
+
+void FunctionCache::store(const std::string& key, const std::string& text) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        memory_[key] = text;
+    }
+    if (directory_.empty()) return;
+
+    // 先写临时文件再改名，并发的编译进程不会读到写了一半的条目
+    std::ostringstream tmpName;
+    tmpName << pathOf(key) << ".tmp";
+#ifndef _WIN32
+    tmpName << "." << getpid();
+#endif
+    tmpName << "." << std::this_thread::get_id();
+    {
+        std::ofstream file(tmpName.str(), std::ios::binary);
+        if (!file.is_open()) return; // 缓存写不进去不影响编译
+        file << text;
+    }
+    if (std::rename(tmpName.str().c_str(), pathOf(key).c_str()) != 0) {
+        std::remove(tmpName.str().c_str());
+    }
+}
+
+CacheKeys::CacheKeys(const TokenStream& tokens, const Program& program, const std::string& options)
+    : tokens_(tokens), options_(options) {
+    for (const auto& func : program.functions) {
+        functions_[func->name] = func.get();
+    }
+}
+
+void CacheKeys::hashSpan(const FunctionDecl& func, uint64_t* state) const {
+    std::string text;
+    for (size_t i = func.tokenBegin; i < func.tokenEnd && i < tokens_.size(); ++i) {
+        text += std::to_string(static_cast<int>(tokens_.type(i)));
+        text += ' ';
+        text += tokens_.text(i);
+        text += '\n';
+    }
+    mix(state, text);
+}
+
+std::string CacheKeys::key(const FunctionDecl& func) const {
+    uint64_t state[2] = {14695981039346656037ull, 0x84222325cbf29ce4ull};
+    mix(state, kCacheVersion);
+    mix(state, options_);
+    mix(state, func.name);
+    mix(state, std::to_string(func.params.size()));
+    hashSpan(func, state);
+
+    std::vector<std::pair<std::string, bool>> calls;
+    collectCalls(*func.body, calls);
+    for (const auto& call : calls) {
+        auto it = functions_.find(call.first);
+        mix(state, call.second ? "inline" : "call");
+        mix(state, call.first);
+        if (it == functions_.end()) {
+            mix(state, "undefined");
+        } else if (call.second) {
+            hashSpan(*it->second, state);
+        } else {
+            mix(state, std::to_string(it->second->params.size()));
+        }
+    }
+    // 编译时求值的调用已被替换为常量，结果取决于被执行的函数的源码
+    for (const auto& name : func.evaluatedCalls) {
+        auto it = functions_.find(name);
+        mix(state, "evaluated");
+        mix(state, name);
+        if (it != functions_.end()) hashSpan(*it->second, state);
+    }
+    return hex(state);
+}
@@ -0,0 +1,57 @@
+#ifndef FUNCTION_CACHE_H
+#define FUNCTION_CACHE_H
+
+#include "Lexer.h"
+#include "Parser.h"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/*
+ * 增量编译缓存
+ * 以函数为单位缓存生成的汇编文本。缓存键由以下内容的哈希组成：
+ *   - 影响代码生成的编译选项
+ *   - 函数名、函数自身的token序列（与空白和注释无关）
+ *   - 它调用的函数的签名（函数名、参数个数、是否在程序中定义）
+ *   - 内联进来的函数和编译时求值执行过的函数的token序列
+ * 标签按函数命名（.L<函数名>_N），因此函数的汇编与其他函数无关，可以直接拼接。
+ */
+class FunctionCache {
+public:
+    // 缓存目录不存在时自动创建；目录为空时只在内存中缓存
+    explicit FunctionCache(const std::string& directory);
+
+    bool lookup(const std::string& key, std::string& text);
+    void store(const std::string& key, const std::string& text);
+
+    int hits() const { return hits_; }
+    int misses() const { return misses_; }
+
+private:
+    std::string directory_;
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::string> memory_; // 已读取或写入过的条目
+    std::atomic<int> hits_{0};
+    std::atomic<int> misses_{0};
+
+    std::string pathOf(const std::string& key) const;
+};
+
+// 一次编译中各函数的缓存键
+class CacheKeys {
+public:
+    // options: 影响代码生成的编译选项（目标、寄存器传参、优化开关等）的文本形式
+    CacheKeys(const TokenStream& tokens, const Program& program, const std::string& options);
+
+    std::string key(const FunctionDecl& func) const;
+
+private:
+    const TokenStream& tokens_;
+    std::string options_;
+    std::unordered_map<std::string, const FunctionDecl*> functions_;
+
+    void hashSpan(const FunctionDecl& func, uint64_t* state) const;
+};
+
+#endif // FUNCTION_CACHE_H
@@ -0,0 +1,215 @@
+#include "Inliner.h"
+#include "ASTUtil.h"
+#include "Profile.h"
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+void collectCalls(Statement& stmt, std::vector<std::string>& out) {
+    forEachExprSlot(stmt, [&](std::unique_ptr<Expression>& slot) {
+        if (auto call = dynamic_cast<FunctionCall*>(slot.get())) {
+            out.push_back(call->functionName);
+        }
+    });
+}
+
+// 把函数体中的return改写为InlineReturn（已展开的内联体中不会再有ReturnStmt）
+void rewriteReturns(Block& block) {
+    for (auto& stmt : block.statements) {
+        if (auto ret = dynamic_cast<ReturnStmt*>(stmt.get())) {
+            stmt = std::make_unique<InlineReturn>(std::move(ret->value));
+        } else if (auto inner = dynamic_cast<Block*>(stmt.get())) {
+            rewriteReturns(*inner);
+        } else if (auto cond = dynamic_cast<ConditionStatement*>(stmt.get())) {
+            rewriteReturns(*cond->thenBlock);
+            if (cond->elseBlock) rewriteReturns(*cond->elseBlock);
+        } else if (auto loop = dynamic_cast<LoopStatement*>(stmt.get())) {
+            rewriteReturns(*loop->body);
+        }
+    }
+}
+
+} // namespace
+
+int Inliner::run(Program& program) {
+    buildCallGraph(program);
+
+    int inlined = 0;
+    changedFunctions.clear();
+    // 自底向上处理，被调函数先完成内联，展开时拷贝的是已优化的函数体
+    for (auto func : bottomUpOrder()) {
+        int n = inlineCallsIn(*func);
+        if (n > 0) changedFunctions.push_back(func->name);
+        inlined += n;
+    }
+    return inlined;
+}
+
+void Inliner::buildCallGraph(Program& program) {
+    functions_.clear();
+    names_.clear();
+    callees_.clear();
+    call_counts_.clear();
+    recursive_.clear();
+
+    for (auto& func : program.functions) {
+        functions_[func->name] = func.get();
+        names_.push_back(func->name);
+    }
+    for (auto& func : program.functions) {
+        std::vector<std::string> calls;
+        collectCalls(*func->body, calls);
+        auto& callees = callees_[func->name];
+        for (const auto& name : calls) {
+            if (std::find(callees.begin(), callees.end(), name) == callees.end()) {
+                callees.push_back(name);
+            }
+            call_counts_[name]++;
+        }
+    }
+}
+
+/**
+ * @brief Tarjan强连通分量，同时标记递归函数
+ * @return 被调函数在前的函数顺序
+ */
+std::vector<FunctionDecl*> Inliner::bottomUpOrder() {
+    std::vector<FunctionDecl*> order;
+    std::unordered_map<std::string, int> index, lowlink;
+    std::unordered_set<std::string> onStack;
+    std::vector<std::string> stack;
+    int counter = 0;
+
+    std::function<void(const std::string&)> strongConnect = [&](const std::string& name) {
+        index[name] = lowlink[name] = counter++;
+        stack.push_back(name);
+        onStack.insert(name);
+
+        for (const auto& callee : callees_[name]) {
+            if (!functions_.count(callee)) continue;
+            if (!index.count(callee)) {
+                strongConnect(callee);
+                lowlink[name] = std::min(lowlink[name], lowlink[callee]);
+            } else if (onStack.count(callee)) {
+                lowlink[name] = std::min(lowlink[name], index[callee]);
+            }
+        }
+
+        if (lowlink[name] == index[name]) {
+            std::vector<std::string> scc;
+            std::string member;
+            do {
+                member = stack.back();
+                stack.pop_back();
+                onStack.erase(member);
+                scc.push_back(member);
+            } while (member != name);
+
+            auto& own = callees_[name];
+            bool selfCall = std::find(own.begin(), own.end(), name) != own.end();
+            for (const auto& m : scc) {
+                if (scc.size() > 1 || selfCall) recursive_.insert(m);
+                order.push_back(functions_[m]);
+            }
+        }
+    };
+
+    for (const auto& name : names_) {
+        if (!index.count(name)) strongConnect(name);
+    }
+    return order;
+}
+
+int Inliner::inlineCallsIn(FunctionDecl& caller) {
+    int inlined = 0;
+    int callerSize = countNodes(*caller.body);
+
+    forEachExprSlot(*caller.body, [&](std::unique_ptr<Expression>& slot) {
+        auto call = dynamic_cast<FunctionCall*>(slot.get());
+        if (!call || !shouldInline(caller, *call, callerSize)) return;
+
+        const FunctionDecl& callee = *functions_[call->functionName];
+        callerSize += countNodes(*callee.body);
+        slot = expand(*call, callee);
+        inlined++;
+    });
+    // return g(...) 中的g被内联后不再是尾调用，清除TailCallOptimizer留下的标记
+    if (inlined > 0) {
+        forEachStatement(*caller.body, [](Statement& stmt) {
+            auto ret = dynamic_cast<ReturnStmt*>(&stmt);
+            if (ret && ret->tailCall && !dynamic_cast<const FunctionCall*>(ret->value.get())) {
+                ret->tailCall = false;
+            }
+        });
+    }
+    return inlined;
+}
+
+bool Inliner::shouldInline(const FunctionDecl& caller, const FunctionCall& call, int callerSize) {
+    auto decide = [&](bool yes, const std::string& why) {
+        if (report_) {
+            *report_ << "[inline] " << call.functionName << " -> " << caller.name << ": "
+                     << (yes ? "inlined" : "not inlined") << " (" << why << ")" << std::endl;
+        }
+        return yes;
+    };
+
+    auto it = functions_.find(call.functionName);
+    if (it == functions_.end()) return decide(false, "no definition");
+    const FunctionDecl& callee = *it->second;
+
+    if (callee.name == "main") return decide(false, "entry point");
+    if (recursive_.count(callee.name)) return decide(false, "recursive");
+    if (callee.params.size() != call.args.size()) return decide(false, "argument count mismatch");
+
+    int size = countNodes(*callee.body);
+    int calls = call_counts_[callee.name];
+    std::string stats = "size=" + std::to_string(size) + ", call sites=" + std::to_string(calls);
+
+    if (callerSize + size > maxCallerSize) {
+        return decide(false, stats + ", caller would exceed " + std::to_string(maxCallerSize));
+    }
+    if (profile && call.profileSite >= 0) {
+        uint64_t count = profile->callCount(call.profileSite);
+        stats += ", profiled calls=" + std::to_string(count);
+        if (count == 0) return decide(false, stats + ", never executed");
+        if (count >= hotCallCount && size <= hotSize) return decide(true, stats + ", hot call site");
+    }
+    if (size <= smallSize) return decide(true, stats);
+    if (calls == 1 && size <= singleCallSize) return decide(true, stats + ", single call site");
+    return decide(false, stats + ", too large");
+}
+
+std::unique_ptr<Expression> Inliner::expand(FunctionCall& call, const FunctionDecl& callee) {
+    // 变量名中的'@'不是合法标识符字符，不会与用户变量冲突
+    std::string suffix = "@" + std::to_string(expansion_count_++);
+    auto fresh = [&](const std::string& name) { return name + suffix; };
+
+    auto body = std::make_unique<Block>();
+    // 与cdecl调用一致，实参从右到左求值
+    for (int i = static_cast<int>(call.args.size()) - 1; i >= 0; --i) {
+        body->addStatement(std::make_unique<VariableDecl>(
+            "int",
+            std::make_unique<Variable>(fresh(callee.params[i].second)),
+            std::move(call.args[i])));
+    }
+
+    auto inlinedBody = cloneBlock(*callee.body);
+    renameVariables(*inlinedBody, fresh);
+    rewriteReturns(*inlinedBody);
+    // 函数体可能执行到末尾时，与不内联的调用一样返回0，汇合点不能沿用寄存器中的旧值
+    const Statement* last = inlinedBody.get();
+    while (auto block = dynamic_cast<const Block*>(last)) {
+        if (block->statements.empty()) break;
+        last = block->statements.back().get();
+    }
+    if (!dynamic_cast<const InlineReturn*>(last)) {
+        inlinedBody->addStatement(std::make_unique<InlineReturn>(nullptr));
+    }
+    body->addStatement(std::move(inlinedBody));
+
+    auto inlined = std::make_unique<InlinedCall>(callee.name, std::move(body));
+    inlined->profileSite = call.profileSite;
+    return inlined;
+}
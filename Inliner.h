@@ -0,0 +1,60 @@
+#ifndef INLINER_H
+#define INLINER_H
+
+#include "Parser.h"
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+class Profile;
+
+/*
+ * 函数内联
+ * 把FunctionCall展开成InlinedCall：实参先求值到新的局部变量，
+ * 被调函数体中的return改写为跳转到汇合点的InlineReturn，可能执行到末尾的函数体再补一个返回0的InlineReturn。
+ *
+ * 代价模型：
+ *   - 递归（包括相互递归）的函数和main永不内联
+ *   - 函数体节点数 <= smallSize 时总是内联
+ *   - 只有一个调用点且节点数 <= singleCallSize 时内联
+ *   - 调用者展开后超过 maxCallerSize 时停止内联
+ *   - 有profile（--profile-use）时：从未执行过的调用点不内联，
+ *     执行次数 >= hotCallCount 的调用点内联节点数 <= hotSize 的函数
+ */
+class Inliner {
+public:
+    int smallSize = 16;
+    int singleCallSize = 200;
+    int maxCallerSize = 2000;
+    uint64_t hotCallCount = 1000; // 与Profile::callCount的类型相同
+    int hotSize = 64;
+    const Profile* profile = nullptr;
+
+    // report非空时输出每个调用点的内联决策
+    explicit Inliner(std::ostream* report = nullptr) : report_(report) {}
+
+    // 返回被内联的调用点个数
+    int run(Program& program);
+
+    // 最近一次run中有调用点被内联的函数
+    std::vector<std::string> changedFunctions;
+
+private:
+    std::ostream* report_;
+    std::unordered_map<std::string, FunctionDecl*> functions_;
+    std::vector<std::string> names_;                                       // 源码顺序的函数名
+    std::unordered_map<std::string, std::vector<std::string>> callees_;    // 调用图（去重，保持出现顺序）
+    std::unordered_map<std::string, int> call_counts_;
+    std::unordered_set<std::string> recursive_;
+    int expansion_count_ = 0;
+
+    void buildCallGraph(Program& program);
+    std::vector<FunctionDecl*> bottomUpOrder();
+    int inlineCallsIn(FunctionDecl& caller);
+    bool shouldInline(const FunctionDecl& caller, const FunctionCall& call, int callerSize);
+    std::unique_ptr<Expression> expand(FunctionCall& call, const FunctionDecl& callee);
+};
+
+#endif // INLINER_H
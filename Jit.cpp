@@ -0,0 +1,131 @@
+#include "Jit.h"
+#include "Runtime.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__unix__) && defined(__x86_64__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define JIT_SUPPORTED 1
+#endif
+
+namespace {
+
+const size_t kStubSize = 16; // jmp [rip+0] (6字节) + 8字节地址，补齐到16
+
+size_t roundUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+// 生成的代码可以调用的宿主函数
+void* JitProgram::hostSymbol(const std::string& name) {
+    if (name == "printf") return reinterpret_cast<void*>(&std::printf);
+    if (name == "println_int") return reinterpret_cast<void*>(&println_int);
+    if (name == "profile_start") return reinterpret_cast<void*>(&profile_start);
+    throw std::runtime_error("JIT: unresolved symbol: " + name);
+}
+
+JitProgram::JitProgram(const Assembler& assembler) : asm_(assembler) {
+#ifdef JIT_SUPPORTED
+    if (!asm_.isX64()) {
+        throw std::runtime_error("JIT: only x86-64 code can be run in process");
+    }
+
+    // 每个外部符号一个跳板
+    std::vector<std::string> externals;
+    for (const auto& reloc : asm_.relocations()) {
+        if (asm_.symbols().count(reloc.symbol)) continue;
+        if (std::find(externals.begin(), externals.end(), reloc.symbol) == externals.end()) {
+            externals.push_back(reloc.symbol);
+        }
+    }
+
+    std::vector<void*> hostTargets;
+    for (const auto& name : externals) {
+        hostTargets.push_back(hostSymbol(name));
+    }
+
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t stubOffset = roundUp(asm_.text().size(), kStubSize);
+    size_t codeSize = roundUp(stubOffset + externals.size() * kStubSize, page);
+    size_t dataSize = roundUp(std::max<size_t>(asm_.data().size(), 1), page);
+    size_ = codeSize + dataSize;
+
+    void* memory = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        throw std::runtime_error("JIT: mmap failed");
+    }
+    memory_ = static_cast<unsigned char*>(memory);
+    text_ = memory_;
+    data_ = memory_ + codeSize;
+    std::memcpy(text_, asm_.text().data(), asm_.text().size());
+    if (!asm_.data().empty()) {
+        std::memcpy(data_, asm_.data().data(), asm_.data().size());
+    }
+
+    for (size_t i = 0; i < externals.size(); ++i) {
+        unsigned char* stub = text_ + stubOffset + i * kStubSize;
+        const unsigned char jmp[] = {0xFF, 0x25, 0x00, 0x00, 0x00, 0x00}; // jmp QWORD PTR [rip+0]
+        std::memcpy(stub, jmp, sizeof(jmp));
+        std::memcpy(stub + sizeof(jmp), &hostTargets[i], sizeof(void*));
+    }
+
+    for (const auto& reloc : asm_.relocations()) {
+        unsigned char* target;
+        auto defined = asm_.symbols().find(reloc.symbol);
+        if (defined != asm_.symbols().end()) {
+            unsigned char* base = defined->second.section == Assembler::Section::Text ? text_ : data_;
+            target = base + defined->second.offset;
+        } else {
+            size_t index = std::find(externals.begin(), externals.end(), reloc.symbol) - externals.begin();
+            target = text_ + stubOffset + index * kStubSize;
+        }
+        unsigned char* place = text_ + reloc.offset;
+        int64_t value = (target - place) + reloc.addend;
+        int32_t value32 = static_cast<int32_t>(value);
+        if (value32 != value) {
+            munmap(memory_, size_);
+            memory_ = nullptr;
+            throw std::runtime_error("JIT: relocation out of range for " + reloc.symbol);
+        }
+        std::memcpy(place, &value32, sizeof(value32));
+    }
+
+    // W^X：代码段写完后只读可执行
+    if (mprotect(text_, codeSize, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory_, size_);
+        memory_ = nullptr;
+        throw std::runtime_error("JIT: mprotect failed");
+    }
+#else
+    throw std::runtime_error("JIT: --run is only supported on x86-64 Unix hosts");
+#endif
+}
+
+JitProgram::~JitProgram() {
+#ifdef JIT_SUPPORTED
+    if (memory_) {
+        munmap(memory_, size_);
+    }
+#endif
+}
+
+int JitProgram::run(const std::string& entry) {
+    auto it = asm_.symbols().find(entry);
+    if (it == asm_.symbols().end() || it->second.section != Assembler::Section::Text) {
+        throw std::runtime_error("JIT: entry point not found: " + entry);
+    }
+    using EntryFunction = int (*)();
+    EntryFunction function;
+    void* address = text_ + it->second.offset;
+    std::memcpy(&function, &address, sizeof(function)); // 对象指针转函数指针
+    int result = function();
+    println_int_flush();
+    profile_write(); // 计数器在JIT的数据段中，释放之前写出
+    std::fflush(stdout);
+    return result;
+}
@@ -0,0 +1,35 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "Assembler.h"
+#include <cstddef>
+
+/*
+ * 内存中执行（--run）
+ * 把x86-64 Assembler的结果复制到mmap得到的内存中，在进程内完成重定位后直接调用main：
+ *   - .text 与外部函数的跳板放在同一段，写完后改为只读可执行
+ *   - .data 单独放在可读写的页中
+ *   - 外部符号（printf）解析为宿主进程中的函数，通过跳板 jmp [rip+0] 跳转，
+ *     避免rel32够不到共享库的地址
+ */
+class JitProgram {
+public:
+    explicit JitProgram(const Assembler& assembler);
+    ~JitProgram();
+    JitProgram(const JitProgram&) = delete;
+    JitProgram& operator=(const JitProgram&) = delete;
+
+    // 调用入口函数并返回其返回值
+    int run(const std::string& entry = "main");
+
+private:
+    const Assembler& asm_;
+    unsigned char* memory_ = nullptr;
+    size_t size_ = 0;
+    unsigned char* text_ = nullptr;
+    unsigned char* data_ = nullptr;
+
+    static void* hostSymbol(const std::string& name);
+};
+
+#endif // JIT_H
@@ -1,12 +1,202 @@
 #include "Lexer.h"
+#include <algorithm>
+#include <exception>
+#include <limits>
+#include <thread>
+
+namespace {
+
+// ÿôֽڣ̫Сʱ̵߳Ŀ
+const size_t kMinChunkSize = 1u << 20;
+
+void checkSourceSize(const std::string& source){
+    if(source.size() > std::numeric_limits<uint32_t>::max()){
+        throw SyntaxError("Source file too large (token offsets are 32-bit)", 0);
+    }
+}
+
+} // namespace
+
+const char* tokenSpelling(TokenType type){
+    switch(type){
+        case TokenType::INT: return "int";
+        case TokenType::RETURN: return "return";
+        case TokenType::VOID: return "void";
+        case TokenType::PRINTLIN: return "println_int";
+        case TokenType::EQUAL: return "=";
+        case TokenType::PLUS: return "+";
+        case TokenType::MINUS: return "-";
+        case TokenType::MULTIPLY: return "*";
+        case TokenType::DIVIDE: return "/";
+        case TokenType::REMAINDER: return "%";
+        case TokenType::LESS: return "<";
+        case TokenType::GREATER: return ">";
+        case TokenType::LESS_EQUAL: return "<=";
+        case TokenType::GREATER_EQUAL: return ">=";
+        case TokenType::EQUAL_EQUAL: return "==";
+        case TokenType::NOT_EQUAL: return "!=";
+        case TokenType::AND: return "&";
+        case TokenType::OR: return "|";
+        case TokenType::NOR: return "^";
+        case TokenType::NOT: return "!";
+        case TokenType::AND_AND: return "&&";
+        case TokenType::OR_OR: return "||";
+        case TokenType::SEMICOLON: return ";";
+        case TokenType::LPAREN: return "(";
+        case TokenType::RPAREN: return ")";
+        case TokenType::LBRACE: return "{";
+        case TokenType::RBRACE: return "}";
+        case TokenType::COMMA: return ",";
+        case TokenType::IF: return "if";
+        case TokenType::ELSE: return "else";
+        case TokenType::WHILE: return "while";
+        case TokenType::CONTINUE: return "continue";
+        case TokenType::BREAK: return "break";
+        default: return "";
+    }
+}
+
+std::string TokenStream::text(size_t i) const{
+    switch(type(i)){
+        case TokenType::IDENT: return name(i);
+        case TokenType::DIGIT: return std::to_string(value(i));
+        default: return tokenSpelling(type(i));
+    }
+}
+
+uint32_t TokenStream::intern(const std::string& name){
+    auto it = ids_.find(name);
+    if(it != ids_.end()){
+        return it->second;
+    }
+    uint32_t id = static_cast<uint32_t>(names_.size());
+    names_.push_back(name);
+    ids_.emplace(name, id);
+    return id;
+}
+
+void TokenStream::shrinkToFit(){
+    types_.shrink_to_fit();
+    offsets_.shrink_to_fit();
+    values_.shrink_to_fit();
+}
+
+size_t TokenStream::memoryUsage() const{
+    size_t bytes = types_.capacity() + (offsets_.capacity() + values_.capacity()) * sizeof(uint32_t);
+    for(const auto& name : names_){
+        bytes += sizeof(name) + (name.capacity() > 15 ? name.capacity() + 1 : 0);
+    }
+    return bytes;
+}
 
 // ʼַʽԴ
 Lexer::Lexer(const std::string& source): source(source){}
 
-// ʷһTokenб
-std::vector<Token> Lexer::tokenize(){
-    std::vector<Token> tokens;
-    while(pos < source.size()){
+// ʷtoken
+TokenStream Lexer::tokenize(){
+    checkSourceSize(source);
+    TokenStream tokens;
+    scan(0, source.size(), tokens);
+    tokens.push(TokenType::END, source.size()); // ļ
+    tokens.shrinkToFit();
+    return tokens;
+}
+
+TokenStream Lexer::tokenizeParallel(unsigned threads){
+    if(threads == 0){
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    size_t chunks = std::min<size_t>(threads, source.size() / kMinChunkSize);
+    if(chunks <= 1){
+        return tokenize();
+    }
+
+    // ı߽Ƶһհַӿհ״¿ʼ˳״̬ͬ
+    std::vector<size_t> bounds(1, 0);
+    for(size_t i = 1; i < chunks; ++i){
+        size_t split = std::max(source.size() / chunks * i, bounds.back());
+        while(split < source.size() && !isspace(static_cast<unsigned char>(source[split]))){
+            split++;
+        }
+        if(split > bounds.back() && split < source.size()){
+            bounds.push_back(split);
+        }
+    }
+    bounds.push_back(source.size());
+    chunks = bounds.size() - 1;
+
+    checkSourceSize(source);
+    std::vector<TokenStream> parts(chunks);
+    std::vector<std::exception_ptr> errors(chunks);
+    std::vector<std::thread> workers;
+    for(size_t i = 0; i < chunks; ++i){
+        workers.emplace_back([this, &bounds, &parts, &errors, i]{
+            try{
+                scan(bounds[i], bounds[i + 1], parts[i]);
+            }catch(...){
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+    for(auto& worker : workers){
+        worker.join();
+    }
+    for(const auto& error : errors){
+        if(error) std::rethrow_exception(error); // ǰĿеĴ˳ᱨĴ
+    }
+
+    // ǰ׺ͰѸtokenƶ
+    std::vector<size_t> starts(chunks + 1, 0);
+    for(size_t i = 0; i < chunks; ++i){
+        starts[i + 1] = starts[i] + parts[i].size();
+    }
+    // ֱŰ˳ϲȫֱ˳ıͬ
+    TokenStream tokens;
+    std::vector<std::vector<uint32_t>> remap(chunks);
+    for(size_t i = 0; i < chunks; ++i){
+        for(const auto& name : parts[i].names_){
+            remap[i].push_back(tokens.intern(name));
+        }
+    }
+    size_t total = starts[chunks] + 1;
+    tokens.types_.resize(total);
+    tokens.offsets_.resize(total);
+    tokens.values_.resize(total);
+    workers.clear();
+    for(size_t i = 0; i < chunks; ++i){
+        workers.emplace_back([&tokens, &parts, &starts, &remap, i]{
+            TokenStream& part = parts[i];
+            size_t base = starts[i];
+            std::copy(part.types_.begin(), part.types_.end(), tokens.types_.begin() + base);
+            std::copy(part.offsets_.begin(), part.offsets_.end(), tokens.offsets_.begin() + base);
+            for(size_t j = 0; j < part.size(); ++j){
+                uint32_t value = part.values_[j];
+                tokens.values_[base + j] = part.type(j) == TokenType::IDENT ? remap[i][value] : value;
+            }
+            part = TokenStream();
+        });
+    }
+    for(auto& worker : workers){
+        worker.join();
+    }
+    tokens.types_.back() = static_cast<uint8_t>(TokenType::END);
+    tokens.offsets_.back() = static_cast<uint32_t>(source.size());
+    tokens.values_.back() = 0;
+    return tokens;
+}
+
+size_t Lexer::scanFunctions(size_t begin, size_t minTokens, TokenStream& tokens) const{
+    checkSourceSize(source);
+    size_t pos = scan(begin, source.size(), tokens, minTokens);
+    tokens.push(TokenType::END, pos);
+    return pos;
+}
+
+size_t Lexer::scan(size_t begin, size_t stop, TokenStream& tokens, size_t minTokens) const{
+    size_t pos = begin;
+    int depth = 0; // 
+    while(pos < stop){
+        size_t start = pos;
         char current = source[pos];
         if(isspace(current)){ 
             // հַ
@@ -17,17 +207,17 @@ std::vector<Token> Lexer::tokenize(){
 
         else if(current == 'i' && source.substr(pos, 3) == "int"){
             // int
-            tokens.push_back({TokenType::INT, "int"});
+            tokens.push(TokenType::INT, start);
             pos += 3;
         }
         else if(current == 'p' && source.substr(pos, 11) == "println_int"){
             // println_int
-            tokens.push_back({TokenType::PRINTLIN, "println_int"});
+            tokens.push(TokenType::PRINTLIN, start);
             pos += 11;
         }
         else if(current == 'r' && source.substr(pos, 6) == "return"){
             // return
-            tokens.push_back({TokenType::RETURN, "return"});
+            tokens.push(TokenType::RETURN, start);
             pos += 6;
         }
         // else if(current == 'm' && source.substr(pos, 4) == "main"){
@@ -37,31 +227,31 @@ std::vector<Token> Lexer::tokenize(){
         // }
         else if(current == 'v' && source.substr(pos, 4) == "void"){
             // void
-            tokens.push_back({TokenType::VOID, "void"});
+            tokens.push(TokenType::VOID, start);
             pos += 4;
         }
                 else if(current == 'i' && source.substr(pos, 2) == "if"){
             // if
-            tokens.push_back({TokenType::IF, "if"});
+            tokens.push(TokenType::IF, start);
             pos += 2;
         }
         else if(current == 'e' && source.substr(pos, 4) == "else"){
-            tokens.push_back({TokenType::ELSE, "else"});
+            tokens.push(TokenType::ELSE, start);
             pos += 4;
         }
         else if(current == 'w' && source.substr(pos, 5) == "while"){
             // while
-            tokens.push_back({TokenType::WHILE, "while"});
+            tokens.push(TokenType::WHILE, start);
             pos += 5;
         }
         else if(current == 'c' && source.substr(pos, 8) == "continue"){
             // continue
-            tokens.push_back({TokenType::CONTINUE, "continue"});
+            tokens.push(TokenType::CONTINUE, start);
             pos += 8;
         }
         else if(current == 'b' && source.substr(pos, 5) == "break"){
             // break
-            tokens.push_back({TokenType::BREAK, "break"});
+            tokens.push(TokenType::BREAK, start);
             pos += 5;
         }
 
@@ -73,7 +263,15 @@ std::vector<Token> Lexer::tokenize(){
             while(end < source.size() && isdigit(source[end])){
                 end++;
             }
-            tokens.push_back({TokenType::DIGIT, source.substr(pos, end - pos)});
+            // ԤȽֵ﷨תַ
+            uint64_t value = 0;
+            for(size_t i = pos; i < end; ++i){
+                value = value * 10 + static_cast<uint64_t>(source[i] - '0');
+                if(value > static_cast<uint64_t>(std::numeric_limits<int>::max())){
+                    throw SyntaxError("Integer literal out of range", start);
+                }
+            }
+            tokens.push(TokenType::DIGIT, start, static_cast<uint32_t>(value));
             pos = end;
         }
         else if(isalpha(current) || current == '_'){
@@ -82,7 +280,7 @@ std::vector<Token> Lexer::tokenize(){
             while(end < source.size() && (isalnum(source[end]) || source[end] == '_')){
                 end++;
             }
-            tokens.push_back({TokenType::IDENT, source.substr(pos, end - pos)});
+            tokens.push(TokenType::IDENT, start, tokens.intern(source.substr(pos, end - pos)));
             pos = end;
         }
 
@@ -91,52 +289,52 @@ std::vector<Token> Lexer::tokenize(){
 
         else if(current == '='){
             if(source[pos + 1] == '='){
-                tokens.push_back({TokenType::EQUAL_EQUAL, "=="});
+                tokens.push(TokenType::EQUAL_EQUAL, start);
                 pos += 2;
             }
             else{
-                tokens.push_back({TokenType::EQUAL, "="});
+                tokens.push(TokenType::EQUAL, start);
                 pos++;
             }
         }
         else if(current == '+'){
-            tokens.push_back({TokenType::PLUS, "+"});
+            tokens.push(TokenType::PLUS, start);
             pos++;
         }
         else if(current == '-'){
-            tokens.push_back({TokenType::MINUS, "-"});
+            tokens.push(TokenType::MINUS, start);
             pos++;
         }
         else if(current == '*'){
-            tokens.push_back({TokenType::MULTIPLY, "*"});
+            tokens.push(TokenType::MULTIPLY, start);
             pos++;
         }
         else if(current == '/'){
-            tokens.push_back({TokenType::DIVIDE, "/"});
+            tokens.push(TokenType::DIVIDE, start);
             pos++;
         }
         else if(current == '%'){
-            tokens.push_back({TokenType::REMAINDER, "%"});
+            tokens.push(TokenType::REMAINDER, start);
             pos++;
         }
 
         else if(current == '<'){
             if(source[pos + 1] == '='){
-                tokens.push_back({TokenType::LESS_EQUAL, "<="});
+                tokens.push(TokenType::LESS_EQUAL, start);
                 pos += 2;
             }
             else{
-                tokens.push_back({TokenType::LESS, "<"});
+                tokens.push(TokenType::LESS, start);
                 pos++;
             }
         }
         else if(current == '>'){
             if(source[pos + 1] == '='){
-                tokens.push_back({TokenType::GREATER_EQUAL, ">="});
+                tokens.push(TokenType::GREATER_EQUAL, start);
                 pos += 2;
             }
             else{
-                tokens.push_back({TokenType::GREATER, ">"});
+                tokens.push(TokenType::GREATER, start);
                 pos++;
             }
         }
@@ -145,68 +343,74 @@ std::vector<Token> Lexer::tokenize(){
         
         else if(current == '&'){
             if(source[pos + 1] == '&'){
-                tokens.push_back({TokenType::AND_AND, "&&"});
+                tokens.push(TokenType::AND_AND, start);
                 pos += 2;
             }
             else{
-                tokens.push_back({TokenType::AND, "&"});
+                tokens.push(TokenType::AND, start);
                 pos++;
             }
         }
         else if(current == '|'){
             if(source[pos + 1] == '|'){
-                tokens.push_back({TokenType::OR_OR, "||"});
+                tokens.push(TokenType::OR_OR, start);
                 pos += 2;
             }
             else{
-                tokens.push_back({TokenType::OR, "|"});
+                tokens.push(TokenType::OR, start);
                 pos++;
             }
         }
         else if(current == '!'){
             if(source[pos + 1] == '='){
-                tokens.push_back({TokenType::NOT_EQUAL, "!="});
+                tokens.push(TokenType::NOT_EQUAL, start);
                 pos += 2;
             }
             else{
-                tokens.push_back({TokenType::NOT, "!"});
+                tokens.push(TokenType::NOT, start);
                 pos++;
             }
         }
 
         else if (current == '^'){
-            tokens.push_back({TokenType::NOR, "^"});
+            tokens.push(TokenType::NOR, start);
             pos++;
         }
 
         else if(current == '('){
-            tokens.push_back({TokenType::LPAREN, "("});
+            tokens.push(TokenType::LPAREN, start);
             pos++;
         }
         else if(current == ')'){
-            tokens.push_back({TokenType::RPAREN, ")"});
+            tokens.push(TokenType::RPAREN, start);
             pos++;
         }
         else if(current == ';'){
-            tokens.push_back({TokenType::SEMICOLON, ";"});
+            tokens.push(TokenType::SEMICOLON, start);
             pos++;
         }
         else if(current == '{'){
-            tokens.push_back({TokenType::LBRACE, "{"});
+            tokens.push(TokenType::LBRACE, start);
             pos++;
+            depth++;
         }
         else if(current == '}'){
-            tokens.push_back({TokenType::RBRACE, "}"});
+            tokens.push(TokenType::RBRACE, start);
             pos++;
+            if(--depth == 0 && tokens.size() >= minTokens){
+                break; // һ㺯
+            }
         }
         else if(current == ','){
-            tokens.push_back({TokenType::COMMA, ","});
+            tokens.push(TokenType::COMMA, start);
             pos++;
         }
-        
+        else{
+            // ʶַͣԭѭ
+            throw SyntaxError(std::string("Unexpected character '") + current + "'", pos);
+        }
     }
-    tokens.push_back({TokenType::END, ""}); // ļ
-    return tokens;
+    return pos;
 }
 
 /*
@@ -5,7 +5,11 @@
 #include <string>
 #include <vector>
 #include <cctype>
+#include <cstdint>
 #include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
 
 enum class TokenType{
     INT, RETURN, 
@@ -27,20 +31,75 @@ enum class TokenType{
 };
 // Ҫʶĵ
 
-struct Token{
-    TokenType type;
-    std::string lexeme;
+// ؼֺƴдIDENTDIGITENDؿմ
+const char* tokenSpelling(TokenType type);
+
+/*
+ * tokenУд洢1ֽڡԴеֽƫ4ֽڡֵ4ֽڣÿtoken 9ֽڡ
+ * ֵIDENTֵıţȥغֻһݣDIGITǴʷʱõtokenΪ0
+ * ؼֺ;﷨ǰֻtypes_ٷַ
+ */
+class TokenStream{
+public:
+    size_t size() const { return types_.size(); }
+    TokenType type(size_t i) const { return static_cast<TokenType>(types_[i]); }
+    size_t offset(size_t i) const { return offsets_[i]; }
+    int value(size_t i) const { return static_cast<int>(values_[i]); }       // DIGIT
+    const std::string& name(size_t i) const { return names_[values_[i]]; }   // IDENT
+    // token֣ʶ֡ʮƱʾؼ֡ƴд
+    std::string text(size_t i) const;
+
+    void push(TokenType type, size_t offset, uint32_t value = 0){
+        types_.push_back(static_cast<uint8_t>(type));
+        offsets_.push_back(static_cast<uint32_t>(offset));
+        values_.push_back(value);
+    }
+    // ֵıţһγʱ
+    uint32_t intern(const std::string& name);
+    // ͷŸжʷã
+    void shrinkToFit();
+    // ռõֽƣֱ
+    size_t memoryUsage() const;
+
+private:
+    friend class Lexer; // зʱƴӸ
+    std::vector<uint8_t> types_;
+    std::vector<uint32_t> offsets_;
+    std::vector<uint32_t> values_;
+    std::vector<std::string> names_;
+    std::unordered_map<std::string, uint32_t> ids_;
+};
+
+// ʷ﷨󣬴λãԴеֽƫƣ
+class SyntaxError : public std::runtime_error {
+public:
+    SyntaxError(const std::string& message, size_t offset) : std::runtime_error(message), offset(offset) {}
+    size_t offset;
 };
 
 
 class Lexer{
 public:
     Lexer(const std::string& source);
-    std::vector<Token> tokenize();
+    TokenStream tokenize();
+
+    // дʷڿհ״Դгɿ飬ÿһ߳зٰ˳ƴӡ
+    // ûпԽհ׵tokenûַעͣtokenize()ȫͬ
+    // дʱԴǰǸthreadsΪ0ʱʹCPUԴСʱֱӵtokenize()
+    TokenStream tokenizeParallel(unsigned threads = 0);
+
+    // ʷˮ߱ãbeginʼչminTokenstokenĳ㺯Ľβ
+    // һʹȻص0ͣ£׷ENDһĿʼλãԴ볤ʱѷꡣ
+    // ƴӣȥмENDtokenize()Ľͬ
+    size_t scanFunctions(size_t begin, size_t minTokens, TokenStream& tokens) const;
 
 private:
     const std::string source;
-    size_t pos = 0;
+
+    // [begin, stop)еtoken׷ӵtokensENDstopǿհַλûԴĩβ
+    // tokensminTokenstokenʱһ㺯Ľβǰͣ£ͣµλ
+    size_t scan(size_t begin, size_t stop, TokenStream& tokens,
+                size_t minTokens = std::numeric_limits<size_t>::max()) const;
 };
 
 #endif // LEXER_H
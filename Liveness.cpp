@@ -0,0 +1,106 @@
+#include "Liveness.h"
+
+ParamLiveness::ParamLiveness(const FunctionDecl& func, bool bodyIsLoop) {
+    for (const auto& param : func.params) {
+        uses_[param.second];
+    }
+
+    visit(*func.body);
+    if (bodyIsLoop) {
+        loops_.push_back({0, counter_});
+    }
+
+    for (const auto& site : sites_) {
+        int pos = site.second;
+        auto& live = live_[site.first];
+        for (const auto& param : func.params) {
+            const auto& uses = uses_[param.second];
+            bool isLive = false;
+            for (int use : uses) {
+                if (use > pos) {
+                    isLive = true;
+                    break;
+                }
+                for (const auto& loop : loops_) {
+                    if (loop.begin <= pos && pos <= loop.end && loop.begin <= use && use <= loop.end) {
+                        isLive = true;
+                        break;
+                    }
+                }
+                if (isLive) break;
+            }
+            if (isLive) live.push_back(param.second);
+        }
+    }
+}
+
+const std::vector<std::string>& ParamLiveness::liveAfter(const ASTNode* site) const {
+    static const std::vector<std::string> none;
+    auto it = live_.find(site);
+    return it == live_.end() ? none : it->second;
+}
+
+void ParamLiveness::visit(const Statement& stmt) {
+    if (auto decl = dynamic_cast<const VariableDecl*>(&stmt)) {
+        if (decl->value) visit(*decl->value);
+    } else if (auto assign = dynamic_cast<const Assignment*>(&stmt)) {
+        visit(*assign->value);
+    } else if (auto ret = dynamic_cast<const ReturnStmt*>(&stmt)) {
+        if (ret->value) visit(*ret->value);
+    } else if (auto print = dynamic_cast<const PrintlnIntStmt*>(&stmt)) {
+        visit(*print->arg);
+        sites_.push_back({print, counter_++});
+    } else if (auto exprStmt = dynamic_cast<const ExpressionStatement*>(&stmt)) {
+        visit(*exprStmt->expr);
+    } else if (auto block = dynamic_cast<const Block*>(&stmt)) {
+        for (const auto& s : block->statements) {
+            visit(*s);
+        }
+    } else if (auto cond = dynamic_cast<const ConditionStatement*>(&stmt)) {
+        visit(*cond->condition);
+        visit(*cond->thenBlock);
+        if (cond->elseBlock) visit(*cond->elseBlock);
+    } else if (auto loop = dynamic_cast<const LoopStatement*>(&stmt)) {
+        int begin = counter_;
+        visit(*loop->condition);
+        visit(*loop->body);
+        loops_.push_back({begin, counter_++});
+    } else if (auto inlRet = dynamic_cast<const InlineReturn*>(&stmt)) {
+        if (inlRet->value) visit(*inlRet->value);
+    }
+}
+
+// 用显式栈后序遍历，不随表达式的长度或嵌套深度递归；second表示子节点已经入栈
+void ParamLiveness::visit(const Expression& expr) {
+    std::vector<std::pair<const Expression*, bool>> stack;
+    stack.push_back({&expr, false});
+    while (!stack.empty()) {
+        const Expression* node = stack.back().first;
+        bool expanded = stack.back().second;
+        stack.pop_back();
+        if (auto var = dynamic_cast<const Variable*>(node)) {
+            auto it = uses_.find(var->name);
+            if (it != uses_.end()) it->second.push_back(counter_++);
+        } else if (auto op = dynamic_cast<const BinaryOp*>(node)) {
+            if (!expanded) {
+                stack.push_back({op, true});
+                stack.push_back({op->right.get(), false});
+                stack.push_back({op->left.get(), false});
+            } else if (op->op == "/" || op->op == "%") {
+                sites_.push_back({op, counter_++});
+            }
+        } else if (auto call = dynamic_cast<const FunctionCall*>(node)) {
+            if (!expanded) {
+                // 实参从右到左求值：最右的实参最后入栈、最先访问
+                stack.push_back({call, true});
+                for (const auto& arg : call->args) {
+                    stack.push_back({arg.get(), false});
+                }
+            } else {
+                sites_.push_back({call, counter_++});
+            }
+        } else if (auto inl = dynamic_cast<const InlinedCall*>(node)) {
+            visit(*inl->body);
+        }
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef LIVENESS_H
+#define LIVENESS_H
+
+#include "Parser.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * 参数活跃性分析（保守近似）
+ * 按CodeGen的求值顺序给节点编号（二元运算先左后右，实参从右到左），
+ * 对每个会破坏寄存器的位置（函数调用、println_int、除法/取余），
+ * 若某参数在其后还有读取，或与该位置处于同一循环中且在循环内被读取，则认为它跨该位置活跃。
+ */
+class ParamLiveness {
+public:
+    // bodyIsLoop: 函数有自递归尾调用时整个函数体就是一个循环
+    ParamLiveness(const FunctionDecl& func, bool bodyIsLoop);
+
+    // 在site之后仍需要的参数名
+    const std::vector<std::string>& liveAfter(const ASTNode* site) const;
+
+private:
+    struct Range { int begin; int end; };
+
+    int counter_ = 0;
+    std::unordered_map<std::string, std::vector<int>> uses_; // 参数 -> 读取位置
+    std::vector<std::pair<const ASTNode*, int>> sites_;      // 破坏寄存器的位置
+    std::vector<Range> loops_;
+    std::unordered_map<const ASTNode*, std::vector<std::string>> live_;
+
+    void visit(const Statement& stmt);
+    void visit(const Expression& expr);
+};
+
+#endif // LIVENESS_H
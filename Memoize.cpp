@@ -0,0 +1,102 @@
+#include "Memoize.h"
+#include "ASTUtil.h"
+#include "CallEval.h"
+#include <unordered_set>
+
+namespace {
+
+int countSelfCalls(FunctionDecl& func) {
+    int calls = 0;
+    forEachExprSlot(*func.body, [&](std::unique_ptr<Expression>& slot) {
+        auto call = dynamic_cast<const FunctionCall*>(slot.get());
+        if (call && call->functionName == func.name) calls++;
+    });
+    return calls;
+}
+
+bool intSignature(const FunctionDecl& func) {
+    if (func.returnType != "int" || func.params.empty() ||
+        func.params.size() > static_cast<size_t>(kMemoMaxParams)) {
+        return false;
+    }
+    for (const auto& param : func.params) {
+        if (param.first != "int") return false;
+    }
+    return true;
+}
+
+} // namespace
+
+std::vector<MemoLayout> memoLayout(int paramCount) {
+    std::vector<MemoLayout> parts;
+    int offset = 0;
+    if (paramCount == 1) {
+        MemoLayout direct;
+        direct.direct = true;
+        direct.offset = 0;
+        direct.entries = kMemoDirectEntries;
+        direct.entrySize = 8;
+        direct.valueOffset = 0;
+        direct.validOffset = 4;
+        parts.push_back(direct);
+        offset = direct.entries * direct.entrySize;
+    }
+    MemoLayout hashed;
+    hashed.direct = false;
+    hashed.offset = offset;
+    hashed.entries = kMemoHashEntries;
+    hashed.valueOffset = paramCount * 4;
+    hashed.validOffset = paramCount * 4 + 4;
+    hashed.entrySize = 8;
+    while (hashed.entrySize < (paramCount + 2) * 4) {
+        hashed.entrySize *= 2;
+    }
+    parts.push_back(hashed);
+    return parts;
+}
+
+int memoTableSize(int paramCount) {
+    MemoLayout last = memoLayout(paramCount).back();
+    return last.offset + last.entries * last.entrySize;
+}
+
+int Memoizer::run(Program& program) {
+    changedFunctions.clear();
+    std::unordered_set<std::string> pure = pureFunctions(program);
+    std::unordered_set<std::string> names;
+    for (const auto& func : program.functions) {
+        names.insert(func->name);
+    }
+
+    int memoized = 0;
+    std::vector<std::unique_ptr<FunctionDecl>> functions;
+    for (auto& func : program.functions) {
+        std::unique_ptr<FunctionDecl> helper;
+        std::string helperName = func->name + ".memo";
+        if (pure.count(func->name) && func->memoTarget.empty() && !names.count(helperName) &&
+            intSignature(*func) && countSelfCalls(*func) >= minRecursiveCalls) {
+            // 函数体原样移到辅助函数中，其中的递归调用仍然经过查表的包装函数
+            helper = std::make_unique<FunctionDecl>(func->returnType, helperName, func->params, std::move(func->body));
+            helper->tokenBegin = func->tokenBegin; // 与累加器辅助函数相同，完全由原函数的源码决定
+            helper->tokenEnd = func->tokenEnd;
+            helper->evaluatedCalls = func->evaluatedCalls;
+
+            std::vector<std::unique_ptr<Expression>> args;
+            for (const auto& param : func->params) {
+                args.push_back(std::make_unique<Variable>(param.second));
+            }
+            func->body = std::make_unique<Block>();
+            func->body->addStatement(std::make_unique<ReturnStmt>(
+                std::make_unique<FunctionCall>(helperName, std::move(args))));
+            func->memoTarget = helperName;
+
+            changedFunctions.push_back(func->name);
+            changedFunctions.push_back(helperName);
+            memoized++;
+        }
+        functions.push_back(std::move(func));
+        if (helper) functions.push_back(std::move(helper));
+    }
+    program.functions = std::move(functions);
+    return memoized;
+}
@@ -0,0 +1,60 @@
+#ifndef MEMOIZE_H
+#define MEMOIZE_H
+
+#include "Parser.h"
+#include <string>
+#include <vector>
+
+/*
+ * 记忆化（--memoize）
+ * 满足以下条件的函数 f：
+ *   - 纯函数（pureFunctions），结果只取决于实参
+ *   - 直接自递归，且函数体中自递归的调用点不少于minRecursiveCalls个（朴素的fib这类树形递归）
+ *   - 返回int，有1~kMemoMaxParams个int参数
+ * 原函数体移到辅助函数 f.memo，f 的函数体改为 return f.memo(参数...) 并记下memoTarget。
+ * 代码生成把 f 生成为查表的包装函数，命中时直接返回，否则调用 f.memo 并把结果写入表项；
+ * f.memo 中的递归调用仍然调用 f，每个子问题只计算一次。字节码解释器等按普通转发执行。
+ *
+ * 每个函数一张表（memoTableSymbol，放在.data中），布局见MemoLayout：
+ *   1个参数   按参数直接映射，覆盖 [0, kMemoDirectEntries)；其他参数（包括负数）查紧接在后面的哈希表
+ *   2~3个参数 kMemoHashEntries项的哈希表，h = ((a * M + b) * M + c) & (项数 - 1)，
+ *             表项保存参数，冲突时后写入的覆盖先写入的
+ */
+class Memoizer {
+public:
+    int minRecursiveCalls = 2;
+
+    // 返回记忆化的函数个数
+    int run(Program& program);
+
+    // 最近一次run中改动的函数（包装函数和新增的辅助函数）
+    std::vector<std::string> changedFunctions;
+};
+
+const int kMemoMaxParams = 3;
+const int kMemoDirectEntries = 4096;
+const int kMemoHashEntries = 4096;
+const int kMemoHashMultiplier = -1640531535; // 0x9E3779B1
+
+// 表中一部分的布局。表项：参数（只有哈希表保存）、结果、有效标志，各4字节，表项大小为2的幂
+struct MemoLayout {
+    bool direct;     // 直接映射
+    int offset;      // 这部分在表中的位置
+    int entries;
+    int entrySize;
+    int valueOffset;
+    int validOffset;
+};
+
+// paramCount个参数的函数的表：直接映射的部分（只有1个参数时）在前，哈希表在后
+std::vector<MemoLayout> memoLayout(int paramCount);
+
+// 表的总字节数
+int memoTableSize(int paramCount);
+
+// 包装函数f的表
+inline std::string memoTableSymbol(const std::string& function) {
+    return function + ".memo_table";
+}
+
+#endif // MEMOIZE_H
@@ -0,0 +1,47 @@
+#include "Stats.h"
+#include <cstdlib>
+#include <new>
+
+/*
+ * 替换全局operator new，按线程统计分配的字节数和次数（--stats）
+ * 只链接进Compilerlab2可执行文件：嵌入compilerlab库的程序不受影响。
+ * 所有形式（数组、nothrow、带大小的delete）都要替换：sanitizer运行时自己提供这些形式，
+ * 只替换一部分会让分配和释放落到不同的实现上。
+ */
+
+namespace {
+
+void* allocate(std::size_t size) {
+    AllocationCounters& counters = threadAllocationCounters();
+    counters.bytes += size;
+    counters.count++;
+    if (size == 0) size = 1;
+    for (;;) {
+        if (void* p = std::malloc(size)) return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void* allocateNoThrow(std::size_t size) noexcept {
+    try {
+        return allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+} // namespace
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return allocateNoThrow(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return allocateNoThrow(size); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
@@ -0,0 +1,274 @@
+#include "ObjectWriter.h"
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+// ELF常量（只列出用到的）
+const uint16_t kTypeRelocatable = 1;
+const uint16_t kMachine386 = 3;
+const uint16_t kMachineX86_64 = 62;
+
+const uint32_t kSectionProgbits = 1;
+const uint32_t kSectionSymtab = 2;
+const uint32_t kSectionStrtab = 3;
+const uint32_t kSectionRela = 4;
+const uint32_t kSectionRel = 9;
+
+const uint64_t kFlagWrite = 0x1;
+const uint64_t kFlagAlloc = 0x2;
+const uint64_t kFlagExec = 0x4;
+const uint64_t kFlagInfoLink = 0x40;
+
+const uint8_t kBindLocal = 0;
+const uint8_t kBindGlobal = 1;
+const uint8_t kTypeNone = 0;
+const uint8_t kTypeSection = 3;
+
+const uint32_t kR386_32 = 1;
+const uint32_t kR386_PC32 = 2;
+const uint32_t kRX86_64_PC32 = 2;
+const uint32_t kRX86_64_PLT32 = 4;
+
+// 节的下标
+enum : uint16_t {
+    kNull, kText, kData, kRelText, kSymtab, kStrtab, kShstrtab, kNoteStack, kSectionCount
+};
+
+class StringTable {
+public:
+    StringTable() : data_(1, '\0') {}
+    uint32_t add(const std::string& s) {
+        uint32_t offset = static_cast<uint32_t>(data_.size());
+        data_ += s;
+        data_ += '\0';
+        return offset;
+    }
+    const std::string& data() const { return data_; }
+
+private:
+    std::string data_;
+};
+
+struct SymbolEntry {
+    uint32_t name;
+    uint64_t value;
+    uint8_t info;
+    uint16_t section;
+};
+
+struct SectionHeader {
+    uint32_t name = 0;
+    uint32_t type = 0;
+    uint64_t flags = 0;
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    uint32_t link = 0;
+    uint32_t info = 0;
+    uint64_t align = 1;
+    uint64_t entsize = 0;
+};
+
+} // namespace
+
+ObjectWriter::ObjectWriter(const Assembler& assembler) : asm_(assembler), x64_(assembler.isX64()) {}
+
+void ObjectWriter::put16(uint16_t v) {
+    put8(static_cast<uint8_t>(v));
+    put8(static_cast<uint8_t>(v >> 8));
+}
+
+void ObjectWriter::put32(uint32_t v) {
+    put16(static_cast<uint16_t>(v));
+    put16(static_cast<uint16_t>(v >> 16));
+}
+
+void ObjectWriter::put64(uint64_t v) {
+    put32(static_cast<uint32_t>(v));
+    put32(static_cast<uint32_t>(v >> 32));
+}
+
+void ObjectWriter::putWord(uint64_t v) {
+    if (x64_) put64(v);
+    else put32(static_cast<uint32_t>(v));
+}
+
+void ObjectWriter::align(size_t alignment) {
+    while (buf_.size() % alignment != 0) put8(0);
+}
+
+void ObjectWriter::write(std::ostream& out) {
+    buf_.clear();
+    const size_t headerSize = x64_ ? 64 : 52;
+    const size_t sectionHeaderSize = x64_ ? 64 : 40;
+    const size_t symbolSize = x64_ ? 24 : 16;
+    const size_t relocationSize = x64_ ? 24 : 8;
+    const size_t wordAlign = x64_ ? 8 : 4;
+
+    // 符号表：空符号、两个节符号、局部标签，然后是全局符号（已定义的和外部引用的）
+    StringTable strtab;
+    std::vector<SymbolEntry> symbols;
+    std::unordered_map<std::string, uint32_t> symbolIndex;
+    symbols.push_back({0, 0, 0, 0});
+    symbols.push_back({0, 0, static_cast<uint8_t>((kBindLocal << 4) | kTypeSection), kText});
+    symbols.push_back({0, 0, static_cast<uint8_t>((kBindLocal << 4) | kTypeSection), kData});
+
+    auto sectionOf = [](Assembler::Section section) -> uint16_t {
+        return section == Assembler::Section::Text ? kText : kData;
+    };
+    for (const auto& name : asm_.symbolOrder()) {
+        if (asm_.isGlobal(name)) continue;
+        if (name.compare(0, 2, ".L") == 0) continue; // 与GNU as一致，.L开头的局部标签不进入符号表
+        const auto& sym = asm_.symbols().at(name);
+        symbols.push_back({strtab.add(name), sym.offset, static_cast<uint8_t>((kBindLocal << 4) | kTypeNone),
+                           sectionOf(sym.section)});
+    }
+    uint32_t firstGlobal = static_cast<uint32_t>(symbols.size());
+    for (const auto& name : asm_.symbolOrder()) {
+        if (!asm_.isGlobal(name)) continue;
+        const auto& sym = asm_.symbols().at(name);
+        symbolIndex[name] = static_cast<uint32_t>(symbols.size());
+        symbols.push_back({strtab.add(name), sym.offset, static_cast<uint8_t>((kBindGlobal << 4) | kTypeNone),
+                           sectionOf(sym.section)});
+    }
+    for (const auto& reloc : asm_.relocations()) {
+        if (asm_.symbols().count(reloc.symbol) || symbolIndex.count(reloc.symbol)) continue;
+        symbolIndex[reloc.symbol] = static_cast<uint32_t>(symbols.size());
+        symbols.push_back({strtab.add(reloc.symbol), 0, static_cast<uint8_t>((kBindGlobal << 4) | kTypeNone), 0});
+    }
+
+    // 已定义符号的引用改为相对节符号加偏移，未定义符号直接引用
+    std::vector<uint8_t> text = asm_.text();
+    struct RelocEntry { uint64_t offset; uint32_t symbol; uint32_t type; int64_t addend; };
+    std::vector<RelocEntry> relocs;
+    for (const auto& reloc : asm_.relocations()) {
+        RelocEntry entry{reloc.offset, 0, 0, reloc.addend};
+        auto defined = asm_.symbols().find(reloc.symbol);
+        if (defined != asm_.symbols().end()) {
+            entry.symbol = sectionOf(defined->second.section) == kText ? 1 : 2;
+            entry.addend += defined->second.offset;
+        } else {
+            entry.symbol = symbolIndex.at(reloc.symbol);
+        }
+        if (x64_) {
+            if (reloc.kind == Assembler::Relocation::Abs32) {
+                throw std::runtime_error("ObjectWriter: 32-bit absolute relocation in 64-bit code");
+            }
+            entry.type = defined == asm_.symbols().end() ? kRX86_64_PLT32 : kRX86_64_PC32;
+        } else {
+            entry.type = reloc.kind == Assembler::Relocation::Abs32 ? kR386_32 : kR386_PC32;
+            // REL格式的加数写在被修改的位置上
+            uint32_t value = static_cast<uint32_t>(entry.addend);
+            for (int i = 0; i < 4; ++i) {
+                text[reloc.offset + i] = static_cast<uint8_t>(value >> (8 * i));
+            }
+        }
+        relocs.push_back(entry);
+    }
+
+    StringTable shstrtab;
+    SectionHeader sections[kSectionCount];
+    sections[kText].name = shstrtab.add(".text");
+    sections[kData].name = shstrtab.add(".data");
+    sections[kRelText].name = shstrtab.add(x64_ ? ".rela.text" : ".rel.text");
+    sections[kSymtab].name = shstrtab.add(".symtab");
+    sections[kStrtab].name = shstrtab.add(".strtab");
+    sections[kShstrtab].name = shstrtab.add(".shstrtab");
+    sections[kNoteStack].name = shstrtab.add(".note.GNU-stack");
+
+    // 先写节的内容，最后写节头表
+    buf_.resize(headerSize, 0);
+
+    align(16);
+    sections[kText] = {sections[kText].name, kSectionProgbits, kFlagAlloc | kFlagExec, buf_.size(), text.size(), 0, 0, 16, 0};
+    buf_.insert(buf_.end(), text.begin(), text.end());
+
+    align(4);
+    sections[kData] = {sections[kData].name, kSectionProgbits, kFlagAlloc | kFlagWrite, buf_.size(), asm_.data().size(), 0, 0, 4, 0};
+    buf_.insert(buf_.end(), asm_.data().begin(), asm_.data().end());
+
+    align(wordAlign);
+    sections[kRelText] = {sections[kRelText].name, x64_ ? kSectionRela : kSectionRel, kFlagInfoLink, buf_.size(),
+                          relocs.size() * relocationSize, kSymtab, kText, wordAlign, relocationSize};
+    for (const auto& r : relocs) {
+        if (x64_) {
+            put64(r.offset);
+            put64((static_cast<uint64_t>(r.symbol) << 32) | r.type);
+            put64(static_cast<uint64_t>(r.addend));
+        } else {
+            put32(static_cast<uint32_t>(r.offset));
+            put32((r.symbol << 8) | r.type);
+        }
+    }
+
+    align(wordAlign);
+    sections[kSymtab] = {sections[kSymtab].name, kSectionSymtab, 0, buf_.size(),
+                         symbols.size() * symbolSize, kStrtab, firstGlobal, wordAlign, symbolSize};
+    for (const auto& sym : symbols) {
+        if (x64_) {
+            put32(sym.name);
+            put8(sym.info);
+            put8(0);
+            put16(sym.section);
+            put64(sym.value);
+            put64(0);
+        } else {
+            put32(sym.name);
+            put32(static_cast<uint32_t>(sym.value));
+            put32(0);
+            put8(sym.info);
+            put8(0);
+            put16(sym.section);
+        }
+    }
+
+    sections[kStrtab] = {sections[kStrtab].name, kSectionStrtab, 0, buf_.size(), strtab.data().size(), 0, 0, 1, 0};
+    buf_.insert(buf_.end(), strtab.data().begin(), strtab.data().end());
+
+    sections[kShstrtab] = {sections[kShstrtab].name, kSectionStrtab, 0, buf_.size(), shstrtab.data().size(), 0, 0, 1, 0};
+    buf_.insert(buf_.end(), shstrtab.data().begin(), shstrtab.data().end());
+
+    sections[kNoteStack] = {sections[kNoteStack].name, kSectionProgbits, 0, buf_.size(), 0, 0, 0, 1, 0};
+
+    align(wordAlign);
+    uint64_t sectionHeaderOffset = buf_.size();
+    for (const auto& sh : sections) {
+        put32(sh.name);
+        put32(sh.type);
+        putWord(sh.flags);
+        putWord(0); // addr
+        putWord(sh.offset);
+        putWord(sh.size);
+        put32(sh.link);
+        put32(sh.info);
+        putWord(sh.align);
+        putWord(sh.entsize);
+    }
+
+    // ELF头：写在新的buf_中，再复制到body开头预留的位置
+    std::vector<uint8_t> body;
+    body.swap(buf_);
+    buf_.reserve(headerSize);
+    const uint8_t ident[16] = {0x7F, 'E', 'L', 'F', static_cast<uint8_t>(x64_ ? 2 : 1), 1, 1, 0};
+    buf_.insert(buf_.end(), ident, ident + 16);
+    put16(kTypeRelocatable);
+    put16(x64_ ? kMachineX86_64 : kMachine386);
+    put32(1);                   // version
+    putWord(0);                 // entry
+    putWord(0);                 // phoff
+    putWord(sectionHeaderOffset);
+    put32(0);                   // flags
+    put16(static_cast<uint16_t>(headerSize));
+    put16(0);                   // phentsize
+    put16(0);                   // phnum
+    put16(static_cast<uint16_t>(sectionHeaderSize));
+    put16(kSectionCount);
+    put16(kShstrtab);
+    std::copy(buf_.begin(), buf_.end(), body.begin());
+
+    out.write(reinterpret_cast<const char*>(body.data()), static_cast<std::streamsize>(body.size()));
+    if (!out) {
+        throw std::runtime_error("ObjectWriter: write failed");
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef OBJECT_WRITER_H
+#define OBJECT_WRITER_H
+
+#include "Assembler.h"
+#include <ostream>
+
+/*
+ * 把Assembler的结果写成ELF可重定位目标文件（.o）
+ *   - 32位：ELFCLASS32/EM_386，.rel.text，R_386_PC32 / R_386_32（隐式加数写在指令中）
+ *   - 64位：ELFCLASS64/EM_X86_64，.rela.text，外部函数用R_X86_64_PLT32，数据用R_X86_64_PC32
+ * 节：.text .data .rel(a).text .symtab .strtab .shstrtab .note.GNU-stack
+ */
+class ObjectWriter {
+public:
+    explicit ObjectWriter(const Assembler& assembler);
+    void write(std::ostream& out);
+
+private:
+    const Assembler& asm_;
+    bool x64_;
+    std::vector<uint8_t> buf_;
+
+    void put8(uint8_t v) { buf_.push_back(v); }
+    void put16(uint16_t v);
+    void put32(uint32_t v);
+    void put64(uint64_t v);
+    void putWord(uint64_t v); // 32位文件写4字节，64位文件写8字节
+    void align(size_t alignment);
+};
+
+#endif // OBJECT_WRITER_H
@@ -1,5 +1,13 @@
 #include "Parser.h"
+#include "ThreadPool.h"
+#include <algorithm>
 #include <cstdio>
+#include <exception>
+#include <iterator>
+#include <thread>
+
+// ﷨ʱÿôtokenСֱ˳
+const size_t kMinChunkTokens = 1u << 15;
 	
 /**
  * @brief 
@@ -8,6 +16,8 @@
  * ﷨: int IDENT ( [int IDENT (, int IDENT)*] ) { ... }
  */
 std::unique_ptr<FunctionDecl> Parser::parseFunction() {
+    size_t tokenBegin = current;
+
     // 
     std::string returnType;
     if (match(TokenType::INT)) {
@@ -15,12 +25,12 @@ std::unique_ptr<FunctionDecl> Parser::parseFunction() {
     } else if (match(TokenType::VOID)) {
         returnType = "void";
     } else {
-        throw std::runtime_error("Expect return type (int/void)");
+        throw SyntaxError("Expect return type (int/void)", peekOffset());
     }
     
     // 
     consume(TokenType::IDENT, "Expect function name");
-    std::string funcName = previous().lexeme;
+    std::string funcName = previousName();
     
     // б
     consume(TokenType::LPAREN, "Expect '(' after function name");
@@ -31,7 +41,7 @@ std::unique_ptr<FunctionDecl> Parser::parseFunction() {
             // ֻint
             consume(TokenType::INT, "Expect parameter type");
             consume(TokenType::IDENT, "Expect parameter name");
-            params.emplace_back("int", previous().lexeme);
+            params.emplace_back("int", previousName());
         } while (match(TokenType::COMMA));
     }
     
@@ -40,11 +50,137 @@ std::unique_ptr<FunctionDecl> Parser::parseFunction() {
     
     auto body = parseBlock();
     
-    return std::make_unique<FunctionDecl>(
+    auto func = std::make_unique<FunctionDecl>(
         returnType, 
         funcName, 
         std::move(params), 
         std::move(body));
+    func->tokenBegin = tokenBegin;
+    func->tokenEnd = current;
+    return func;
+}
+
+/**
+ * @brief Ԥɨ躯ǩ
+ * @return ÿֺͲ
+ *
+ * ƥ (int|void) IDENT ( [int IDENT (, int IDENT)*] ) { ... }尴
+ */
+std::vector<std::pair<std::string, int>> Parser::scanSignatures() const {
+    std::vector<std::pair<std::string, int>> signatures;
+    size_t i = current;
+    auto at = [this, &i](TokenType type) { return tokens.type(i) == type; };
+    while (at(TokenType::INT) || at(TokenType::VOID)) {
+        if (tokens.type(i + 1) != TokenType::IDENT || tokens.type(i + 2) != TokenType::LPAREN) break;
+        const std::string& name = tokens.name(i + 1);
+        i += 3;
+        int params = 0;
+        while (at(TokenType::INT) && tokens.type(i + 1) == TokenType::IDENT) {
+            params++;
+            i += 2;
+            if (!at(TokenType::COMMA)) break;
+            i++;
+        }
+        if (!at(TokenType::RPAREN) || tokens.type(i + 1) != TokenType::LBRACE) break;
+        i += 2;
+        int depth = 1;
+        while (depth > 0 && !at(TokenType::END)) {
+            if (at(TokenType::LBRACE)) depth++;
+            else if (at(TokenType::RBRACE)) depth--;
+            i++;
+        }
+        if (depth > 0) break;
+        signatures.emplace_back(name, params);
+    }
+    return signatures;
+}
+
+/**
+ * @brief Ԥɨ趥㺯tokenΧ
+ * @return ÿ [begin, end)Դ˳
+ *
+ * ﷨ɹĺǡýʹȻص0һţ˸ΧԶ
+ * ʧʱĴͷ˳ͬͬһλÿʼͬtoken
+ */
+std::vector<std::pair<size_t, size_t>> Parser::scanFunctionSpans() const {
+    std::vector<std::pair<size_t, size_t>> spans;
+    size_t end = tokens.size() - 1; // ENDλ
+    size_t i = current;
+    while (i < end) {
+        size_t begin = i;
+        int depth = 0;
+        bool closed = false;
+        while (i < end && !closed) {
+            TokenType type = tokens.type(i++);
+            if (type == TokenType::LBRACE) {
+                depth++;
+            } else if (type == TokenType::RBRACE) {
+                if (--depth < 0) break;
+                closed = depth == 0;
+            }
+        }
+        if (!closed) {
+            spans.emplace_back(begin, end);
+            break;
+        }
+        spans.emplace_back(begin, i);
+    }
+    return spans;
+}
+
+std::unique_ptr<Program> Parser::parseParallel(unsigned threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    // ߳һЩСʱ̳߳صĹȡƽ
+    size_t chunkCount = std::min<size_t>(threads * 4, (tokens.size() - current) / kMinChunkTokens);
+    if (threads <= 1 || chunkCount <= 1) {
+        return parse();
+    }
+
+    // ڵĺϲɿ飬ÿtargettoken
+    size_t target = (tokens.size() - current) / chunkCount;
+    std::vector<std::pair<size_t, size_t>> chunks;
+    for (const auto& span : scanFunctionSpans()) {
+        if (chunks.empty() || chunks.back().second - chunks.back().first >= target) {
+            chunks.push_back(span);
+        } else {
+            chunks.back().second = span.second;
+        }
+    }
+
+    // ÿĺԼУASTڵɸ̷߳
+    std::vector<std::vector<std::unique_ptr<FunctionDecl>>> parts(chunks.size());
+    std::vector<std::exception_ptr> errors(chunks.size());
+    {
+        ThreadPool pool(static_cast<unsigned>(std::min<size_t>(threads, chunks.size())));
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            pool.submit([this, &chunks, &parts, &errors, i] {
+                Parser parser(tokens);
+                parser.current = chunks[i].first;
+                try {
+                    while (parser.current < chunks[i].second && !parser.isAtEnd()) {
+                        parts[i].push_back(parser.parseFunction());
+                    }
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            });
+        }
+        pool.wait();
+    }
+    for (const auto& error : errors) {
+        if (error) std::rethrow_exception(error); // ǰĿеĴ˳ᱨĴ
+    }
+
+    auto program = std::make_unique<Program>();
+    for (auto& part : parts) {
+        for (auto& func : part) {
+            program->functions.push_back(std::move(func));
+        }
+    }
+    current = tokens.size() - 1;
+    return program;
 }
 
 /**
@@ -169,7 +305,7 @@ std::unique_ptr<Statement> Parser::parseVariableDecl() {
     // һ
     do {
         consume(TokenType::IDENT, "Expect variable name");
-        std::string varName = previous().lexeme;
+        std::string varName = previousName();
         
         // Ƿгʼֵ
         std::unique_ptr<Expression> initExpr = nullptr;
@@ -218,7 +354,7 @@ std::unique_ptr<Statement> Parser::parseReturn() {
  */
 std::unique_ptr<Statement> Parser::parseAssignment() {
     // ʶ
-    auto id = std::make_unique<Variable>(peek().lexeme);
+    auto id = std::make_unique<Variable>(peekName());
     advance(); // ıʶ
     advance(); // ĵȺ
     
@@ -244,98 +380,129 @@ std::unique_ptr<Statement> Parser::parsePrintlnInt() {
     return std::make_unique<PrintlnIntStmt>(std::move(arg));
 }
 
-/**
- * @brief ʽ
- * @return رʽASTڵ
- */
-std::unique_ptr<Expression> Parser::parseExpression() {
-    return parseBinaryOp(0);
+namespace {
+
+// ͷűʽӱʽȴӸڵժŽpendingⳤǶ׵ıʽʱݹ
+void releaseExpressions(std::vector<std::unique_ptr<Expression>>& pending) {
+    while (!pending.empty()) {
+        std::unique_ptr<Expression> expr = std::move(pending.back());
+        pending.pop_back();
+        if (auto op = dynamic_cast<BinaryOp*>(expr.get())) {
+            if (op->left) pending.push_back(std::move(op->left));
+            if (op->right) pending.push_back(std::move(op->right));
+        } else if (auto call = dynamic_cast<FunctionCall*>(expr.get())) {
+            for (auto& arg : call->args) {
+                if (arg) pending.push_back(std::move(arg));
+            }
+        }
+    }
 }
 
-/**
- * @brief Ԫʽ
- * @param minPrec Сȼڴȼ
- * @return ضԪʽASTڵ
- */
-std::unique_ptr<Expression> Parser::parseBinaryOp(int minPrec) {
-    // ʽ
-    auto left = parsePrimary();
-
-    // ѭܴڵĶԪ
-    while (true) {
-        auto op = peek();
-
-        int prec = getPrecedence(op.type);
-        // ǰȼСȼֹͣ
-        if (prec < minPrec || !isBinaryOp(op.type)) break;
-        
-        advance();
-        // ݹҲʽ
-        auto right = parseBinaryOp(prec + 1);
-        left = std::make_unique<BinaryOp>(std::move(left), std::move(right), op.lexeme);
-    }
+// ʽջеһԼĶԪűʽõ
+struct ExprFrame {
+    enum Kind { BINARY, PAREN, CALL };
+    Kind kind;
+    TokenType op;     // BINARY: 
+    int prec;         // BINARY: ȼ
+    std::string name; // CALL: 
+    size_t firstArg;  // CALL: һʵڲջеλ
+};
+
+} // namespace
+
+BinaryOp::~BinaryOp() {
+    std::vector<std::unique_ptr<Expression>> pending;
+    pending.push_back(std::move(left));
+    pending.push_back(std::move(right));
+    releaseExpressions(pending);
+}
 
-    return left;
+FunctionCall::~FunctionCall() {
+    releaseExpressions(args);
 }
 
 /**
- * @brief ʽ
- * @return ػʽASTڵ
- * 
- * ֵ֧Ļʽ:
- * 1. 
- * 2. ʶ
- * 3. 
- * 4. űʽ
+ * @brief ʽ
+ * @return رʽASTڵ
+ *
+ * ʽĲջջȳ㷨水ȼŵĵݹ飬
+ * ܳǶ׺ıʽҲֻռù̶ĵջʱtokenԡ
+ * źͺõҲѹջʱԼӦΪֹ
+ * ϣջǰȹԼջȼ
+ *
+ * ﷨:
+ *   expr    := operand (binop operand)*
+ *   operand := DIGIT | IDENT | IDENT ( [expr (, expr)*] ) | ( expr )
  */
-std::unique_ptr<Expression> Parser::parsePrimary() {
-
-	//std::cout << "here" << peek().lexeme << std::endl;
-	//printf("here2 %d\n", peek().type);
-    if (match(TokenType::DIGIT)) {
-
-        // 
-        return std::make_unique<IntegerLiteral>(std::stoi(previous().lexeme));
-    } else if (match(TokenType::IDENT)) {
-        // ǷǺ
-        if (check(TokenType::LPAREN)) {
-
-            return parseFunctionCall(previous().lexeme);
+std::unique_ptr<Expression> Parser::parseExpression() {
+    std::vector<std::unique_ptr<Expression>> operands;
+    std::vector<ExprFrame> frames;
+
+    // ջȼminPrecĶԪιԼBinaryOp
+    auto reduce = [&](int minPrec) {
+        while (!frames.empty() && frames.back().kind == ExprFrame::BINARY && frames.back().prec >= minPrec) {
+            auto right = std::move(operands.back());
+            operands.pop_back();
+            auto left = std::move(operands.back());
+            operands.pop_back();
+            operands.push_back(std::make_unique<BinaryOp>(std::move(left), std::move(right), tokenSpelling(frames.back().op)));
+            frames.pop_back();
+        }
+    };
+
+    for (;;) {
+        // һźͺֻѹջĵһ
+        if (match(TokenType::DIGIT)) {
+            operands.push_back(std::make_unique<IntegerLiteral>(previousValue()));
+        } else if (match(TokenType::IDENT)) {
+            if (check(TokenType::LPAREN)) {
+                frames.push_back({ExprFrame::CALL, TokenType::END, 0, previousName(), operands.size()});
+                advance();
+                if (!check(TokenType::RPAREN)) continue;
+                // ûʵΣֱӵպϵ
+            } else {
+                operands.push_back(std::make_unique<Variable>(previousName()));
+            }
+        } else if (match(TokenType::LPAREN)) {
+            frames.push_back({ExprFrame::PAREN, TokenType::END, 0, std::string(), 0});
+            continue;
+        } else {
+            throw SyntaxError("Expect expression", peekOffset());
         }
-        // ͨʶ
-
-        return std::make_unique<Variable>(previous().lexeme);
-    } else if (match(TokenType::LPAREN)) {
-        // űʽ
-
-        auto expr = parseExpression();
-        consume(TokenType::RPAREN, "Expect ')' after expression");
-        return expr;
-    } else {
-        throw std::runtime_error("Expect expression");
-    }
-}
 
-/**
- * @brief 
- * @param name 
- * @return غASTڵ
- * 
- * ﷨: IDENT ( [expr (, expr)*] )
- */
-std::unique_ptr<Expression> Parser::parseFunctionCall(const std::string& name) {
-    consume(TokenType::LPAREN, "Expect '(' after function name");
-    
-    std::vector<std::unique_ptr<Expression>> args;
-    // б
-    if (!check(TokenType::RPAREN)) {
-        do {
-            args.push_back(parseExpression());
-        } while (match(TokenType::COMMA)); // ֶ֧öŷָ
+        // ֮󣺶ԪջһպŻãջʱʽ
+        for (;;) {
+            TokenType op = peek();
+            if (isBinaryOp(op)) {
+                int prec = getPrecedence(op);
+                reduce(prec);
+                frames.push_back({ExprFrame::BINARY, op, prec, std::string(), 0});
+                advance();
+                break;
+            }
+            reduce(0);
+            if (frames.empty()) {
+                return std::move(operands.back());
+            }
+
+            ExprFrame& frame = frames.back();
+            if (frame.kind == ExprFrame::PAREN) {
+                consume(TokenType::RPAREN, "Expect ')' after expression");
+                frames.pop_back();
+                continue;
+            }
+            if (match(TokenType::COMMA)) {
+                break; // һʵ
+            }
+            consume(TokenType::RPAREN, "Expect ')' after arguments");
+            std::vector<std::unique_ptr<Expression>> args(
+                std::make_move_iterator(operands.begin() + frame.firstArg),
+                std::make_move_iterator(operands.end()));
+            operands.resize(frame.firstArg);
+            operands.push_back(std::make_unique<FunctionCall>(frame.name, std::move(args)));
+            frames.pop_back();
+        }
     }
-    
-    consume(TokenType::RPAREN, "Expect ')' after arguments");
-    return std::make_unique<FunctionCall>(name, std::move(args));
 }
 
 /**
@@ -389,14 +556,14 @@ bool Parser::isBinaryOp(TokenType type) {
  * @brief ָ͵Token
  * @param type Token
  * @param msg ͲƥʱĴϢ
- * @throws std::runtime_error ǰToken
+ * @throws SyntaxError ǰToken
  */
 void Parser::consume(TokenType type, const std::string& msg) {
     if (check(type)) {
         advance();
         return;
     }
-    throw std::runtime_error(msg);
+    throw SyntaxError(msg, peekOffset());
 }
 
 /**
@@ -406,7 +573,7 @@ void Parser::consume(TokenType type, const std::string& msg) {
  */
 bool Parser::checkNext(TokenType type) {
     if (current + 1 >= tokens.size()) return false;
-    return tokens[current + 1].type == type;
+    return tokens.type(current + 1) == type;
 }
 
 
@@ -23,6 +23,8 @@ class LoopStatement;
 class ConditionStatement;
 class BreakStmt;
 class ContinueStmt;
+class InlinedCall;
+class InlineReturn;
 
 // ģʽ
 class Visitor {
@@ -44,6 +46,8 @@ class Visitor {
         virtual void visit(ConditionStatement&) = 0;
         virtual void visit(BreakStmt&) = 0;
         virtual void visit(ContinueStmt&) = 0;
+        virtual void visit(InlinedCall&) = 0;
+        virtual void visit(InlineReturn&) = 0;
     };
 
 class ASTNode {
@@ -81,6 +85,7 @@ public:
             left(std::move(left)), 
             right(std::move(right)), 
             op(op) {}
+    ~BinaryOp() override; // ݹͷӱʽParser.cpp
     void accept(Visitor& v) override {v.visit(*this);};
 }; // Ԫڵ
 
@@ -113,6 +118,7 @@ public:
 class ReturnStmt : public Statement {
 public:
     std::unique_ptr<Expression> value; // ֵ
+    bool tailCall = false;             // valueβãTailCallOptimizerǣ
     ReturnStmt(std::unique_ptr<Expression> value) : value(std::move(value)) {}
     void accept(Visitor& v) override {v.visit(*this);};
 };
@@ -121,10 +127,12 @@ class FunctionCall : public Expression {
 public:
     std::string functionName; // 
     std::vector<std::unique_ptr<Expression>> args; // б
+    int profileSite = -1;     // profileеıţnumberProfileSites-1Ϊ
     FunctionCall(
         const std::string& functionName, 
         std::vector<std::unique_ptr<Expression>> args) : 
         functionName(functionName), args(std::move(args)) {}
+    ~FunctionCall() override; // ͬBinaryOpݹͷʵ
     void accept(Visitor& v) override {v.visit(*this);};
 };
 
@@ -166,6 +174,7 @@ public:
     std::unique_ptr<Expression> condition;
     std::unique_ptr<Block> thenBlock;
     std::unique_ptr<Block> elseBlock;
+    int profileSite = -1; // profileеıţthen/elseִ֧д
     
     ConditionStatement(
         std::unique_ptr<Expression> cond,
@@ -182,6 +191,7 @@ class LoopStatement : public Statement {
 public:
     std::unique_ptr<Expression> condition;
     std::unique_ptr<Block> body;
+    int profileSite = -1; // profileеıţ͵
     
     LoopStatement(
         std::unique_ptr<Expression> cond,
@@ -202,6 +212,30 @@ public:
     void accept(Visitor& v) override { v.visit(*this); }
 };
 
+// չĺãѻµľֲеreturnдΪInlineReturn
+class InlinedCall : public Expression {
+public:
+    std::string functionName;    // ĺ
+    std::unique_ptr<Block> body; // ʼ + дĺ
+    int profileSite = -1;        // ԭõprofileеıţȻ
+
+    InlinedCall(
+        const std::string& functionName,
+        std::unique_ptr<Block> body)
+        : functionName(functionName),
+          body(std::move(body)) {}
+
+    void accept(Visitor& v) override { v.visit(*this); }
+};
+
+// еreturnֵeaxвתϵ
+class InlineReturn : public Statement {
+public:
+    std::unique_ptr<Expression> value;
+    InlineReturn(std::unique_ptr<Expression> value) : value(std::move(value)) {}
+    void accept(Visitor& v) override { v.visit(*this); }
+};
+
 
 class FunctionDecl : public ASTNode {
 public:
@@ -210,6 +244,10 @@ public:
     std::vector<std::pair<std::string, std::string>> params; // б
     // pair: <type, name>
     std::unique_ptr<Block> body;     
+    size_t tokenBegin = 0; // tokenеķΧ [tokenBegin, tokenEnd)뻺
+    size_t tokenEnd = 0;
+    std::vector<std::string> evaluatedCalls; // ʱֵCallEvaluatorִйĺ뻺ǵԴ
+    std::string memoTarget; // 仯İװMemoizerֻ return memoTarget(...)ʱȲ
 
     FunctionDecl(
         const std::string& returnType,
@@ -227,6 +265,7 @@ public:
 class Program : public ASTNode {
 public:
     std::vector<std::unique_ptr<FunctionDecl>> functions;
+    int profileSites = 0; // Źprofile--profile-generate/--profile-useʱ
     
     void accept(Visitor& v) override {
         for (auto& func : functions) {
@@ -241,7 +280,7 @@ public:
 // ﷨
 class Parser {
 public:
-    Parser(const std::vector<Token>& tokens) : tokens(tokens), current(0) {}
+    Parser(const TokenStream& tokens) : tokens(tokens), current(0) {}
 
     std::unique_ptr<Program> parse(){
         auto program = std::make_unique<Program>();
@@ -254,20 +293,36 @@ public:
         return program;
     }
 
+    // ʽ룺һļĩβʱnullptr
+    std::unique_ptr<FunctionDecl> parseNext() {
+        if (isAtEnd()) return nullptr;
+        return parseFunction();
+    }
+
+    // Ԥɨ裺ֻtokenռÿֺͲ˳򣩣AST
+    // ﷨ĵطֹͣparseNext
+    std::vector<std::pair<std::string, int>> scanSignatures() const;
+
+    // ﷨Ȱҳÿ㺯tokenΧٰڵĺֳɿ飬
+    // ̳߳иԷԴ˳ƴӣparse()ͬдʱǰǸparse()ͬ
+    // threadsΪ0ʱʹCPUtokenʱֱӵparse()
+    std::unique_ptr<Program> parseParallel(unsigned threads = 0);
+
 private:
-    const std::vector<Token>& tokens; // ʷɵtokenб
+    const TokenStream& tokens; // ʷɵtoken
     size_t current = 0; // ǰtoken
-    const Token& peek() const { return tokens[current]; } // 鿴ǰtoken
-    const Token& previous() const { return tokens[current - 1]; } // 鿴һtoken
-    bool isAtEnd() const { return peek().type == TokenType::END; } // Ƿ񵽴ļĩβ
+    TokenType peek() const { return tokens.type(current); } // 鿴ǰtoken
+    size_t peekOffset() const { return tokens.offset(current); } // ǰtokenԴеλ
+    const std::string& peekName() const { return tokens.name(current); } // ǰʶ
+    const std::string& previousName() const { return tokens.name(current - 1); } // һʶ
+    int previousValue() const { return tokens.value(current - 1); } // һֵ
+    bool isAtEnd() const { return peek() == TokenType::END; } // Ƿ񵽴ļĩβ
     bool check(TokenType type) const { // 鵱ǰtoken
-//	std::cout << peek().lexeme << std::endl;
         if(isAtEnd()) return false;
-        return peek().type == type;
+        return peek() == type;
     }
-    const Token& advance() { // ǰƶһtoken
+    void advance() { // ǰƶһtoken
         if(!isAtEnd()) current++;
-        return previous();
     }
     bool match(TokenType type) { // ƥ䵱ǰtoken
         if(check(type)) {
@@ -277,16 +332,17 @@ private:
         return false;
     }
 
+    // Ԥɨ裺ҳÿ㺯tokenΧ[begin, end)
+    // ŲʱǸʼENDΪһΧ﷨
+    std::vector<std::pair<size_t, size_t>> scanFunctionSpans() const;
+
     std::unique_ptr<FunctionDecl> parseFunction();                          // 
     std::unique_ptr<Block> parseBlock();                                    // 
     std::unique_ptr<Statement> parseStatement();                            // 
     std::unique_ptr<Statement> parseVariableDecl();                         //  
     std::unique_ptr<Statement> parseReturn();                               //  
     std::unique_ptr<Statement> parseAssignment();                           // ֵ
-    std::unique_ptr<Expression> parseExpression();                          // ʽ
-    std::unique_ptr<Expression> parseBinaryOp(int minPrec);                 // Ԫ
-    std::unique_ptr<Expression> parsePrimary();                             // ʽ
-    std::unique_ptr<Expression> parseFunctionCall(const std::string& name); // 
+    std::unique_ptr<Expression> parseExpression();                          // ʽݹ飬Parser.cpp
     std::unique_ptr<Statement> parsePrintlnInt();                      // println_int 
     std::unique_ptr<Statement> parseIfStatement();
     std::unique_ptr<Statement> parseWhileStatement();
@@ -403,6 +459,16 @@ public:
     void visit(ContinueStmt& node) {
         std::cout << "continue";
     }
+
+    void visit(InlinedCall& node) override {
+        std::cout << "inline " << node.functionName << " ";
+        node.body->accept(*this);
+    }
+
+    void visit(InlineReturn& node) override {
+        std::cout << "inline_return ";
+        if (node.value) node.value->accept(*this);
+    }
     
     void print(ASTNode& node) {
         node.accept(*this);
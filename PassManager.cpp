@@ -0,0 +1,278 @@
+#include "PassManager.h"
+#include "ASTUtil.h"
+#include "CallEval.h"
+#include "ConstantFold.h"
+#include "Inliner.h"
+#include "Memoize.h"
+#include "Stats.h"
+#include "TailCall.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace {
+
+const char* const kPassNames[] = {"fold-constants", "eval-calls", "memoize", "tail-calls", "inline", "inline-small"};
+
+bool isKnownOperator(const std::string& op) {
+    static const std::unordered_set<std::string> operators = {
+        "+", "-", "*", "/", "%", "==", "!=", "<", "<=", ">", ">=", "&", "|", "^", "&&", "||"};
+    return operators.count(op) > 0;
+}
+
+// 结构检查：各遍之后AST仍满足代码生成的假设（没有空指针，return与InlineReturn出现在正确的位置等）
+class Verifier {
+public:
+    explicit Verifier(const FunctionDecl& func) : func_(func) {}
+
+    void run() {
+        if (!func_.body) fail("missing body");
+        visit(func_.body.get());
+    }
+
+private:
+    const FunctionDecl& func_;
+    int inlineDepth_ = 0; // 所在的内联体层数
+
+    [[noreturn]] void fail(const std::string& message) const {
+        throw std::runtime_error("function " + func_.name + ": " + message);
+    }
+
+    void visit(const Statement* stmt) {
+        if (!stmt) fail("null statement");
+        if (auto decl = dynamic_cast<const VariableDecl*>(stmt)) {
+            if (!decl->varName) fail("variable declaration without a name");
+            if (decl->value) visit(decl->value.get());
+        } else if (auto assign = dynamic_cast<const Assignment*>(stmt)) {
+            if (!assign->varName) fail("assignment without a target");
+            visit(assign->value.get());
+        } else if (auto ret = dynamic_cast<const ReturnStmt*>(stmt)) {
+            if (inlineDepth_ > 0) fail("return inside an inlined body");
+            if (ret->tailCall && !dynamic_cast<const FunctionCall*>(ret->value.get())) {
+                fail("tail call flag on a return without a call");
+            }
+            if (ret->value) visit(ret->value.get());
+        } else if (auto print = dynamic_cast<const PrintlnIntStmt*>(stmt)) {
+            visit(print->arg.get());
+        } else if (auto exprStmt = dynamic_cast<const ExpressionStatement*>(stmt)) {
+            visit(exprStmt->expr.get());
+        } else if (auto block = dynamic_cast<const Block*>(stmt)) {
+            for (const auto& s : block->statements) {
+                visit(s.get());
+            }
+        } else if (auto cond = dynamic_cast<const ConditionStatement*>(stmt)) {
+            visit(cond->condition.get());
+            visit(cond->thenBlock.get());
+            if (cond->elseBlock) visit(cond->elseBlock.get());
+        } else if (auto loop = dynamic_cast<const LoopStatement*>(stmt)) {
+            visit(loop->condition.get());
+            visit(loop->body.get());
+        } else if (auto inlRet = dynamic_cast<const InlineReturn*>(stmt)) {
+            if (inlineDepth_ == 0) fail("inline return outside an inlined body");
+            if (inlRet->value) visit(inlRet->value.get());
+        } else if (!dynamic_cast<const BreakStmt*>(stmt) && !dynamic_cast<const ContinueStmt*>(stmt)) {
+            fail("unknown statement");
+        }
+    }
+
+    // 表达式用显式栈前序遍历，不随嵌套深度递归
+    void visit(const Expression* root) {
+        std::vector<const Expression*> stack = {root};
+        while (!stack.empty()) {
+            const Expression* expr = stack.back();
+            stack.pop_back();
+            if (!expr) fail("null expression");
+            if (auto op = dynamic_cast<const BinaryOp*>(expr)) {
+                if (!isKnownOperator(op->op)) fail("unknown operator '" + op->op + "'");
+                stack.push_back(op->right.get());
+                stack.push_back(op->left.get());
+            } else if (auto call = dynamic_cast<const FunctionCall*>(expr)) {
+                for (auto it = call->args.rbegin(); it != call->args.rend(); ++it) {
+                    stack.push_back(it->get());
+                }
+            } else if (auto inl = dynamic_cast<const InlinedCall*>(expr)) {
+                inlineDepth_++;
+                visit(inl->body.get());
+                inlineDepth_--;
+            } else if (!dynamic_cast<const IntegerLiteral*>(expr) && !dynamic_cast<const Variable*>(expr)) {
+                fail("unknown expression");
+            }
+        }
+    }
+};
+
+} // namespace
+
+FunctionAnalysis& AnalysisCache::get(const FunctionDecl& func) {
+    return entries_[func.name];
+}
+
+int AnalysisCache::size(const FunctionDecl& func) {
+    FunctionAnalysis& entry = get(func);
+    if (entry.size < 0) {
+        entry.size = countNodes(*func.body);
+    }
+    return entry.size;
+}
+
+PassManager::PassManager(const std::vector<std::string>& passes) : passes_(passes) {
+    checkNames(passes_);
+}
+
+void PassManager::run(Program& program, CompileStats* stats) {
+    results_.clear();
+    if (verify) {
+        verifyProgram(program, "parse");
+    }
+    int size = report ? programSize(program) : 0;
+
+    for (const auto& name : passes_) {
+        PassResult result;
+        result.name = name;
+        result.sizeBefore = size;
+        std::vector<std::string> changed;
+        auto start = std::chrono::steady_clock::now();
+        {
+            PhaseTimer timer(stats, name.c_str());
+            result.changes = runPass(name, program, changed);
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // 只有改动过的函数需要重新分析
+        std::unordered_set<std::string> unique(changed.begin(), changed.end());
+        result.functionsChanged = static_cast<int>(unique.size());
+        for (const auto& function : unique) {
+            analyses_.invalidate(function);
+        }
+        if (verify) {
+            verifyProgram(program, name);
+        }
+        if (report) {
+            size = programSize(program);
+        }
+        result.sizeAfter = size;
+        results_.push_back(result);
+    }
+    if (report) {
+        printReport();
+    }
+}
+
+int PassManager::runPass(const std::string& name, Program& program, std::vector<std::string>& changed) {
+    int changes = 0;
+    if (name == "fold-constants") {
+        ConstantFolder folder;
+        changes = folder.run(program);
+        changed = std::move(folder.changedFunctions);
+    } else if (name == "eval-calls") {
+        CallEvaluator evaluator;
+        changes = evaluator.run(program);
+        changed = std::move(evaluator.changedFunctions);
+    } else if (name == "memoize") {
+        Memoizer memoizer;
+        changes = memoizer.run(program);
+        changed = std::move(memoizer.changedFunctions);
+    } else if (name == "tail-calls") {
+        TailCallOptimizer tco;
+        changes = tco.run(program);
+        changed = std::move(tco.changedFunctions);
+    } else if (name == "inline" || name == "inline-small") {
+        Inliner inliner(inlineReport);
+        inliner.profile = profile;
+        if (name == "inline-small") {
+            // 只内联比调用序列还小的函数
+            inliner.smallSize = 4;
+            inliner.singleCallSize = 0;
+        }
+        changes = inliner.run(program);
+        changed = std::move(inliner.changedFunctions);
+    } else {
+        throw std::runtime_error("unknown pass: " + name);
+    }
+    return changes;
+}
+
+int PassManager::programSize(const Program& program) {
+    int size = 0;
+    for (const auto& func : program.functions) {
+        size += analyses_.size(*func);
+    }
+    return size;
+}
+
+void PassManager::verifyProgram(const Program& program, const std::string& after) {
+    for (const auto& func : program.functions) {
+        FunctionAnalysis& entry = analyses_.get(*func);
+        if (entry.verified) continue;
+        try {
+            Verifier(*func).run();
+        } catch (const std::runtime_error& e) {
+            throw std::runtime_error("IR verification failed after " + after + ": " + e.what());
+        }
+        entry.verified = true;
+    }
+}
+
+void PassManager::printReport() const {
+    for (const auto& result : results_) {
+        *report << "[pass] " << result.name << ": " << result.changes << " changes in "
+                << result.functionsChanged << " functions, " << std::fixed << std::setprecision(3)
+                << result.seconds * 1000 << " ms, " << result.sizeBefore << " -> " << result.sizeAfter
+                << " nodes" << std::endl;
+        report->unsetf(std::ios::floatfield);
+    }
+}
+
+bool PassManager::optimizationLevel(const std::string& arg, std::vector<std::string>& passes) {
+    if (arg == "-O0") {
+        passes.clear();
+    } else if (arg == "-O1") {
+        passes = {"fold-constants", "tail-calls"};
+    } else if (arg == "-Os") {
+        passes = {"fold-constants", "eval-calls", "tail-calls", "inline-small"};
+    } else if (arg == "-O2") {
+        passes = {"fold-constants", "eval-calls", "tail-calls", "inline"};
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::vector<std::string> PassManager::parseList(const std::string& list) {
+    std::vector<std::string> passes;
+    size_t begin = 0;
+    while (begin <= list.size()) {
+        size_t end = list.find(',', begin);
+        if (end == std::string::npos) end = list.size();
+        if (end > begin) passes.push_back(list.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return passes;
+}
+
+void PassManager::addPass(std::vector<std::string>& passes, const std::string& name) {
+    if (std::find(passes.begin(), passes.end(), name) != passes.end()) return;
+    if (name == "tail-calls") {
+        // 在内联之前，与-Os的顺序相同
+        passes.insert(std::find_if(passes.begin(), passes.end(), [](const std::string& pass) {
+            return pass == "inline" || pass == "inline-small";
+        }), name);
+    } else if (name == "memoize") {
+        // 在尾调用改写和内联之前，看到的是原始的递归形式
+        passes.insert(std::find_if(passes.begin(), passes.end(), [](const std::string& pass) {
+            return pass == "tail-calls" || pass == "inline" || pass == "inline-small";
+        }), name);
+    } else {
+        passes.push_back(name);
+    }
+}
+
+void PassManager::checkNames(const std::vector<std::string>& passes) {
+    for (const auto& name : passes) {
+        if (std::find(std::begin(kPassNames), std::end(kPassNames), name) == std::end(kPassNames)) {
+            throw std::runtime_error("unknown pass: " + name);
+        }
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef PASS_MANAGER_H
+#define PASS_MANAGER_H
+
+#include "Parser.h"
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct CompileStats;
+class Profile;
+
+/*
+ * 优化遍管理器
+ * 在语法分析和代码生成之间按顺序运行一组AST优化遍，由 -O0/-O1/-O2/-Os 或 --passes= 选择：
+ *   fold-constants  常量折叠（ConstantFolder）
+ *   eval-calls      实参都是常量的纯函数调用在编译时求值（CallEvaluator）
+ *   memoize         树形递归的纯函数查表记忆化（Memoizer，只由--memoize或--passes=选择）
+ *   tail-calls      尾调用改写和累加器引入（TailCallOptimizer）
+ *   inline          函数内联（Inliner）
+ *   inline-small    只内联很小的函数（不按单一调用点内联，不增大代码）
+ * 每个遍报告改动了哪些函数，按函数缓存的分析结果（节点数、结构检查）只对这些函数重新计算。
+ * 每个遍的耗时计入--stats中同名的阶段；report非空时输出每个遍的耗时、改动次数和程序大小的变化。
+ */
+
+// 按函数缓存的分析结果
+struct FunctionAnalysis {
+    int size = -1;         // 节点个数（countNodes），-1表示还没有计算
+    bool verified = false; // 已通过结构检查
+};
+
+class AnalysisCache {
+public:
+    // 函数的分析结果，没有缓存时新建（各项按需计算）
+    FunctionAnalysis& get(const FunctionDecl& func);
+    int size(const FunctionDecl& func);
+    // 函数被改动后调用
+    void invalidate(const std::string& name) { entries_.erase(name); }
+
+private:
+    std::unordered_map<std::string, FunctionAnalysis> entries_;
+};
+
+struct PassResult {
+    std::string name;
+    double seconds = 0;
+    int changes = 0;          // 遍自己报告的改动次数（折叠的运算、标记的尾调用、内联的调用点等）
+    int functionsChanged = 0;
+    int sizeBefore = 0;       // 程序的节点个数，只在有report时计算
+    int sizeAfter = 0;
+};
+
+class PassManager {
+public:
+    bool verify = false;              // --verify-passes: 语法分析后和每个遍之后检查AST结构
+    std::ostream* report = nullptr;   // --pass-report
+    std::ostream* inlineReport = nullptr;
+    const Profile* profile = nullptr; // --profile-use: 内联按调用点的执行次数决定
+
+    // 遍名未知时抛出runtime_error
+    explicit PassManager(const std::vector<std::string>& passes);
+
+    void run(Program& program, CompileStats* stats = nullptr);
+
+    const std::vector<PassResult>& results() const { return results_; }
+
+    // -O0/-O1/-O2/-Os 对应的遍；arg不是优化级别时返回false
+    static bool optimizationLevel(const std::string& arg, std::vector<std::string>& passes);
+    // 逗号分隔的遍名列表（--passes=）
+    static std::vector<std::string> parseList(const std::string& list);
+    // 加入一个遍（已有时不重复）；tail-calls总排在inline之前，与-O2的顺序一致，memoize排在两者之前
+    static void addPass(std::vector<std::string>& passes, const std::string& name);
+    // 有未知的遍名时抛出runtime_error
+    static void checkNames(const std::vector<std::string>& passes);
+
+private:
+    std::vector<std::string> passes_;
+    AnalysisCache analyses_;
+    std::vector<PassResult> results_;
+
+    int runPass(const std::string& name, Program& program, std::vector<std::string>& changed);
+    int programSize(const Program& program);
+    void verifyProgram(const Program& program, const std::string& after);
+    void printReport() const;
+};
+
+#endif // PASS_MANAGER_H
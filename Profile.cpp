@@ -0,0 +1,47 @@
+#include "Profile.h"
+#include "ASTUtil.h"
+#include <fstream>
+#include <stdexcept>
+
+void numberProfileSites(Program& program) {
+    int next = 0;
+    for (auto& func : program.functions) {
+        forEachStatement(*func->body, [&](Statement& stmt) {
+            if (auto cond = dynamic_cast<ConditionStatement*>(&stmt)) {
+                cond->profileSite = next++;
+            } else if (auto loop = dynamic_cast<LoopStatement*>(&stmt)) {
+                loop->profileSite = next++;
+            }
+        });
+        forEachExprSlot(*func->body, [&](std::unique_ptr<Expression>& slot) {
+            if (auto call = dynamic_cast<FunctionCall*>(slot.get())) {
+                call->profileSite = next++;
+            }
+        });
+    }
+    program.profileSites = next;
+}
+
+/**
+ * @brief 读取运行时库（Runtime.c的profile_write）写出的文件：
+ *        第一行 "compilerlab-profile N"，其后N行，每行一个计数器
+ */
+std::shared_ptr<const Profile> Profile::load(const std::string& path) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        throw std::runtime_error("could not open profile " + path);
+    }
+    std::string magic;
+    size_t count = 0;
+    if (!(in >> magic >> count) || magic != "compilerlab-profile") {
+        throw std::runtime_error("not a profile file: " + path);
+    }
+    auto profile = std::make_shared<Profile>();
+    profile->counters_.resize(count);
+    for (auto& counter : profile->counters_) {
+        if (!(in >> counter)) {
+            throw std::runtime_error("truncated profile: " + path);
+        }
+    }
+    return profile;
+}
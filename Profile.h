@@ -0,0 +1,56 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "Parser.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+ * 基于插桩的profile（--profile-generate / --profile-use）
+ * 语法分析之后按源码顺序给条件语句、循环和函数调用编号（profileSite），每个编号对应两个64位计数器：
+ *   条件  then分支的执行次数、条件为假的次数
+ *   循环  进入循环的次数、循环体的执行次数
+ *   调用  调用次数（第二个计数器不用）
+ * 插桩的程序在main开始时向运行时库登记计数器（profile_start），退出时写入profile文件，
+ * 文件已存在且计数器个数相同时逐项相加，多次运行的结果累积在一起。
+ * 编号只依赖源码，在优化遍之前进行（内联、尾调用改写拷贝节点时保留编号），
+ * 同一份源码在不同的优化选项下收集的profile可以互相使用；源码改变后需要重新收集。
+ */
+
+// 给程序中的条件、循环和函数调用按源码顺序编号，结果记在program.profileSites中
+void numberProfileSites(Program& program);
+
+class Profile {
+public:
+    // 读取profile文件，文件不存在或格式错误时抛出runtime_error
+    static std::shared_ptr<const Profile> load(const std::string& path);
+
+    // 计数器个数，为编号个数的两倍
+    size_t size() const { return counters_.size(); }
+
+    uint64_t thenCount(int site) const { return counter(site, 0); }
+    uint64_t elseCount(int site) const { return counter(site, 1); }
+    uint64_t loopEntries(int site) const { return counter(site, 0); }
+    uint64_t loopIterations(int site) const { return counter(site, 1); }
+    uint64_t callCount(int site) const { return counter(site, 0); }
+
+    // 代码布局（CodeGen和CodeGenX64共用）：else分支更常执行时放在前面直接落入；
+    // 平均每次进入执行一次以上的循环把条件判断放到循环体后面；迭代次数多的循环体按16字节对齐
+    bool preferElse(int site) const { return elseCount(site) > thenCount(site); }
+    bool rotateLoop(int site) const { return loopIterations(site) > loopEntries(site); }
+    bool hotLoop(int site) const { return loopIterations(site) >= kHotLoopIterations; }
+
+    static const uint64_t kHotLoopIterations = 1000;
+
+private:
+    std::vector<uint64_t> counters_;
+
+    uint64_t counter(int site, int index) const {
+        size_t i = static_cast<size_t>(site) * 2 + index;
+        return site >= 0 && i < counters_.size() ? counters_[i] : 0;
+    }
+};
+
+#endif // PROFILE_H
@@ -0,0 +1,124 @@
+#include "Runtime.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define OUTPUT_BUFFER_SIZE (1 << 16)
+#define MAX_LINE_LENGTH 12 /* "-2147483648\n" */
+
+static char output_buffer[OUTPUT_BUFFER_SIZE];
+static size_t output_length = 0;
+static int flush_registered = 0;
+
+/* 两位一组的十进制查表，每次除法产生两位数字 */
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+void println_int_flush(void) {
+    size_t written = 0;
+    while (written < output_length) {
+        ssize_t n = write(STDOUT_FILENO, output_buffer + written, output_length - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break; /* 输出已经无法写出，丢弃剩余内容 */
+        }
+        written += (size_t)n;
+    }
+    output_length = 0;
+}
+
+void println_int(int value) {
+    char digits[MAX_LINE_LENGTH];
+    char* end = digits + sizeof(digits);
+    char* p = end;
+    unsigned int magnitude = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+
+    if (!flush_registered) {
+        flush_registered = 1;
+        atexit(println_int_flush);
+    }
+    if (output_length + MAX_LINE_LENGTH > OUTPUT_BUFFER_SIZE) {
+        println_int_flush();
+    }
+
+    *--p = '\n';
+    while (magnitude >= 100) {
+        unsigned int pair = (magnitude % 100) * 2;
+        magnitude /= 100;
+        p -= 2;
+        p[0] = digit_pairs[pair];
+        p[1] = digit_pairs[pair + 1];
+    }
+    if (magnitude >= 10) {
+        p -= 2;
+        p[0] = digit_pairs[magnitude * 2];
+        p[1] = digit_pairs[magnitude * 2 + 1];
+    } else {
+        *--p = (char)('0' + magnitude);
+    }
+    if (value < 0) {
+        *--p = '-';
+    }
+
+    memcpy(output_buffer + output_length, p, (size_t)(end - p));
+    output_length += (size_t)(end - p);
+}
+
+static unsigned long long* profile_counters = NULL;
+static size_t profile_count = 0;
+static const char* profile_path = NULL;
+
+void profile_start(unsigned long long* begin, unsigned long long* end, const char* path) {
+    if (!profile_counters) {
+        atexit(profile_write);
+    }
+    profile_counters = begin;
+    profile_count = (size_t)(end - begin);
+    profile_path = path;
+}
+
+void profile_write(void) {
+    FILE* file;
+    size_t i;
+    size_t count = 0;
+    if (!profile_counters) return;
+
+    /* 合并之前运行的结果（文件完整且计数器个数相同时） */
+    file = fopen(profile_path, "r");
+    if (file) {
+        if (fscanf(file, "compilerlab-profile %zu", &count) == 1 && count == profile_count) {
+            unsigned long long* previous = (unsigned long long*)calloc(count ? count : 1, sizeof(*previous));
+            for (i = 0; previous && i < count; ++i) {
+                if (fscanf(file, "%llu", &previous[i]) != 1) break;
+            }
+            if (previous && i == count) {
+                for (i = 0; i < count; ++i) {
+                    profile_counters[i] += previous[i];
+                }
+            }
+            free(previous);
+        }
+        fclose(file);
+    }
+
+    file = fopen(profile_path, "w");
+    if (file) {
+        fprintf(file, "compilerlab-profile %zu\n", profile_count);
+        for (i = 0; i < profile_count; ++i) {
+            fprintf(file, "%llu\n", profile_counters[i]);
+        }
+        fclose(file);
+    }
+    profile_counters = NULL; /* 只写一次（--run时由JIT在代码内存释放前调用） */
+}
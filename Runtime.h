@@ -0,0 +1,27 @@
+#ifndef RUNTIME_H
+#define RUNTIME_H
+
+/*
+ * 生成代码使用的运行时库（--fast-print）
+ * println_int 把整数转成十进制写入进程级缓冲区，缓冲区满或进程退出时用 write(2) 一次写出，
+ * 不经过printf的格式解析和stdio加锁。
+ * 生成的汇编与本库链接：gcc out.s libcompilerlab_rt.a
+ *
+ * --profile-generate 插桩的程序在main开始时调用 profile_start 登记计数器数组 [begin, end)，
+ * 进程退出时 profile_write 把计数器写入path（格式见Profile.h），已有同样大小的profile时逐项相加。
+ */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void println_int(int value);
+void println_int_flush(void);
+
+void profile_start(unsigned long long* begin, unsigned long long* end, const char* path);
+void profile_write(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RUNTIME_H */
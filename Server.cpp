@@ -0,0 +1,322 @@
+#include "Server.h"
+#include "Compiler.h"
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SERVER_SUPPORTED 1
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+#endif
+
+namespace {
+
+const size_t kMaxRequestSize = 1u << 28; // 拒绝明显错误的长度字段
+// 服务器读取请求的期限：连接后不发送请求的客户端不能一直占用线程池中的线程
+const std::chrono::seconds kRequestTimeout(10);
+
+#ifdef SERVER_SUPPORTED
+
+// 一个连接上的带缓冲读取和完整写入
+class Connection {
+public:
+    explicit Connection(int fd) : fd_(fd) {}
+    ~Connection() { close(fd_); }
+
+    // 此后的读取在timeout之后失败（默认不限时）
+    void setReadTimeout(std::chrono::milliseconds timeout) {
+        deadline_ = std::chrono::steady_clock::now() + timeout;
+        has_deadline_ = true;
+    }
+
+    bool readLine(std::string& line) {
+        for (;;) {
+            size_t newline = buffer_.find('\n');
+            if (newline != std::string::npos) {
+                line = buffer_.substr(0, newline);
+                buffer_.erase(0, newline + 1);
+                return true;
+            }
+            if (!fill()) return false;
+        }
+    }
+
+    bool readExact(size_t size, std::string& data) {
+        while (buffer_.size() < size) {
+            if (!fill()) return false;
+        }
+        data = buffer_.substr(0, size);
+        buffer_.erase(0, size);
+        return true;
+    }
+
+    bool writeAll(const std::string& data) {
+        size_t written = 0;
+        while (written < data.size()) {
+            ssize_t n = send(fd_, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            written += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+private:
+    int fd_;
+    std::string buffer_;
+    std::chrono::steady_clock::time_point deadline_;
+    bool has_deadline_ = false;
+
+    bool fill() {
+        char chunk[65536];
+        for (;;) {
+            if (has_deadline_) {
+                auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    deadline_ - std::chrono::steady_clock::now());
+                if (remaining.count() <= 0) return false;
+                pollfd entry = {fd_, POLLIN, 0};
+                int ready = poll(&entry, 1, static_cast<int>(remaining.count()));
+                if (ready < 0 && errno == EINTR) continue;
+                if (ready <= 0) return false;
+            }
+            ssize_t n = recv(fd_, chunk, sizeof(chunk), 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            buffer_.append(chunk, static_cast<size_t>(n));
+            return true;
+        }
+    }
+};
+
+sockaddr_un socketAddress(const std::string& path) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("server: invalid socket path: " + path);
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+int connectTo(const std::string& path) {
+    sockaddr_un address = socketAddress(path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw std::runtime_error("server: socket failed: " + std::string(std::strerror(errno)));
+    }
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        std::string reason = std::strerror(errno);
+        close(fd);
+        throw std::runtime_error("server: could not connect to " + path + ": " + reason);
+    }
+    return fd;
+}
+
+// --profile-use的文件按客户端的工作目录解析，转发绝对路径，服务器的工作目录可能不同
+std::string forwardOption(const std::string& option) {
+    if (option != "--profile-use" && option.compare(0, 14, "--profile-use=") != 0) {
+        return option;
+    }
+    DriverOptions parsed;
+    parseDriverOption(option, parsed);
+    char resolved[PATH_MAX];
+    if (!realpath(parsed.profileUse.c_str(), resolved)) {
+        throw std::runtime_error("could not open profile " + parsed.profileUse);
+    }
+    std::string path = resolved;
+    if (path.find_first_of(" \t\n") != std::string::npos) {
+        throw std::runtime_error("server: profile path contains whitespace: " + path);
+    }
+    return "--profile-use=" + path;
+}
+
+// 读取 "<状态> <字节数>\n<内容>" 形式的响应
+bool readResponse(Connection& connection, std::string& body) {
+    std::string header;
+    if (!connection.readLine(header)) {
+        throw std::runtime_error("server: connection closed without a response");
+    }
+    size_t space = header.find(' ');
+    if (space == std::string::npos) {
+        throw std::runtime_error("server: malformed response: " + header);
+    }
+    size_t size = std::stoul(header.substr(space + 1));
+    if (size > kMaxRequestSize || !connection.readExact(size, body)) {
+        throw std::runtime_error("server: truncated response");
+    }
+    return header.compare(0, space, "ok") == 0;
+}
+
+#endif // SERVER_SUPPORTED
+
+std::vector<std::string> splitWords(const std::string& line) {
+    std::vector<std::string> words;
+    std::istringstream in(line);
+    std::string word;
+    while (in >> word) {
+        words.push_back(word);
+    }
+    return words;
+}
+
+} // namespace
+
+CompileServer::CompileServer(const std::string& socketPath, const std::string& cacheDir, unsigned threads)
+    : socket_path_(socketPath), cache_(cacheDir), pool_(threads) {}
+
+CompileServer::~CompileServer() {
+#ifdef SERVER_SUPPORTED
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+        unlink(socket_path_.c_str());
+    }
+#endif
+}
+
+void CompileServer::run() {
+#ifdef SERVER_SUPPORTED
+    sockaddr_un address = socketAddress(socket_path_);
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+        throw std::runtime_error("server: socket failed: " + std::string(std::strerror(errno)));
+    }
+    unlink(socket_path_.c_str()); // 上次异常退出留下的套接字文件
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listen_fd_, SOMAXCONN) != 0) {
+        throw std::runtime_error("server: could not listen on " + socket_path_ + ": " + std::strerror(errno));
+    }
+
+    while (!stop_) {
+        int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) {
+            if (stop_) break; // shutdown请求关闭了监听套接字
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            throw std::runtime_error("server: accept failed: " + std::string(std::strerror(errno)));
+        }
+        pool_.submit([this, fd] { handle(fd); });
+    }
+    pool_.wait();
+#else
+    throw std::runtime_error("server: --server is only supported on Unix hosts");
+#endif
+}
+
+void CompileServer::handle(int fd) {
+#ifdef SERVER_SUPPORTED
+    Connection connection(fd);
+    connection.setReadTimeout(kRequestTimeout);
+    bool ok = false;
+    std::string body;
+    try {
+        std::string line;
+        if (!connection.readLine(line)) return;
+        std::vector<std::string> words = splitWords(line);
+        if (words.empty()) {
+            throw std::runtime_error("empty request");
+        }
+
+        if (words[0] == "shutdown") {
+            stop_ = true;
+            shutdown(listen_fd_, SHUT_RDWR); // 唤醒阻塞在accept上的主线程
+            ok = true;
+        } else if (words[0] == "compile") {
+            DriverOptions options;
+            for (size_t i = 1; i < words.size(); ++i) {
+                if (!parseDriverOption(words[i], options)) {
+                    throw std::runtime_error("unsupported option: " + words[i]);
+                }
+            }
+            options.cache = &cache_;
+
+            std::string source;
+            std::string name = "<source>";
+            if (!connection.readLine(line)) {
+                throw std::runtime_error("missing source");
+            }
+            if (line.compare(0, 7, "source ") == 0) {
+                size_t nameStart = line.find(' ', 7);
+                size_t size = std::stoul(line.substr(7, nameStart == std::string::npos ? std::string::npos : nameStart - 7));
+                if (nameStart != std::string::npos) name = line.substr(nameStart + 1);
+                if (size > kMaxRequestSize || !connection.readExact(size, source)) {
+                    throw std::runtime_error("truncated source");
+                }
+            } else if (line.compare(0, 5, "path ") == 0) {
+                name = line.substr(5);
+                std::ifstream file(name, std::ios::binary);
+                if (!file.is_open()) {
+                    throw std::runtime_error("could not open file " + name);
+                }
+                source.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            } else {
+                throw std::runtime_error("expected 'source <size> [name]' or 'path <file>'");
+            }
+
+            CompileResult result = compile(source, options);
+            ok = result.ok;
+            if (ok) {
+                body = std::move(result.output);
+            }
+            for (const auto& diagnostic : result.diagnostics) {
+                body += formatDiagnostic(name, diagnostic) + "\n";
+            }
+        } else {
+            throw std::runtime_error("unknown command: " + words[0]);
+        }
+    } catch (const std::exception& e) {
+        // 请求本身有问题（编译错误由compile()作为诊断信息返回）
+        ok = false;
+        body = std::string("error: ") + e.what() + "\n";
+    }
+    connection.writeAll((ok ? "ok " : "error ") + std::to_string(body.size()) + "\n" + body);
+#else
+    (void)fd;
+#endif
+}
+
+bool requestCompile(const std::string& socketPath, const std::vector<std::string>& options,
+                    const std::string& source, const std::string& name, std::string& result) {
+#ifdef SERVER_SUPPORTED
+    Connection connection(connectTo(socketPath));
+    std::string request = "compile";
+    for (const auto& option : options) {
+        request += " " + forwardOption(option);
+    }
+    request += "\nsource " + std::to_string(source.size()) + " " + name + "\n" + source;
+    if (!connection.writeAll(request)) {
+        throw std::runtime_error("server: could not send request");
+    }
+    return readResponse(connection, result);
+#else
+    (void)socketPath;
+    (void)options;
+    (void)source;
+    (void)name;
+    (void)result;
+    throw std::runtime_error("server: --connect is only supported on Unix hosts");
+#endif
+}
+
+void requestShutdown(const std::string& socketPath) {
+#ifdef SERVER_SUPPORTED
+    Connection connection(connectTo(socketPath));
+    std::string body;
+    if (!connection.writeAll("shutdown\n") || !readResponse(connection, body)) {
+        throw std::runtime_error("server: shutdown failed: " + body);
+    }
+#else
+    (void)socketPath;
+    throw std::runtime_error("server: --connect is only supported on Unix hosts");
+#endif
+}
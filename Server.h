@@ -0,0 +1,55 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "FunctionCache.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <string>
+#include <vector>
+
+/*
+ * 常驻编译服务器
+ * 在Unix域套接字上监听，每个连接处理一个请求，连接交给线程池处理。
+ * 请求需要在连接后10秒内发送完，否则关闭连接。
+ * 增量编译缓存和线程池在请求之间保持，未修改的函数不需要重新生成。
+ *
+ * 请求：
+ *   compile [选项...]\n            选项同命令行（--inline、--tail-calls、--regcall=N、--target=...、--fast-print、-c）
+ *                                  --profile-use=FILE由服务器读取，客户端转发绝对路径
+ *   source <字节数> [文件名]\n<源码>  或  path <文件路径>\n（服务器读取该文件）
+ *
+ *   shutdown\n                     处理完已接受的请求后退出
+ * 响应：
+ *   ok <字节数>\n<汇编文本或目标文件>
+ *   error <字节数>\n<诊断信息>     每行一条，"文件名:行:列: error: 信息"
+ */
+class CompileServer {
+public:
+    // cacheDir为空时缓存只在内存中；threads为0时使用硬件线程数。套接字已存在时先删除
+    CompileServer(const std::string& socketPath, const std::string& cacheDir, unsigned threads = 0);
+    ~CompileServer();
+
+    // 接受并处理请求，直到收到shutdown；无法监听时抛出runtime_error
+    void run();
+
+    const FunctionCache& cache() const { return cache_; }
+
+private:
+    std::string socket_path_;
+    FunctionCache cache_;
+    ThreadPool pool_;
+    int listen_fd_ = -1;
+    std::atomic<bool> stop_{false};
+
+    void handle(int fd);
+};
+
+// 客户端：发送编译请求，name是诊断信息中使用的文件名。
+// 成功时result为汇编文本或目标文件，编译失败时为诊断信息；无法连接时抛出runtime_error
+bool requestCompile(const std::string& socketPath, const std::vector<std::string>& options,
+                    const std::string& source, const std::string& name, std::string& result);
+
+// 客户端：请求服务器退出
+void requestShutdown(const std::string& socketPath);
+
+#endif // SERVER_H
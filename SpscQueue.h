@@ -0,0 +1,59 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/*
+ * 有界单生产者单消费者环形队列（流水线编译的各阶段之间使用）
+ * 无锁：生产者只写tail_，消费者只写head_，用acquire/release保证槽位内容先于下标可见。
+ * 两个下标单调递增，用 下标 % 容量 取槽位，tail_ - head_ 就是队列中的元素个数。
+ * 队列满或空时push/pop让出CPU后重试，不睡眠：流水线各阶段都在持续工作，等待通常很短。
+ */
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity) : slots_(capacity) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // 只能在生产者线程调用；队列满时返回false，value保持不变
+    bool tryPush(T& value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == slots_.size()) return false;
+        slots_[tail % slots_.size()] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 只能在消费者线程调用；队列空时返回false
+    bool tryPop(T& value) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) return false;
+        value = std::move(slots_[head % slots_.size()]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    void push(T value) {
+        while (!tryPush(value)) std::this_thread::yield();
+    }
+
+    T pop() {
+        T value;
+        while (!tryPop(value)) std::this_thread::yield();
+        return value;
+    }
+
+private:
+    std::vector<T> slots_;
+    // 两个下标分别由不同线程写，放在不同的缓存行上避免伪共享
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+};
+
+#endif // SPSC_QUEUE_H
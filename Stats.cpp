@@ -0,0 +1,241 @@
+#include "Stats.h"
+#include "ASTUtil.h"
+#include <ctime>
+#include <iomanip>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#define STATS_HAVE_POSIX 1
+#endif
+
+namespace {
+
+double threadCpuSeconds() {
+#if defined(STATS_HAVE_POSIX) && defined(CLOCK_THREAD_CPUTIME_ID)
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#else
+    return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+void countExpression(const Expression& expr, std::map<std::string, uint64_t>& nodes) {
+    std::vector<const Expression*> stack = {&expr};
+    while (!stack.empty()) {
+        const Expression* node = stack.back();
+        stack.pop_back();
+        if (dynamic_cast<const IntegerLiteral*>(node)) {
+            nodes["IntegerLiteral"]++;
+        } else if (dynamic_cast<const Variable*>(node)) {
+            nodes["Variable"]++;
+        } else if (auto op = dynamic_cast<const BinaryOp*>(node)) {
+            nodes["BinaryOp"]++;
+            stack.push_back(op->right.get());
+            stack.push_back(op->left.get());
+        } else if (auto call = dynamic_cast<const FunctionCall*>(node)) {
+            nodes["FunctionCall"]++;
+            for (const auto& arg : call->args) stack.push_back(arg.get());
+        } else if (dynamic_cast<const InlinedCall*>(node)) {
+            nodes["InlinedCall"]++;
+        }
+    }
+}
+
+const char* statementKind(const Statement& stmt) {
+    if (dynamic_cast<const Block*>(&stmt)) return "Block";
+    if (dynamic_cast<const VariableDecl*>(&stmt)) return "VariableDecl";
+    if (dynamic_cast<const Assignment*>(&stmt)) return "Assignment";
+    if (dynamic_cast<const ReturnStmt*>(&stmt)) return "ReturnStmt";
+    if (dynamic_cast<const PrintlnIntStmt*>(&stmt)) return "PrintlnIntStmt";
+    if (dynamic_cast<const ExpressionStatement*>(&stmt)) return "ExpressionStatement";
+    if (dynamic_cast<const ConditionStatement*>(&stmt)) return "ConditionStatement";
+    if (dynamic_cast<const LoopStatement*>(&stmt)) return "LoopStatement";
+    if (dynamic_cast<const BreakStmt*>(&stmt)) return "BreakStmt";
+    if (dynamic_cast<const ContinueStmt*>(&stmt)) return "ContinueStmt";
+    if (dynamic_cast<const InlineReturn*>(&stmt)) return "InlineReturn";
+    return "Statement";
+}
+
+std::string jsonString(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+} // namespace
+
+AllocationCounters& threadAllocationCounters() {
+    static thread_local AllocationCounters counters;
+    return counters;
+}
+
+long peakResidentKb() {
+#ifdef STATS_HAVE_POSIX
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return -1;
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024; // macOS以字节为单位
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return -1;
+#endif
+}
+
+PhaseStats& CompileStats::phase(const std::string& name) {
+    for (auto& entry : phases) {
+        if (entry.name == name) return entry;
+    }
+    phases.push_back(PhaseStats());
+    phases.back().name = name;
+    return phases.back();
+}
+
+void CompileStats::countProgram(const Program& program) {
+    for (const auto& func : program.functions) {
+        countFunction(*func);
+    }
+}
+
+void CompileStats::countFunction(const FunctionDecl& func) {
+    astNodes["FunctionDecl"]++;
+    forEachStatement(*func.body, [this](const Statement& stmt) {
+        astNodes[statementKind(stmt)]++;
+        auto visit = [this](const Expression* expr) {
+            if (expr) countExpression(*expr, astNodes);
+        };
+        if (auto decl = dynamic_cast<const VariableDecl*>(&stmt)) visit(decl->value.get());
+        else if (auto assign = dynamic_cast<const Assignment*>(&stmt)) visit(assign->value.get());
+        else if (auto ret = dynamic_cast<const ReturnStmt*>(&stmt)) visit(ret->value.get());
+        else if (auto print = dynamic_cast<const PrintlnIntStmt*>(&stmt)) visit(print->arg.get());
+        else if (auto exprStmt = dynamic_cast<const ExpressionStatement*>(&stmt)) visit(exprStmt->expr.get());
+        else if (auto cond = dynamic_cast<const ConditionStatement*>(&stmt)) visit(cond->condition.get());
+        else if (auto loop = dynamic_cast<const LoopStatement*>(&stmt)) visit(loop->condition.get());
+    });
+}
+
+void CompileStats::countAsmLine(const std::string& line) {
+    if (line.empty()) return;
+    if (line[0] == ' ' || line[0] == '\t') {
+        instructions++;
+    } else if (line.back() == ':') {
+        labels++;
+    }
+}
+
+void CompileStats::countAsmText(const std::string& text) {
+    size_t begin = 0;
+    while (begin < text.size()) {
+        size_t end = text.find('\n', begin);
+        if (end == std::string::npos) end = text.size();
+        countAsmLine(text.substr(begin, end - begin));
+        begin = end + 1;
+    }
+}
+
+void CompileStats::merge(const CompileStats& other) {
+    for (const auto& entry : other.phases) {
+        PhaseStats& mine = phase(entry.name);
+        mine.wallSeconds += entry.wallSeconds;
+        mine.cpuSeconds += entry.cpuSeconds;
+        mine.bytesAllocated += entry.bytesAllocated;
+        mine.allocations += entry.allocations;
+    }
+    files += other.files;
+    sourceBytes += other.sourceBytes;
+    tokens += other.tokens;
+    for (const auto& entry : other.astNodes) {
+        astNodes[entry.first] += entry.second;
+    }
+    functions += other.functions;
+    instructions += other.instructions;
+    labels += other.labels;
+}
+
+void CompileStats::printText(std::ostream& out, long peakRssKb) const {
+    PhaseStats total;
+    out << "=== compile statistics ===\n";
+    out << std::left << std::setw(16) << "phase" << std::right
+        << std::setw(12) << "wall(ms)" << std::setw(12) << "cpu(ms)"
+        << std::setw(14) << "alloc(KB)" << std::setw(12) << "allocs" << "\n";
+    auto row = [&out](const PhaseStats& entry) {
+        out << std::left << std::setw(16) << entry.name << std::right << std::fixed << std::setprecision(3)
+            << std::setw(12) << entry.wallSeconds * 1000 << std::setw(12) << entry.cpuSeconds * 1000
+            << std::setprecision(1) << std::setw(14) << entry.bytesAllocated / 1024.0
+            << std::setw(12) << entry.allocations << "\n";
+    };
+    for (const auto& entry : phases) {
+        row(entry);
+        total.wallSeconds += entry.wallSeconds;
+        total.cpuSeconds += entry.cpuSeconds;
+        total.bytesAllocated += entry.bytesAllocated;
+        total.allocations += entry.allocations;
+    }
+    total.name = "total";
+    row(total);
+    out.unsetf(std::ios::floatfield);
+
+    uint64_t nodes = 0;
+    for (const auto& entry : astNodes) nodes += entry.second;
+    out << "files:        " << files << " (" << sourceBytes << " bytes)\n";
+    out << "tokens:       " << tokens << "\n";
+    out << "AST nodes:    " << nodes << "\n";
+    for (const auto& entry : astNodes) {
+        out << "  " << std::left << std::setw(22) << entry.first << std::right << entry.second << "\n";
+    }
+    out << "functions:    " << functions << "\n";
+    out << "instructions: " << instructions << "\n";
+    out << "labels:       " << labels << "\n";
+    out << "peak RSS:     " << peakRssKb << " KB\n";
+}
+
+void CompileStats::printJson(std::ostream& out, long peakRssKb) const {
+    out << "{\"phases\":[";
+    for (size_t i = 0; i < phases.size(); ++i) {
+        const PhaseStats& entry = phases[i];
+        out << (i ? "," : "") << "{\"name\":" << jsonString(entry.name)
+            << ",\"wall_seconds\":" << entry.wallSeconds
+            << ",\"cpu_seconds\":" << entry.cpuSeconds
+            << ",\"bytes_allocated\":" << entry.bytesAllocated
+            << ",\"allocations\":" << entry.allocations << "}";
+    }
+    out << "],\"files\":" << files
+        << ",\"source_bytes\":" << sourceBytes
+        << ",\"tokens\":" << tokens
+        << ",\"ast_nodes\":{";
+    bool first = true;
+    for (const auto& entry : astNodes) {
+        out << (first ? "" : ",") << jsonString(entry.first) << ":" << entry.second;
+        first = false;
+    }
+    out << "},\"functions\":" << functions
+        << ",\"instructions\":" << instructions
+        << ",\"labels\":" << labels
+        << ",\"peak_rss_kb\":" << peakRssKb << "}\n";
+}
+
+PhaseTimer::PhaseTimer(CompileStats* stats, const char* name) : stats_(stats), name_(name) {
+    if (!stats_) return;
+    wall_ = std::chrono::steady_clock::now();
+    cpu_ = threadCpuSeconds();
+    const AllocationCounters& counters = threadAllocationCounters();
+    bytes_ = counters.bytes;
+    allocations_ = counters.count;
+}
+
+PhaseTimer::~PhaseTimer() {
+    if (!stats_) return;
+    const AllocationCounters& counters = threadAllocationCounters();
+    uint64_t bytes = counters.bytes - bytes_;
+    uint64_t allocations = counters.count - allocations_;
+    PhaseStats& entry = stats_->phase(name_);
+    entry.wallSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_).count();
+    entry.cpuSeconds += threadCpuSeconds() - cpu_;
+    entry.bytesAllocated += bytes;
+    entry.allocations += allocations;
+}
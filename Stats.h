@@ -0,0 +1,77 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include "Parser.h"
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/*
+ * 编译统计（--stats）
+ * 各阶段的墙钟时间、CPU时间（当前线程）和分配的字节数，以及token、AST节点、函数、指令、标签个数。
+ * 分配计数来自MemoryCounter.cpp中替换的全局operator new，只在可执行文件中链接；
+ * 作为库使用时没有替换operator new，分配字节数为0。
+ */
+struct PhaseStats {
+    std::string name;
+    double wallSeconds = 0;
+    double cpuSeconds = 0;
+    uint64_t bytesAllocated = 0;
+    uint64_t allocations = 0;
+};
+
+struct CompileStats {
+    std::vector<PhaseStats> phases; // 按第一次出现的顺序
+    uint64_t files = 0;
+    uint64_t sourceBytes = 0;
+    uint64_t tokens = 0;
+    std::map<std::string, uint64_t> astNodes; // 语法分析后（优化前）各类节点个数
+    uint64_t functions = 0;
+    uint64_t instructions = 0;
+    uint64_t labels = 0;
+
+    PhaseStats& phase(const std::string& name);
+    void countProgram(const Program& program);
+    void countFunction(const FunctionDecl& func);
+    void countAsmLine(const std::string& line);
+    void countAsmText(const std::string& text);
+    // 累加另一次编译的统计（批量编译）
+    void merge(const CompileStats& other);
+
+    // peakRssKb为进程的峰值常驻内存，由调用者在输出前取得
+    void printText(std::ostream& out, long peakRssKb) const;
+    void printJson(std::ostream& out, long peakRssKb) const;
+};
+
+// 在作用域内计时并统计分配，结果累加到stats中名为name的阶段；stats为空时什么也不做
+class PhaseTimer {
+public:
+    PhaseTimer(CompileStats* stats, const char* name);
+    ~PhaseTimer();
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+    CompileStats* stats_;
+    const char* name_;
+    std::chrono::steady_clock::time_point wall_;
+    double cpu_ = 0;
+    uint64_t bytes_ = 0;
+    uint64_t allocations_ = 0;
+};
+
+// 当前线程累计分配的字节数和次数（MemoryCounter.cpp更新）
+struct AllocationCounters {
+    uint64_t bytes = 0;
+    uint64_t count = 0;
+};
+AllocationCounters& threadAllocationCounters();
+
+// 进程的峰值常驻内存（KB），不支持时返回-1
+long peakResidentKb();
+
+#endif // STATS_H
@@ -0,0 +1,230 @@
+#include "TailCall.h"
+#include "ASTUtil.h"
+
+namespace {
+
+const char* const kAccName = ".acc"; // 不是合法标识符，不会与用户变量冲突
+
+// 满足结合律与交换律的运算符及其单位元（CodeGen中&&、||按位实现）
+bool identityOf(const std::string& op, int& identity) {
+    if (op == "+" || op == "|" || op == "^" || op == "||") {
+        identity = 0;
+    } else if (op == "*") {
+        identity = 1;
+    } else if (op == "&" || op == "&&") {
+        identity = -1;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool containsCall(const Expression& expr) {
+    std::vector<const Expression*> stack = {&expr};
+    while (!stack.empty()) {
+        const Expression* node = stack.back();
+        stack.pop_back();
+        if (auto op = dynamic_cast<const BinaryOp*>(node)) {
+            stack.push_back(op->right.get());
+            stack.push_back(op->left.get());
+        } else if (dynamic_cast<const FunctionCall*>(node) || dynamic_cast<const InlinedCall*>(node)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+FunctionCall* asCallTo(Expression* expr, const std::string& name) {
+    auto call = dynamic_cast<FunctionCall*>(expr);
+    return call && call->functionName == name ? call : nullptr;
+}
+
+} // namespace
+
+/**
+ * @brief 判断函数能否引入累加器
+ * @param op 输出：递归return中使用的运算符
+ *
+ * 要求：所有自递归调用都出现在 return f(...) 或 return A op f(...) / return f(...) op A 中，
+ * op全部相同，A中不含函数调用（否则求值顺序会改变），且至少有一处非尾递归
+ */
+bool TailCallOptimizer::canAccumulate(FunctionDecl& func, std::string& op) {
+    if (func.returnType != "int") return false;
+
+    int selfCalls = 0;
+    forEachExprSlot(*func.body, [&](std::unique_ptr<Expression>& slot) {
+        if (asCallTo(slot.get(), func.name)) selfCalls++;
+    });
+    if (selfCalls == 0) return false;
+
+    int accounted = 0;
+    int nonTail = 0;
+    bool ok = true;
+    forEachStatement(*func.body, [&](Statement& stmt) {
+        auto ret = dynamic_cast<ReturnStmt*>(&stmt);
+        if (!ret || !ret->value) return;
+
+        if (auto call = asCallTo(ret->value.get(), func.name)) {
+            for (auto& arg : call->args) {
+                if (containsCall(*arg)) ok = false;
+            }
+            accounted++;
+            return;
+        }
+        auto bin = dynamic_cast<BinaryOp*>(ret->value.get());
+        if (!bin) return;
+        FunctionCall* call = asCallTo(bin->left.get(), func.name);
+        Expression* other = bin->right.get();
+        if (!call) {
+            call = asCallTo(bin->right.get(), func.name);
+            other = bin->left.get();
+        }
+        if (!call) return;
+
+        int identity;
+        if (!identityOf(bin->op, identity) || containsCall(*other) || (!op.empty() && op != bin->op)) {
+            ok = false;
+            return;
+        }
+        for (auto& arg : call->args) {
+            if (containsCall(*arg)) ok = false;
+        }
+        op = bin->op;
+        accounted++;
+        nonTail++;
+    });
+    return ok && nonTail > 0 && accounted == selfCalls;
+}
+
+/**
+ * @brief 生成 f.acc(params..., .acc)，原函数改为 return f.acc(params..., 单位元)
+ */
+std::unique_ptr<FunctionDecl> TailCallOptimizer::makeAccumulatorHelper(FunctionDecl& func, const std::string& op) {
+    int identity = 0;
+    identityOf(op, identity);
+    std::string helperName = func.name + kAccName;
+
+    auto params = func.params;
+    params.emplace_back("int", kAccName);
+    auto body = std::move(func.body);
+
+    // 落到函数末尾等价于 return 0
+    if (body->statements.empty() || !dynamic_cast<ReturnStmt*>(body->statements.back().get())) {
+        body->addStatement(std::make_unique<ReturnStmt>(std::make_unique<IntegerLiteral>(0)));
+    }
+
+    auto accumulate = [&](std::unique_ptr<Expression> value) -> std::unique_ptr<Expression> {
+        return std::make_unique<BinaryOp>(std::make_unique<Variable>(kAccName), std::move(value), op);
+    };
+
+    forEachStatement(*body, [&](Statement& stmt) {
+        auto ret = dynamic_cast<ReturnStmt*>(&stmt);
+        if (!ret || !ret->value) return;
+
+        if (auto call = asCallTo(ret->value.get(), func.name)) {
+            // return f(x)  =>  return f.acc(x, .acc)
+            call->functionName = helperName;
+            call->args.push_back(std::make_unique<Variable>(kAccName));
+            return;
+        }
+        auto bin = dynamic_cast<BinaryOp*>(ret->value.get());
+        bool callLeft = bin && asCallTo(bin->left.get(), func.name);
+        bool callRight = bin && !callLeft && asCallTo(bin->right.get(), func.name);
+        if (callLeft || callRight) {
+            // return A op f(x)  =>  return f.acc(x, .acc op A)
+            std::unique_ptr<Expression> callExpr = std::move(callLeft ? bin->left : bin->right);
+            std::unique_ptr<Expression> other = std::move(callLeft ? bin->right : bin->left);
+            auto call = static_cast<FunctionCall*>(callExpr.get());
+            call->functionName = helperName;
+            call->args.push_back(accumulate(std::move(other)));
+            ret->value = std::move(callExpr);
+        } else {
+            // 基础情况 return E  =>  return .acc op E
+            ret->value = accumulate(std::move(ret->value));
+        }
+    });
+
+    // 原函数只做一次转发
+    std::vector<std::unique_ptr<Expression>> args;
+    for (const auto& param : func.params) {
+        args.push_back(std::make_unique<Variable>(param.second));
+    }
+    args.push_back(std::make_unique<IntegerLiteral>(identity));
+    func.body = std::make_unique<Block>();
+    func.body->addStatement(std::make_unique<ReturnStmt>(
+        std::make_unique<FunctionCall>(helperName, std::move(args))));
+
+    auto helper = std::make_unique<FunctionDecl>("int", helperName, std::move(params), std::move(body));
+    helper->tokenBegin = func.tokenBegin; // 辅助函数完全由原函数的源码决定
+    helper->tokenEnd = func.tokenEnd;
+    helper->evaluatedCalls = func.evaluatedCalls;
+    return helper;
+}
+
+int TailCallOptimizer::introduceAccumulators(Program& program) {
+    int changed = 0;
+    std::vector<std::unique_ptr<FunctionDecl>> functions;
+    for (auto& func : program.functions) {
+        std::string op;
+        std::unique_ptr<FunctionDecl> helper;
+        if (canAccumulate(*func, op)) {
+            helper = makeAccumulatorHelper(*func, op);
+            changedFunctions.push_back(func->name);
+            changedFunctions.push_back(helper->name);
+            changed++;
+        }
+        functions.push_back(std::move(func));
+        if (helper) functions.push_back(std::move(helper));
+    }
+    program.functions = std::move(functions);
+    return changed;
+}
+
+int TailCallOptimizer::markTailCalls(Program& program) {
+    std::unordered_map<std::string, int> arities;
+    for (auto& func : program.functions) {
+        arities[func->name] = static_cast<int>(func->params.size());
+    }
+
+    int marked = 0;
+    for (auto& func : program.functions) {
+        int n = markTailCalls(*func, arities);
+        if (n > 0) changedFunctions.push_back(func->name);
+        marked += n;
+    }
+    return marked;
+}
+
+int TailCallOptimizer::markTailCalls(FunctionDecl& func, const std::unordered_map<std::string, int>& arities) {
+    int marked = 0;
+    forEachStatement(*func.body, [&](Statement& stmt) {
+        auto ret = dynamic_cast<ReturnStmt*>(&stmt);
+        if (!ret || !ret->value || ret->tailCall) return;
+        auto call = dynamic_cast<FunctionCall*>(ret->value.get());
+        if (!call) return;
+        auto callee = arities.find(call->functionName);
+        if (callee == arities.end() || callee->second != static_cast<int>(call->args.size())) return;
+        ret->tailCall = true;
+        marked++;
+    });
+    return marked;
+}
+
+int TailCallOptimizer::runFunction(std::unique_ptr<FunctionDecl> func, std::unordered_map<std::string, int>& arities,
+                                   std::vector<std::unique_ptr<FunctionDecl>>& out) {
+    int changed = 0;
+    std::string op;
+    std::unique_ptr<FunctionDecl> helper;
+    if (canAccumulate(*func, op)) {
+        helper = makeAccumulatorHelper(*func, op);
+        arities[helper->name] = static_cast<int>(helper->params.size());
+        changed++;
+    }
+    changed += markTailCalls(*func, arities);
+    out.push_back(std::move(func));
+    if (helper) {
+        changed += markTailCalls(*helper, arities);
+        out.push_back(std::move(helper));
+    }
+    return changed;
+}
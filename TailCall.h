@@ -0,0 +1,43 @@
+#ifndef TAILCALL_H
+#define TAILCALL_H
+
+#include "Parser.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * 尾调用优化
+ * 1. 累加器引入：形如 return A op f(...) 的线性自递归（op满足结合律与交换律，
+ *    A中没有函数调用）改写为带累加器参数的辅助函数 f.acc，使递归调用变为尾调用
+ * 2. 把 return g(...) 标记为尾调用，由CodeGen复用当前栈帧：
+ *    自递归跳回函数体开头（即循环），其他函数在参数区够用时 leave + jmp
+ */
+class TailCallOptimizer {
+public:
+    // 返回改写为累加器形式的函数个数
+    int introduceAccumulators(Program& program);
+    // 返回标记的尾调用个数
+    int markTailCalls(Program& program);
+
+    int run(Program& program) {
+        changedFunctions.clear();
+        int changed = introduceAccumulators(program);
+        return changed + markTailCalls(program);
+    }
+
+    // 流式编译时逐个函数处理：arities是所有函数的参数个数（预扫描得到），
+    // func和引入的辅助函数依次追加到out，辅助函数同时登记到arities中
+    int runFunction(std::unique_ptr<FunctionDecl> func, std::unordered_map<std::string, int>& arities,
+                    std::vector<std::unique_ptr<FunctionDecl>>& out);
+
+    // 改动过的函数（包括新增的辅助函数），introduceAccumulators/markTailCalls(Program&)追加，由调用者清空
+    std::vector<std::string> changedFunctions;
+
+private:
+    int markTailCalls(FunctionDecl& func, const std::unordered_map<std::string, int>& arities);
+    bool canAccumulate(FunctionDecl& func, std::string& op);
+    std::unique_ptr<FunctionDecl> makeAccumulatorHelper(FunctionDecl& func, const std::string& op);
+};
+
+#endif // TAILCALL_H
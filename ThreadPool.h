@@ -0,0 +1,53 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * 工作窃取线程池
+ * 每个工作线程有自己的任务队列：从队尾取自己的任务，自己的队列空了再从其他线程的队首窃取。
+ * 编译任务的耗时随文件大小差别很大，窃取让先做完的线程分担剩下的大文件。
+ * 任务不应抛出异常（由调用者自己捕获并记录）。
+ */
+class ThreadPool {
+public:
+    // threads为0时使用硬件线程数
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task);
+    // 阻塞到所有已提交的任务执行完
+    void wait();
+
+    unsigned size() const { return static_cast<unsigned>(threads_.size()); }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable wake_; // 有新任务或需要退出
+    std::condition_variable idle_; // 所有任务执行完
+    size_t queued_ = 0;   // 还在队列中的任务
+    size_t pending_ = 0;  // 已提交但还没执行完的任务
+    size_t next_ = 0;     // 轮流分配提交的任务
+    bool stop_ = false;
+
+    bool takeTask(size_t self, std::function<void()>& task);
+    void workerLoop(size_t self);
+};
+
+#endif // THREAD_POOL_H
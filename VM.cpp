@@ -0,0 +1,220 @@
+#include "VM.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__GNUC__) && !defined(VM_NO_COMPUTED_GOTO)
+#define VM_COMPUTED_GOTO 1
+#else
+#define VM_COMPUTED_GOTO 0
+#endif
+
+namespace {
+
+const size_t kInitialRegisters = 1 << 16;
+const size_t kOutputBufferSize = 1 << 16;
+
+// 32位补码回绕运算，避免有符号溢出的未定义行为
+inline int32_t wrap(uint32_t value) {
+    return static_cast<int32_t>(value);
+}
+
+inline int32_t divide(int32_t a, int32_t b, bool remainder) {
+    if (b == 0) throw std::runtime_error("VM: division by zero");
+    if (a == INT_MIN && b == -1) throw std::runtime_error("VM: integer overflow in division");
+    return remainder ? a % b : a / b;
+}
+
+} // namespace
+
+VM::VM(const BytecodeProgram& program, std::FILE* out) : program_(program), out_(out) {}
+
+int VM::run(const std::string& entry) {
+    auto it = program_.functionIndex.find(entry);
+    if (it == program_.functionIndex.end()) {
+        throw std::runtime_error("VM: entry function not found: " + entry);
+    }
+    const BytecodeFunction& function = program_.functions[it->second];
+    if (function.numParams != 0) {
+        throw std::runtime_error("VM: entry function must not take parameters: " + entry);
+    }
+    try {
+        int result = execute(function);
+        flush();
+        return result;
+    } catch (...) {
+        flush(); // 出错前的输出仍然写出
+        throw;
+    }
+}
+
+#if VM_COMPUTED_GOTO
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic" // &&label 与 goto *p 是GNU扩展
+#endif
+
+int VM::execute(const BytecodeFunction& entry) {
+    const int32_t* code = program_.code.data();
+    const BytecodeFunction* functions = program_.functions.data();
+
+    frames_.clear();
+    registers_.assign(std::max<size_t>(kInitialRegisters, entry.numRegisters), 0);
+    size_t base = 0;
+    size_t top = entry.numRegisters;
+    int32_t* r = registers_.data();
+    const int32_t* ip = code + entry.entry;
+
+    // 保证寄存器栈能容纳到newTop，扩容后重新定位当前窗口
+    auto reserve = [&](size_t newTop) {
+        if (newTop > registers_.size()) {
+            registers_.resize(std::max(newTop, registers_.size() * 2));
+            r = registers_.data() + base;
+        }
+    };
+
+#if VM_COMPUTED_GOTO
+    static const void* const dispatch[] = {
+#define VM_LABEL(name, mnemonic, operands) &&op_##name,
+        BYTECODE_OPS(VM_LABEL)
+#undef VM_LABEL
+    };
+#define VM_CASE(name) op_##name
+#define VM_NEXT() goto *dispatch[*ip]
+    VM_NEXT();
+#else
+#define VM_CASE(name) case Op::name
+#define VM_NEXT() continue
+    for (;;) switch (static_cast<Op>(*ip)) {
+#endif
+
+#define VM_BINARY(name, expr)                          \
+    VM_CASE(name): {                                   \
+        int32_t b = r[ip[2]];                          \
+        int32_t c = r[ip[3]];                          \
+        r[ip[1]] = (expr);                             \
+        ip += 4;                                       \
+        VM_NEXT();                                     \
+    }
+
+    VM_CASE(LoadK): {
+        r[ip[1]] = ip[2];
+        ip += 3;
+        VM_NEXT();
+    }
+    VM_CASE(Move): {
+        r[ip[1]] = r[ip[2]];
+        ip += 3;
+        VM_NEXT();
+    }
+    VM_BINARY(Add, wrap(static_cast<uint32_t>(b) + static_cast<uint32_t>(c)))
+    VM_BINARY(Sub, wrap(static_cast<uint32_t>(b) - static_cast<uint32_t>(c)))
+    VM_BINARY(Mul, wrap(static_cast<uint32_t>(b) * static_cast<uint32_t>(c)))
+    VM_BINARY(Div, divide(b, c, false))
+    VM_BINARY(Mod, divide(b, c, true))
+    VM_BINARY(And, b & c)
+    VM_BINARY(Or, b | c)
+    VM_BINARY(Xor, b ^ c)
+    VM_BINARY(Eq, b == c)
+    VM_BINARY(Ne, b != c)
+    VM_BINARY(Lt, b < c)
+    VM_BINARY(Le, b <= c)
+    VM_BINARY(Gt, b > c)
+    VM_BINARY(Ge, b >= c)
+    VM_CASE(AddK): {
+        r[ip[1]] = wrap(static_cast<uint32_t>(r[ip[2]]) + static_cast<uint32_t>(ip[3]));
+        ip += 4;
+        VM_NEXT();
+    }
+    VM_CASE(Jump): {
+        ip = code + ip[1];
+        VM_NEXT();
+    }
+    VM_CASE(JumpIfZero): {
+        ip = r[ip[1]] == 0 ? code + ip[2] : ip + 3;
+        VM_NEXT();
+    }
+    VM_CASE(Call): {
+        const BytecodeFunction& callee = functions[ip[2]];
+        size_t newBase = top;
+        size_t newTop = newBase + callee.numRegisters;
+        reserve(newTop);
+        int32_t* window = registers_.data() + newBase;
+        int argc = ip[4];
+        std::memcpy(window, r + ip[3], sizeof(int32_t) * argc);
+        std::fill(window + argc, window + callee.numRegisters, 0);
+        frames_.push_back({ip + 5, base, top, ip[1]});
+        base = newBase;
+        top = newTop;
+        r = window;
+        ip = code + callee.entry;
+        VM_NEXT();
+    }
+    VM_CASE(TailCall): {
+        // 复用当前窗口：实参移到r0起始处
+        const BytecodeFunction& callee = functions[ip[1]];
+        size_t newTop = base + callee.numRegisters;
+        reserve(newTop);
+        int argc = ip[3];
+        std::memmove(r, r + ip[2], sizeof(int32_t) * argc);
+        std::fill(r + argc, r + callee.numRegisters, 0);
+        top = newTop;
+        ip = code + callee.entry;
+        VM_NEXT();
+    }
+    VM_CASE(Return): {
+        int32_t value = r[ip[1]];
+        if (frames_.empty()) {
+            return value;
+        }
+        const Frame& frame = frames_.back();
+        base = frame.base;
+        top = frame.top;
+        r = registers_.data() + base;
+        r[frame.target] = value;
+        ip = frame.returnIp;
+        frames_.pop_back();
+        VM_NEXT();
+    }
+    VM_CASE(Print): {
+        print(r[ip[1]]);
+        ip += 2;
+        VM_NEXT();
+    }
+
+#if !VM_COMPUTED_GOTO
+    }
+#endif
+#undef VM_BINARY
+#undef VM_CASE
+#undef VM_NEXT
+}
+
+#if VM_COMPUTED_GOTO
+#pragma GCC diagnostic pop
+#endif
+
+void VM::print(int32_t value) {
+    char digits[12];
+    char* end = digits + sizeof(digits);
+    char* p = end;
+    uint32_t magnitude = value < 0 ? 0u - static_cast<uint32_t>(value) : static_cast<uint32_t>(value);
+    do {
+        *--p = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (value < 0) *--p = '-';
+    buffer_.append(p, end);
+    buffer_ += '\n';
+    if (buffer_.size() >= kOutputBufferSize) {
+        flush();
+    }
+}
+
+void VM::flush() {
+    if (!buffer_.empty()) {
+        std::fwrite(buffer_.data(), 1, buffer_.size(), out_);
+        buffer_.clear();
+    }
+    std::fflush(out_);
+}
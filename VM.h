@@ -0,0 +1,41 @@
+#ifndef VM_H
+#define VM_H
+
+#include "Bytecode.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/*
+ * 字节码解释器
+ * GCC/Clang下用computed goto做线程化分派，其他编译器退回switch。
+ * 所有函数的寄存器窗口依次排在同一个寄存器栈上，调用时只需移动窗口基址。
+ * 除以0和INT_MIN / -1在原生代码中会触发SIGFPE，这里抛出runtime_error。
+ */
+class VM {
+public:
+    explicit VM(const BytecodeProgram& program, std::FILE* out = stdout);
+
+    // 执行入口函数并返回其返回值
+    int run(const std::string& entry = "main");
+
+private:
+    struct Frame {
+        const int32_t* returnIp;
+        size_t base;   // 调用者寄存器窗口的起点
+        size_t top;    // 调用者寄存器窗口的终点
+        int32_t target; // 返回值写入调用者的哪个寄存器
+    };
+
+    const BytecodeProgram& program_;
+    std::FILE* out_;
+    std::vector<int32_t> registers_;
+    std::vector<Frame> frames_;
+    std::string buffer_; // println_int的输出缓冲
+
+    int execute(const BytecodeFunction& entry);
+    void print(int32_t value);
+    void flush();
+};
+
+#endif // VM_H
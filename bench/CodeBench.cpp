@@ -0,0 +1,489 @@
+#include "Bytecode.h"
+#include "Compiler.h"
+#include "Driver.h"
+#include "VM.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+/*
+ * 生成代码的性能基准和差分执行
+ * 对语料目录（默认bench/corpus）中的每个程序：
+ *   1. 用字节码解释器执行一遍，它的输出和退出码作为参照结果
+ *   2. 按每种配置（目标和优化选项）编译成汇编，用cc汇编链接，运行若干次
+ *   3. 比较输出和退出码；记录最短运行时间、该次运行退休的用户态指令数（perf_event_open，
+ *      不可用时为null），以及每个函数的静态指令条数
+ * 结果默认输出为JSON；有程序的结果与参照不同或编译、链接、运行失败时退出码为1。
+ *
+ * 用法: compilerlab_codebench [--corpus=DIR] [--program=NAME] [--config=NAME] [--runs=N]
+ *       [--cc=CC] [--i386] [--work-dir=DIR] [--format=json|text]
+ *   --i386 同时测量i386配置（用 cc -m32 链接，需要32位C库）
+ */
+
+namespace {
+
+struct Config {
+    std::string name;
+    std::vector<std::string> flags; // 与命令行相同的编译选项
+    bool m32;
+    bool pgo = false; // 先插桩编译并运行一次（训练运行），再用得到的profile编译
+};
+
+std::vector<Config> configs(bool i386) {
+    std::vector<Config> list = {
+        {"x64", {"--target=x86-64"}, false},
+        {"x64-opt", {"--target=x86-64", "--inline", "--tail-calls"}, false},
+        {"x64-O2", {"--target=x86-64", "-O2"}, false},
+        {"x64-Os", {"--target=x86-64", "-Os"}, false},
+        {"x64-opt-fast-print", {"--target=x86-64", "--inline", "--tail-calls", "--fast-print"}, false},
+        {"x64-pgo", {"--target=x86-64", "--inline", "--tail-calls"}, false, true},
+        {"x64-memo", {"--target=x86-64", "--inline", "--tail-calls", "--memoize"}, false},
+    };
+    if (i386) {
+        list.push_back({"i386", {}, true});
+        list.push_back({"i386-opt", {"--inline", "--tail-calls", "--regcall"}, true});
+    }
+    return list;
+}
+
+struct Reference {
+    std::string output;
+    int exitCode = 0;
+    double seconds = 0;
+};
+
+struct ConfigResult {
+    std::string name;
+    std::string status = "ok"; // ok、mismatch、compile-error、link-error、crash
+    std::string detail;
+    int exitCode = 0;
+    double minSeconds = 0;
+    double medianSeconds = 0;
+    long long instructions = -1; // 最短那次运行的退休指令数，-1表示无法测量
+    std::vector<std::pair<std::string, int>> functions; // 每个函数的静态指令条数，按输出顺序
+};
+
+struct ProgramResult {
+    std::string name;
+    Reference reference;
+    std::vector<ConfigResult> configs;
+};
+
+struct RunResult {
+    bool exited = false;
+    int exitCode = 0;
+    int signal = 0;
+    double seconds = 0;
+    long long instructions = -1;
+};
+
+std::string readFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("could not open file " + path);
+    }
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string& path, const std::string& content) {
+    std::ofstream file(path, std::ios::binary);
+    file << content;
+    if (!file) {
+        throw std::runtime_error("could not write file " + path);
+    }
+}
+
+std::string shellQuote(const std::string& text) {
+    std::string out = "'";
+    for (char c : text) {
+        if (c == '\'') out += "'\\''";
+        else out += c;
+    }
+    return out + "'";
+}
+
+std::string jsonString(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (c == '\n') {
+            out += "\\n";
+            continue;
+        }
+        out += c;
+    }
+    return out + "\"";
+}
+
+// 语料目录中的 *.c，按名字排序
+std::vector<std::string> corpusPrograms(const std::string& dir) {
+    std::vector<std::string> names;
+    DIR* handle = opendir(dir.c_str());
+    if (!handle) {
+        throw std::runtime_error("could not open corpus directory " + dir);
+    }
+    while (dirent* entry = readdir(handle)) {
+        std::string name = entry->d_name;
+        if (name.size() > 2 && name.compare(name.size() - 2, 2, ".c") == 0) {
+            names.push_back(name.substr(0, name.size() - 2));
+        }
+    }
+    closedir(handle);
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+// 字节码解释器的执行结果作为参照
+Reference runReference(const std::string& source) {
+    DriverOptions options;
+    TokenStream tokens = lexSource(source, options);
+    std::unique_ptr<Program> program = parseProgram(tokens, options);
+    BytecodeProgram bytecode = BytecodeCompiler().compile(*program);
+
+    std::FILE* out = std::tmpfile();
+    if (!out) {
+        throw std::runtime_error("could not create a temporary file");
+    }
+    Reference reference;
+    auto start = std::chrono::steady_clock::now();
+    try {
+        reference.exitCode = VM(bytecode, out).run() & 0xff;
+    } catch (...) {
+        std::fclose(out);
+        throw;
+    }
+    reference.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::fflush(out);
+    std::rewind(out);
+    char buffer[65536];
+    size_t n;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), out)) > 0) {
+        reference.output.append(buffer, n);
+    }
+    std::fclose(out);
+    return reference;
+}
+
+// 汇编文本中每个函数的指令条数：顶格的 "name:"（不以.开头）开始一个函数，
+// 缩进且不以.开头的行是一条指令
+std::vector<std::pair<std::string, int>> staticInstructionCounts(const std::string& text) {
+    std::vector<std::pair<std::string, int>> functions;
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty()) continue;
+        if (line[0] == ' ' || line[0] == '\t') {
+            size_t first = line.find_first_not_of(" \t");
+            if (first != std::string::npos && line[first] != '.' && !functions.empty()) {
+                functions.back().second++;
+            }
+        } else if (line[0] != '.' && line.back() == ':' && line.find(' ') == std::string::npos) {
+            functions.push_back({line.substr(0, line.size() - 1), 0});
+        }
+    }
+    return functions;
+}
+
+#ifdef __linux__
+// 子进程（exec之后）的用户态退休指令数计数器，不可用时返回-1
+int openInstructionCounter(pid_t pid) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.enable_on_exec = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(syscall(__NR_perf_event_open, &attr, pid, -1, -1, 0));
+}
+#endif
+
+// 运行可执行文件，标准输出写到outputPath
+RunResult runProgram(const std::string& executable, const std::string& outputPath) {
+    int gate[2];
+    if (pipe(gate) != 0) {
+        throw std::runtime_error("pipe failed: " + std::string(std::strerror(errno)));
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        throw std::runtime_error("fork failed: " + std::string(std::strerror(errno)));
+    }
+    if (pid == 0) {
+        // 等父进程装好计数器再exec
+        close(gate[1]);
+        char go;
+        if (read(gate[0], &go, 1) < 0) _exit(127);
+        close(gate[0]);
+        int fd = open(outputPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || dup2(fd, STDOUT_FILENO) < 0) _exit(127);
+        close(fd);
+        execl(executable.c_str(), executable.c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+
+    close(gate[0]);
+    int counter = -1;
+#ifdef __linux__
+    counter = openInstructionCounter(pid);
+#endif
+    auto start = std::chrono::steady_clock::now();
+    char go = 1;
+    if (write(gate[1], &go, 1) < 0) {
+        // 子进程已经退出，下面的waitpid会得到结果
+    }
+    close(gate[1]);
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+
+    RunResult result;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.exited = WIFEXITED(status);
+    result.exitCode = result.exited ? WEXITSTATUS(status) : 0;
+    result.signal = WIFSIGNALED(status) ? WTERMSIG(status) : 0;
+    if (counter >= 0) {
+        long long count = 0;
+        if (read(counter, &count, sizeof(count)) == static_cast<ssize_t>(sizeof(count))) {
+            result.instructions = count;
+        }
+        close(counter);
+    }
+    return result;
+}
+
+// 编译并用cc链接成可执行文件base，失败时在result中记录原因
+bool build(const std::string& source, const DriverOptions& options, const std::string& name,
+           const std::string& base, const std::string& cc, bool m32, ConfigResult& result, std::string& assembly) {
+    CompileResult compiled = compile(source, options);
+    if (!compiled.ok) {
+        result.status = "compile-error";
+        result.detail = compiled.diagnostics.empty() ? "" : formatDiagnostic(name + ".c", compiled.diagnostics[0]);
+        return false;
+    }
+    assembly = std::move(compiled.output);
+
+    writeFile(base + ".s", assembly);
+    std::string command = cc + (m32 ? " -m32" : "") + " " + shellQuote(base + ".s");
+    if (options.codeGen.fastPrint || !options.profileGenerate.empty()) {
+        command += " " + shellQuote(COMPILERLAB_RT_LIBRARY);
+    }
+    command += " -o " + shellQuote(base) + " 2>" + shellQuote(base + ".link.log");
+    if (std::system(command.c_str()) != 0) {
+        result.status = "link-error";
+        result.detail = readFile(base + ".link.log");
+        return false;
+    }
+    return true;
+}
+
+ConfigResult runConfig(const Config& config, const std::string& name, const std::string& source,
+                       const Reference& reference, const std::string& cc, const std::string& workDir, int runs) {
+    ConfigResult result;
+    result.name = config.name;
+
+    DriverOptions options;
+    for (const auto& flag : config.flags) {
+        parseDriverOption(flag, options);
+    }
+    std::string base = workDir + "/" + name + "-" + config.name;
+    std::string assembly;
+
+    if (config.pgo) {
+        // 训练运行：插桩的程序退出时写出profile，供下面的正式编译使用
+        DriverOptions training = options;
+        training.profileGenerate = base + ".profile";
+        std::remove(training.profileGenerate.c_str());
+        if (!build(source, training, name, base + "-train", cc, config.m32, result, assembly)) {
+            return result;
+        }
+        RunResult run = runProgram(base + "-train", base + "-train.out");
+        if (!run.exited) {
+            result.status = "crash";
+            result.detail = "training run terminated by signal " + std::to_string(run.signal);
+            return result;
+        }
+        options.profileUse = training.profileGenerate;
+    }
+
+    if (!build(source, options, name, base, cc, config.m32, result, assembly)) {
+        return result;
+    }
+    result.functions = staticInstructionCounts(assembly);
+
+    std::vector<RunResult> samples;
+    for (int i = 0; i < runs; ++i) {
+        RunResult run = runProgram(base, base + ".out");
+        if (!run.exited) {
+            result.status = "crash";
+            result.detail = "terminated by signal " + std::to_string(run.signal);
+            return result;
+        }
+        if (i == 0) {
+            result.exitCode = run.exitCode;
+            if (run.exitCode != reference.exitCode || readFile(base + ".out") != reference.output) {
+                result.status = "mismatch";
+                result.detail = "output or exit code differs from the bytecode interpreter (see " + base + ".out)";
+            }
+        }
+        samples.push_back(run);
+    }
+    std::sort(samples.begin(), samples.end(),
+              [](const RunResult& a, const RunResult& b) { return a.seconds < b.seconds; });
+    result.minSeconds = samples.front().seconds;
+    result.medianSeconds = samples[samples.size() / 2].seconds;
+    result.instructions = samples.front().instructions;
+    return result;
+}
+
+int totalInstructions(const ConfigResult& result) {
+    int total = 0;
+    for (const auto& entry : result.functions) total += entry.second;
+    return total;
+}
+
+void printJson(std::ostream& out, const std::vector<ProgramResult>& results, int runs) {
+    out << std::setprecision(6);
+    out << "{\"benchmark\":\"compilerlab-codegen\",\"runs\":" << runs << ",\"programs\":[";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const ProgramResult& program = results[i];
+        out << (i ? "," : "") << "\n{\"name\":" << jsonString(program.name)
+            << ",\"reference\":{\"exit_code\":" << program.reference.exitCode
+            << ",\"output_bytes\":" << program.reference.output.size()
+            << ",\"vm_seconds\":" << program.reference.seconds << "},\"configs\":[";
+        for (size_t j = 0; j < program.configs.size(); ++j) {
+            const ConfigResult& config = program.configs[j];
+            out << (j ? "," : "") << "\n  {\"name\":" << jsonString(config.name)
+                << ",\"status\":" << jsonString(config.status);
+            if (!config.detail.empty()) out << ",\"detail\":" << jsonString(config.detail);
+            out << ",\"min_seconds\":" << config.minSeconds
+                << ",\"median_seconds\":" << config.medianSeconds
+                << ",\"instructions\":";
+            if (config.instructions >= 0) out << config.instructions;
+            else out << "null";
+            out << ",\"static_instructions\":" << totalInstructions(config) << ",\"functions\":{";
+            for (size_t k = 0; k < config.functions.size(); ++k) {
+                out << (k ? "," : "") << jsonString(config.functions[k].first) << ":" << config.functions[k].second;
+            }
+            out << "}}";
+        }
+        out << "]}";
+    }
+    out << "\n]}\n";
+}
+
+void printText(std::ostream& out, const std::vector<ProgramResult>& results, int runs) {
+    out << "runs: " << runs << " (best of)\n";
+    for (const auto& program : results) {
+        out << "\n" << program.name << ": reference " << program.reference.output.size() << " bytes, exit "
+            << program.reference.exitCode << ", vm " << std::fixed << std::setprecision(3)
+            << program.reference.seconds * 1000 << " ms\n";
+        out << std::left << std::setw(24) << "  config" << std::setw(15) << "status" << std::right
+            << std::setw(12) << "min(ms)" << std::setw(14) << "Minstr" << std::setw(10) << "static" << "\n";
+        for (const auto& config : program.configs) {
+            out << "  " << std::left << std::setw(22) << config.name << std::setw(15) << config.status << std::right
+                << std::setw(12) << config.minSeconds * 1000 << std::setw(14);
+            if (config.instructions >= 0) out << config.instructions / 1e6;
+            else out << "-";
+            out << std::setw(10) << totalInstructions(config) << "\n";
+            if (!config.detail.empty()) out << "    " << config.detail << "\n";
+        }
+        out.unsetf(std::ios::floatfield);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        std::string corpus = COMPILERLAB_CORPUS_DIR;
+        std::string onlyProgram;
+        std::string onlyConfig;
+        std::string cc = "cc";
+        std::string workDir;
+        int runs = 3;
+        bool i386 = false;
+        bool json = true;
+
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg.compare(0, 9, "--corpus=") == 0) {
+                corpus = arg.substr(9);
+            } else if (arg.compare(0, 10, "--program=") == 0) {
+                onlyProgram = arg.substr(10);
+            } else if (arg.compare(0, 9, "--config=") == 0) {
+                onlyConfig = arg.substr(9);
+            } else if (arg.compare(0, 7, "--runs=") == 0) {
+                runs = std::max(1, std::atoi(arg.c_str() + 7));
+            } else if (arg.compare(0, 5, "--cc=") == 0) {
+                cc = arg.substr(5);
+            } else if (arg.compare(0, 11, "--work-dir=") == 0) {
+                workDir = arg.substr(11);
+            } else if (arg == "--i386") {
+                i386 = true;
+            } else if (arg == "--format=json") {
+                json = true;
+            } else if (arg == "--format=text") {
+                json = false;
+            } else {
+                throw std::runtime_error("unknown option: " + arg);
+            }
+        }
+
+        if (workDir.empty()) {
+            char pattern[] = "/tmp/compilerlab-codebench-XXXXXX";
+            if (!mkdtemp(pattern)) {
+                throw std::runtime_error("could not create a work directory");
+            }
+            workDir = pattern;
+        }
+
+        std::vector<ProgramResult> results;
+        bool failed = false;
+        for (const auto& name : corpusPrograms(corpus)) {
+            if (!onlyProgram.empty() && name != onlyProgram) continue;
+            ProgramResult program;
+            program.name = name;
+            std::string source = readFile(corpus + "/" + name + ".c");
+            program.reference = runReference(source);
+            for (const auto& config : configs(i386)) {
+                if (!onlyConfig.empty() && config.name != onlyConfig) continue;
+                program.configs.push_back(runConfig(config, name, source, program.reference, cc, workDir, runs));
+                failed = failed || program.configs.back().status != "ok";
+            }
+            results.push_back(std::move(program));
+        }
+
+        if (json) {
+            printJson(std::cout, results, runs);
+        } else {
+            printText(std::cout, results, runs);
+        }
+        return failed ? 1 : 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
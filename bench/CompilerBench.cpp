@@ -0,0 +1,326 @@
+#include "ProgramGenerator.h"
+#include "CodeGen.h"
+#include "CodeGenX64.h"
+#include "Driver.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "Stats.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/*
+ * 编译吞吐量基准测试
+ * 用固定种子生成若干组程序（函数个数、函数大小、表达式深度、循环嵌套、标识符长度各不相同），
+ * 分别测量 Lexer::tokenize（以及并行的tokenizeParallel）、Parser::parse（以及并行的parseParallel）、CodeGen::generateCode（以及x86-64后端）的耗时，
+ * 按输入折算成 MB/s、tokens/s、nodes/s。每个阶段重复多次取最小值和中位数，结果默认输出为JSON。
+ * end-to-end和end-to-end-pipeline是compileSource从源码到汇编文本的总延迟，分别为顺序编译和--pipeline。
+ *
+ * 用法: compilerlab_bench [--workload=NAME] [--iterations=N] [--seed=N] [--format=json|text] [--emit] [--list]
+ *       [--functions=N] [--statements=N] [--depth=N] [--loops=N] [--ident=N]
+ *   指定了生成参数时只运行一组名为custom的程序（未指定的参数取baseline的值）
+ *   --emit 输出生成的程序而不运行测试
+ */
+
+namespace {
+
+struct Workload {
+    std::string name;
+    GeneratorOptions generator;
+};
+
+struct PhaseResult {
+    std::string name;
+    double minSeconds = 0;
+    double medianSeconds = 0;
+};
+
+struct WorkloadResult {
+    Workload workload;
+    size_t sourceBytes = 0;
+    size_t tokens = 0;
+    size_t tokenBytes = 0; // TokenStream占用的内存
+    uint64_t nodes = 0;
+    size_t outputBytes = 0; // i386后端输出的汇编文本大小
+    std::vector<PhaseResult> phases;
+};
+
+Workload makeWorkload(const std::string& name, int functions, int statements, int depth, int loops, int ident) {
+    Workload workload;
+    workload.name = name;
+    workload.generator.functions = functions;
+    workload.generator.statements = statements;
+    workload.generator.expressionDepth = depth;
+    workload.generator.loopNesting = loops;
+    workload.generator.identifierLength = ident;
+    return workload;
+}
+
+std::vector<Workload> defaultWorkloads() {
+    return {
+        makeWorkload("baseline", 50, 20, 4, 2, 8),
+        makeWorkload("many-functions", 500, 4, 3, 1, 8),
+        makeWorkload("large-functions", 5, 300, 4, 2, 8),
+        makeWorkload("deep-expressions", 30, 10, 9, 1, 8),
+        makeWorkload("nested-loops", 30, 20, 3, 6, 8),
+        makeWorkload("long-identifiers", 50, 20, 4, 2, 64),
+    };
+}
+
+uint64_t countNodes(const Program& program) {
+    CompileStats stats;
+    stats.countProgram(program);
+    uint64_t nodes = 0;
+    for (const auto& entry : stats.astNodes) nodes += entry.second;
+    return nodes;
+}
+
+// 重复运行body，body返回本次被测部分的耗时（秒）
+PhaseResult measure(const std::string& name, int iterations, const std::function<double()>& body) {
+    std::vector<double> samples;
+    for (int i = 0; i < iterations; ++i) {
+        samples.push_back(body());
+    }
+    std::sort(samples.begin(), samples.end());
+    PhaseResult result;
+    result.name = name;
+    result.minSeconds = samples.front();
+    result.medianSeconds = samples[samples.size() / 2];
+    return result;
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+WorkloadResult run(const Workload& workload, int iterations) {
+    WorkloadResult result;
+    result.workload = workload;
+    std::string source = ProgramGenerator(workload.generator).generate();
+    TokenStream tokens = Lexer(source).tokenize();
+    result.sourceBytes = source.size();
+    result.tokens = tokens.size();
+    result.tokenBytes = tokens.memoryUsage();
+    result.nodes = countNodes(*Parser(tokens).parse());
+
+    result.phases.push_back(measure("lex", iterations, [&source] {
+        auto start = std::chrono::steady_clock::now();
+        TokenStream lexed = Lexer(source).tokenize();
+        return secondsSince(start);
+    }));
+    // 源码不到每线程1MB时退回顺序分析，用大的custom工作负载（例如--functions=20000）观察扩展性
+    result.phases.push_back(measure("lex-parallel", iterations, [&source] {
+        auto start = std::chrono::steady_clock::now();
+        TokenStream lexed = Lexer(source).tokenizeParallel();
+        return secondsSince(start);
+    }));
+    result.phases.push_back(measure("parse", iterations, [&tokens] {
+        auto start = std::chrono::steady_clock::now();
+        std::unique_ptr<Program> program = Parser(tokens).parse();
+        return secondsSince(start);
+    }));
+    result.phases.push_back(measure("parse-parallel", iterations, [&tokens] {
+        auto start = std::chrono::steady_clock::now();
+        std::unique_ptr<Program> program = Parser(tokens).parseParallel();
+        return secondsSince(start);
+    }));
+    // 代码生成会消耗AST，每次重新做语法分析（不计时）
+    result.phases.push_back(measure("codegen", iterations, [&tokens, &result] {
+        std::ostringstream out;
+        CodeGenOptions options;
+        options.output = &out;
+        CodeGen codeGen(Parser(tokens).parse(), options);
+        auto start = std::chrono::steady_clock::now();
+        codeGen.generateCode();
+        double seconds = secondsSince(start);
+        result.outputBytes = out.str().size();
+        return seconds;
+    }));
+    result.phases.push_back(measure("codegen-x64", iterations, [&tokens] {
+        std::ostringstream out;
+        CodeGenOptions options;
+        options.output = &out;
+        CodeGenX64 codeGen(Parser(tokens).parse(), options);
+        auto start = std::chrono::steady_clock::now();
+        codeGen.generateCode();
+        return secondsSince(start);
+    }));
+    result.phases.push_back(measure("end-to-end", iterations, [&source] {
+        std::ostringstream out;
+        auto start = std::chrono::steady_clock::now();
+        compileSource(source, DriverOptions(), out);
+        return secondsSince(start);
+    }));
+    result.phases.push_back(measure("end-to-end-pipeline", iterations, [&source] {
+        std::ostringstream out;
+        DriverOptions options;
+        options.pipeline = true;
+        auto start = std::chrono::steady_clock::now();
+        compileSource(source, options, out);
+        return secondsSince(start);
+    }));
+    return result;
+}
+
+double perSecond(double amount, double seconds) {
+    return seconds > 0 ? amount / seconds : 0;
+}
+
+void printJson(std::ostream& out, const std::vector<WorkloadResult>& results, int iterations) {
+    out << std::setprecision(6);
+    out << "{\"benchmark\":\"compilerlab\",\"iterations\":" << iterations << ",\"workloads\":[";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const WorkloadResult& result = results[i];
+        const GeneratorOptions& generator = result.workload.generator;
+        out << (i ? "," : "") << "\n{\"name\":\"" << result.workload.name << "\""
+            << ",\"seed\":" << generator.seed
+            << ",\"functions\":" << generator.functions
+            << ",\"statements\":" << generator.statements
+            << ",\"expression_depth\":" << generator.expressionDepth
+            << ",\"loop_nesting\":" << generator.loopNesting
+            << ",\"identifier_length\":" << generator.identifierLength
+            << ",\"source_bytes\":" << result.sourceBytes
+            << ",\"tokens\":" << result.tokens
+            << ",\"token_bytes\":" << result.tokenBytes
+            << ",\"nodes\":" << result.nodes
+            << ",\"output_bytes\":" << result.outputBytes
+            << ",\"phases\":[";
+        for (size_t j = 0; j < result.phases.size(); ++j) {
+            const PhaseResult& phase = result.phases[j];
+            out << (j ? "," : "") << "{\"name\":\"" << phase.name << "\""
+                << ",\"min_seconds\":" << phase.minSeconds
+                << ",\"median_seconds\":" << phase.medianSeconds
+                << ",\"mb_per_s\":" << perSecond(result.sourceBytes / 1e6, phase.minSeconds)
+                << ",\"tokens_per_s\":" << perSecond(result.tokens, phase.minSeconds)
+                << ",\"nodes_per_s\":" << perSecond(result.nodes, phase.minSeconds) << "}";
+        }
+        out << "]}";
+    }
+    out << "\n]}\n";
+}
+
+void printText(std::ostream& out, const std::vector<WorkloadResult>& results, int iterations) {
+    out << "iterations: " << iterations << " (best of)\n";
+    for (const auto& result : results) {
+        out << "\n" << result.workload.name << ": " << result.sourceBytes << " bytes, "
+            << result.tokens << " tokens (" << result.tokenBytes << " bytes), " << result.nodes << " nodes\n";
+        out << std::left << std::setw(22) << "  phase" << std::right << std::setw(12) << "min(ms)"
+            << std::setw(12) << "MB/s" << std::setw(14) << "Mtokens/s" << std::setw(14) << "Mnodes/s" << "\n";
+        for (const auto& phase : result.phases) {
+            out << "  " << std::left << std::setw(20) << phase.name << std::right << std::fixed
+                << std::setprecision(3) << std::setw(12) << phase.minSeconds * 1000
+                << std::setprecision(2) << std::setw(12) << perSecond(result.sourceBytes / 1e6, phase.minSeconds)
+                << std::setw(14) << perSecond(result.tokens / 1e6, phase.minSeconds)
+                << std::setw(14) << perSecond(result.nodes / 1e6, phase.minSeconds) << "\n";
+            out.unsetf(std::ios::floatfield);
+        }
+    }
+}
+
+int intValue(const std::string& arg, size_t prefixLength) {
+    try {
+        return std::stoi(arg.substr(prefixLength));
+    } catch (const std::exception&) {
+        throw std::runtime_error("invalid number in " + arg);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        int iterations = 5;
+        uint32_t seed = 1;
+        bool json = true;
+        bool emit = false;
+        bool list = false;
+        bool custom = false;
+        std::string only;
+        Workload customWorkload = defaultWorkloads().front();
+        customWorkload.name = "custom";
+        GeneratorOptions& generator = customWorkload.generator;
+
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto has = [&arg](const char* prefix) { return arg.compare(0, std::string(prefix).size(), prefix) == 0; };
+            if (has("--iterations=")) {
+                iterations = std::max(1, intValue(arg, 13));
+            } else if (has("--seed=")) {
+                seed = static_cast<uint32_t>(intValue(arg, 7));
+            } else if (arg == "--format=json") {
+                json = true;
+            } else if (arg == "--format=text") {
+                json = false;
+            } else if (arg == "--emit") {
+                emit = true;
+            } else if (arg == "--list") {
+                list = true;
+            } else if (has("--workload=")) {
+                only = arg.substr(11);
+            } else if (has("--functions=")) {
+                generator.functions = std::max(0, intValue(arg, 12));
+                custom = true;
+            } else if (has("--statements=")) {
+                generator.statements = std::max(0, intValue(arg, 13));
+                custom = true;
+            } else if (has("--depth=")) {
+                generator.expressionDepth = std::max(1, intValue(arg, 8));
+                custom = true;
+            } else if (has("--loops=")) {
+                generator.loopNesting = std::max(0, intValue(arg, 8));
+                custom = true;
+            } else if (has("--ident=")) {
+                generator.identifierLength = std::max(1, intValue(arg, 8));
+                custom = true;
+            } else {
+                throw std::runtime_error("unknown option: " + arg);
+            }
+        }
+
+        std::vector<Workload> workloads;
+        if (custom) {
+            workloads.push_back(customWorkload);
+        } else {
+            for (const auto& workload : defaultWorkloads()) {
+                if (only.empty() || workload.name == only) workloads.push_back(workload);
+            }
+            if (workloads.empty()) {
+                throw std::runtime_error("unknown workload: " + only);
+            }
+        }
+        for (auto& workload : workloads) {
+            workload.generator.seed = seed;
+        }
+
+        if (list) {
+            for (const auto& workload : workloads) std::cout << workload.name << "\n";
+            return 0;
+        }
+        if (emit) {
+            for (const auto& workload : workloads) {
+                std::cout << ProgramGenerator(workload.generator).generate();
+            }
+            return 0;
+        }
+
+        std::vector<WorkloadResult> results;
+        for (const auto& workload : workloads) {
+            results.push_back(run(workload, iterations));
+        }
+        if (json) {
+            printJson(std::cout, results, iterations);
+        } else {
+            printText(std::cout, results, iterations);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
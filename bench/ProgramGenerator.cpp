@@ -0,0 +1,183 @@
+#include "ProgramGenerator.h"
+#include <algorithm>
+
+namespace {
+
+const char* const kOperators[] = {
+    "+", "-", "*", "+", "-", "<", ">", "<=", ">=", "==", "!=", "&", "|", "^", "&&", "||",
+};
+const int kOperatorCount = sizeof(kOperators) / sizeof(kOperators[0]);
+
+const int kLoopBound = 4; // 每层循环最多执行的次数
+
+} // namespace
+
+ProgramGenerator::ProgramGenerator(const GeneratorOptions& options)
+    : options_(options), rng_(options.seed) {}
+
+int ProgramGenerator::random(int lo, int hi) {
+    return std::uniform_int_distribution<int>(lo, hi)(rng_);
+}
+
+bool ProgramGenerator::chance(int percent) {
+    return random(0, 99) < percent;
+}
+
+std::string ProgramGenerator::identifier(char prefix, int index) {
+    std::string name = prefix + std::to_string(index);
+    if (static_cast<int>(name.size()) < options_.identifierLength) {
+        name.append(options_.identifierLength - name.size(), 'x');
+    }
+    return name;
+}
+
+std::string ProgramGenerator::generate() {
+    out_.clear();
+    functions_.clear();
+    for (int i = 0; i < options_.functions; ++i) {
+        int params = random(0, std::max(0, options_.maxParams));
+        std::string name = identifier('f', i);
+        genFunction(name, params, false);
+        functions_.push_back({name, params});
+    }
+    genFunction("main", 0, true);
+    return out_;
+}
+
+void ProgramGenerator::line(const std::string& text) {
+    out_.append(indent_ * 4, ' ');
+    out_ += text;
+    out_ += '\n';
+}
+
+void ProgramGenerator::genFunction(const std::string& name, int params, bool isMain) {
+    variables_.clear();
+    next_variable_ = 0;
+    loop_depth_ = 0;
+
+    std::string header = "int " + name + "(";
+    for (int i = 0; i < params; ++i) {
+        std::string param = identifier('p', i);
+        header += (i ? ", int " : "int ") + param;
+        variables_.push_back(param);
+    }
+    line(header + ") {");
+    indent_++;
+    // 保证表达式总有变量可用
+    std::string first = identifier('v', next_variable_++);
+    line("int " + first + " = " + std::to_string(random(0, 100)) + ";");
+    variables_.push_back(first);
+    genBlock(options_.statements, 0);
+    if (isMain) {
+        line("println_int(" + first + ");");
+        line("return 0;");
+    } else {
+        line("return " + genExpression(options_.expressionDepth) + ";");
+    }
+    indent_--;
+    line("}");
+}
+
+void ProgramGenerator::genBlock(int statements, int depth) {
+    size_t visible = variables_.size();
+    for (int i = 0; i < statements; ++i) {
+        genStatement(depth);
+    }
+    variables_.resize(visible); // 块内声明的变量出块后不可见
+}
+
+void ProgramGenerator::genStatement(int depth) {
+    int kind = random(0, 99);
+    bool nestable = depth < options_.loopNesting + 2;
+    if (kind < 25) {
+        std::string decl = "int ";
+        int count = random(1, 2);
+        std::vector<std::string> names;
+        for (int i = 0; i < count; ++i) {
+            std::string name = identifier('v', next_variable_++);
+            decl += (i ? ", " : "") + name + " = " + genExpression(options_.expressionDepth);
+            names.push_back(name);
+        }
+        line(decl + ";");
+        variables_.insert(variables_.end(), names.begin(), names.end());
+    } else if (kind < 50) {
+        const std::string& target = variables_[random(0, static_cast<int>(variables_.size()) - 1)];
+        line(target + " = " + genExpression(options_.expressionDepth) + ";");
+    } else if (kind < 58) {
+        line("println_int(" + genExpression(options_.expressionDepth) + ");");
+    } else if (kind < 64 && !functions_.empty()) {
+        line(genCall(options_.expressionDepth) + ";");
+    } else if (kind < 78 && nestable) {
+        line("if (" + genExpression(options_.expressionDepth) + ") {");
+        indent_++;
+        genBlock(random(1, 3), depth + 1);
+        indent_--;
+        if (chance(50)) {
+            line("} else {");
+            indent_++;
+            genBlock(random(1, 3), depth + 1);
+            indent_--;
+        }
+        line("}");
+    } else if (kind < 90 && nestable && loop_depth_ < options_.loopNesting) {
+        // 循环变量在循环体开头递增，continue和break不会造成死循环
+        std::string counter = identifier('v', next_variable_++);
+        line("int " + counter + " = 0;");
+        variables_.push_back(counter);
+        line("while (" + counter + " < " + std::to_string(random(1, kLoopBound)) + ") {");
+        indent_++;
+        line(counter + " = " + counter + " + 1;");
+        loop_depth_++;
+        genBlock(random(1, 4), depth + 1);
+        if (chance(20)) {
+            line("if (" + genExpression(1) + ") {");
+            indent_++;
+            line(chance(50) ? "break;" : "continue;");
+            indent_--;
+            line("}");
+        }
+        loop_depth_--;
+        indent_--;
+        line("}");
+    } else if (kind < 95) {
+        line("if (" + genExpression(options_.expressionDepth) + ") {");
+        indent_++;
+        line("return " + genExpression(options_.expressionDepth) + ";");
+        indent_--;
+        line("}");
+    } else {
+        const std::string& target = variables_[random(0, static_cast<int>(variables_.size()) - 1)];
+        line(target + " = " + target + " + " + std::to_string(random(1, 9)) + ";");
+    }
+}
+
+std::string ProgramGenerator::genExpression(int depth) {
+    int kind = random(0, 99);
+    if (depth <= 1 || kind < 15) {
+        if (chance(60)) {
+            return variables_[random(0, static_cast<int>(variables_.size()) - 1)];
+        }
+        return std::to_string(random(0, 1000));
+    }
+    if (kind < 22 && !functions_.empty()) {
+        return genCall(depth - 1);
+    }
+    if (kind < 30) {
+        // 除数在1到8之间
+        const char* op = chance(50) ? " / " : " % ";
+        return "(" + genExpression(depth - 1) + op + "((" + genExpression(depth - 1) + " & 7) + 1))";
+    }
+    int size = random(1, depth - 1);
+    std::string left = genExpression(size);
+    std::string right = genExpression(depth - 1);
+    return "(" + left + " " + kOperators[random(0, kOperatorCount - 1)] + " " + right + ")";
+}
+
+std::string ProgramGenerator::genCall(int depth) {
+    const Function& callee = functions_[random(0, static_cast<int>(functions_.size()) - 1)];
+    std::string call = callee.name + "(";
+    for (int i = 0; i < callee.params; ++i) {
+        call += (i ? ", " : "") + genExpression(std::max(1, depth - 1));
+    }
+    return call + ")";
+}
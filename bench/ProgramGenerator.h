@@ -0,0 +1,60 @@
+#ifndef PROGRAM_GENERATOR_H
+#define PROGRAM_GENERATOR_H
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ * 随机程序生成器（基准测试用）
+ * 同一个种子和参数总是生成同一个程序。生成的程序能通过编译：
+ *   - 变量先声明后使用，函数只调用前面定义过的函数（没有递归），实参个数正确
+ *   - 标识符以v、f、p开头，避开词法分析器按前缀匹配的关键字
+ *   - 循环变量在循环体开头递增，循环次数有上限；除数形如 ((e & 7) + 1)，不会为0
+ * 运行时间随调用嵌套可能很长，生成器只保证能编译和能终止。
+ */
+struct GeneratorOptions {
+    uint32_t seed = 1;
+    int functions = 20;          // 函数个数（不含main）
+    int statements = 20;         // 每个函数体顶层的语句个数
+    int expressionDepth = 4;     // 表达式树的最大深度
+    int loopNesting = 2;         // while的最大嵌套层数
+    int identifierLength = 8;    // 标识符长度（不足时用x补齐）
+    int maxParams = 4;
+};
+
+class ProgramGenerator {
+public:
+    explicit ProgramGenerator(const GeneratorOptions& options);
+
+    std::string generate();
+
+private:
+    struct Function {
+        std::string name;
+        int params;
+    };
+
+    GeneratorOptions options_;
+    std::mt19937 rng_;
+    std::string out_;
+    std::vector<Function> functions_;      // 已经生成的函数
+    std::vector<std::string> variables_;   // 当前作用域可见的变量
+    int next_variable_ = 0;
+    int loop_depth_ = 0;
+    int indent_ = 0;
+
+    int random(int lo, int hi); // [lo, hi]
+    bool chance(int percent);
+    std::string identifier(char prefix, int index);
+
+    void genFunction(const std::string& name, int params, bool isMain);
+    void genStatement(int depth);
+    void genBlock(int statements, int depth);
+    std::string genExpression(int depth);
+    std::string genCall(int depth);
+    void line(const std::string& text);
+};
+
+#endif // PROGRAM_GENERATOR_H
@@ -0,0 +1,23 @@
+int ack(int m, int n) {
+    if (m == 0) {
+        return n + 1;
+    }
+    if (n == 0) {
+        return ack(m - 1, 1);
+    }
+    return ack(m - 1, ack(m, n - 1));
+}
+
+int tak(int x, int y, int z) {
+    if (y < x) {
+        return tak(tak(x - 1, y, z), tak(y - 1, z, x), tak(z - 1, x, y));
+    }
+    return z;
+}
+
+int main() {
+    println_int(ack(2, 500));
+    println_int(ack(3, 7));
+    println_int(tak(22, 16, 8));
+    return 0;
+}
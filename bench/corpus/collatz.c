@@ -0,0 +1,29 @@
+int steps(int n) {
+    int count = 0;
+    while (n != 1) {
+        if (n % 2 == 0) {
+            n = n / 2;
+        } else {
+            n = 3 * n + 1;
+        }
+        count = count + 1;
+    }
+    return count;
+}
+
+int main() {
+    int best = 0;
+    int bestStart = 0;
+    int n = 1;
+    while (n < 100000) {
+        int s = steps(n);
+        if (s > best) {
+            best = s;
+            bestStart = n;
+        }
+        n = n + 1;
+    }
+    println_int(bestStart);
+    println_int(best);
+    return 0;
+}
@@ -0,0 +1,21 @@
+int gcd(int a, int b) {
+    if (b == 0) {
+        return a;
+    }
+    return gcd(b, a % b);
+}
+
+int main() {
+    int sum = 0;
+    int i = 1;
+    while (i <= 500) {
+        int j = 1;
+        while (j <= 500) {
+            sum = sum + gcd(i, j);
+            j = j + 1;
+        }
+        i = i + 1;
+    }
+    println_int(sum);
+    return 0;
+}
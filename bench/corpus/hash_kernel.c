@@ -0,0 +1,19 @@
+int mix(int h, int x) {
+    h = h ^ x;
+    h = h * 16777619;
+    return h ^ (h / 8192 & 524287);
+}
+
+int main() {
+    int h = 216613626;
+    int seed = 12345;
+    int i = 0;
+    while (i < 3000000) {
+        seed = seed * 1103515245 + 12345;
+        h = mix(h, seed / 65536 & 32767);
+        i = i + 1;
+    }
+    println_int(h);
+    println_int(seed);
+    return 0;
+}
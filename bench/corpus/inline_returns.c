@@ -0,0 +1,51 @@
+int square(int x) {
+    return x * x;
+}
+
+int step(int x) {
+    return square(x % 1000 + 1);
+}
+
+int isOdd(int x) {
+    if (x % 2 == 1) {
+        return 1;
+    }
+}
+
+int pick(int a, int b) {
+    if (a > b) {
+        return step(a);
+    }
+    return step(b) + isOdd(a);
+}
+
+int mix(int a, int b) {
+    int c = a * 31 + b;
+    if (c % 3 == 0) {
+        c = c / 3 + a;
+    }
+    if (c % 5 == 0) {
+        return isOdd(c) + b;
+    }
+    return step(c + a * b);
+}
+
+int gcd(int a, int b) {
+    if (b == 0) {
+        return a;
+    }
+    return gcd(b, a % b);
+}
+
+int main() {
+    int sum = 0;
+    int i = 1;
+    while (i <= 300000) {
+        sum = sum + pick(i % 977, i % 991) + isOdd(i) + gcd(i, 360);
+        sum = sum + mix(i % 613, i % 17) - mix(i % 101, 7);
+        sum = sum % 1000000007;
+        i = i + 1;
+    }
+    println_int(sum);
+    return 0;
+}
@@ -0,0 +1,21 @@
+int main() {
+    int total = 0;
+    int i = 0;
+    while (i < 200) {
+        int j = 0;
+        while (j < 200) {
+            int k = 0;
+            while (k < 200) {
+                total = total + (i * j + k) % 7;
+                if (k % 13 == 0) {
+                    total = total + 1;
+                }
+                k = k + 1;
+            }
+            j = j + 1;
+        }
+        i = i + 1;
+    }
+    println_int(total);
+    return 0;
+}
@@ -0,0 +1,29 @@
+int isPrime(int n) {
+    if (n < 2) {
+        return 0;
+    }
+    int d = 2;
+    while (d * d <= n) {
+        if (n % d == 0) {
+            return 0;
+        }
+        d = d + 1;
+    }
+    return 1;
+}
+
+int main() {
+    int count = 0;
+    int last = 0;
+    int n = 0;
+    while (n < 150000) {
+        if (isPrime(n)) {
+            count = count + 1;
+            last = n;
+        }
+        n = n + 1;
+    }
+    println_int(count);
+    println_int(last);
+    return 0;
+}
@@ -0,0 +1,11 @@
+int main() {
+    int i = 0;
+    int x = 1;
+    while (i < 200000) {
+        x = (x * 75 + 74) % 65537;
+        println_int(x);
+        println_int(i * i);
+        i = i + 1;
+    }
+    return 0;
+}
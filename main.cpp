@@ -1,7 +1,19 @@
-#include ".\Lexer.h"
-#include ".\Parser.h"
+#include "Lexer.h"
+#include "Parser.h"
 
-#include ".\CodeGen.h"
+#include "CodeGen.h"
+#include "Assembler.h"
+#include "Jit.h"
+#include "Bytecode.h"
+#include "VM.h"
+#include "FunctionCache.h"
+#include "Driver.h"
+#include "Compiler.h"
+#include "Batch.h"
+#include "Server.h"
+#include "Stats.h"
+#include "PassManager.h"
+#include <cstdlib>
 #include <fstream>
 
 
@@ -26,16 +38,179 @@ void testParser(const std::string& sourceCode) {
     std::cout << "=====================" << std::endl << std::endl;
 }
 
+// -c 时默认的目标文件路径：源文件名换成.o
+static std::string defaultObjectPath(const std::string& sourcePath) {
+    std::string outputPath = sourcePath;
+    size_t slash = outputPath.find_last_of("/\\");
+    size_t dot = outputPath.find_last_of('.');
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+        outputPath.erase(dot);
+    }
+    return outputPath + ".o";
+}
 
 int main(int argc, char* argv[]) {
-     if (argc < 2) {
-         std::cerr << "Usage: " << argv[0] << " <source_file>" << std::endl;
+     DriverOptions options;
+     bool inlineReport = false;    // --inline-report: 向stderr输出内联决策
+     bool passReport = false;      // --pass-report: 向stderr输出每个优化遍的耗时和改动
+     bool runInProcess = false;    // --run: 在内存中编码为x86-64代码并直接执行main
+     bool runVm = false;           // --vm: 编译为字节码并解释执行，不生成x86代码
+     bool dumpBytecode = false;    // --dump-bytecode: 输出字节码反汇编
+     std::string outputPath;       // -o: 目标文件路径（默认为源文件名换成.o）
+     std::string cacheDir;         // --cache-dir=DIR: 按函数缓存生成的汇编，未修改的函数直接复用
+     bool cacheStats = false;      // --cache-stats: 向stderr输出缓存命中次数
+     std::string outputDir;        // --out-dir=DIR: 批量编译，每个输入输出到DIR中
+     unsigned jobs = 0;            // -jN: 批量编译（单个文件时为词法分析）的线程数（默认为硬件线程数）
+     std::string serverSocket;     // --server=SOCKET: 作为常驻编译服务器运行
+     std::string connectSocket;    // --connect=SOCKET: 把编译请求发给服务器
+     bool shutdownServer = false;  // --shutdown-server: 与--connect一起使用，让服务器退出
+     std::vector<std::string> forwarded; // 转发给服务器的编译选项
+     bool stats = false;           // --stats[=json]: 向stderr输出各阶段耗时、内存和计数
+     bool statsJson = false;
+     std::vector<std::string> sources;
+     for (int i = 1; i < argc; ++i) {
+         std::string arg = argv[i];
+         if (parseDriverOption(arg, options)) {
+             forwarded.push_back(arg);
+         } else if (arg == "--inline-report") {
+             PassManager::addPass(options.passes, "inline");
+             inlineReport = true;
+         } else if (arg == "--pass-report") {
+             passReport = true;
+         } else if (arg == "--run") {
+             runInProcess = true;
+         } else if (arg == "--vm") {
+             runVm = true;
+         } else if (arg == "--dump-bytecode") {
+             dumpBytecode = true;
+         } else if (arg.compare(0, 12, "--cache-dir=") == 0) {
+             cacheDir = arg.substr(12);
+         } else if (arg == "--cache-stats") {
+             cacheStats = true;
+         } else if (arg.compare(0, 10, "--out-dir=") == 0) {
+             outputDir = arg.substr(10);
+         } else if (arg.compare(0, 2, "-j") == 0 && arg.size() > 2) {
+             jobs = static_cast<unsigned>(std::max(0, std::atoi(arg.c_str() + 2)));
+         } else if (arg.compare(0, 9, "--server=") == 0) {
+             serverSocket = arg.substr(9);
+         } else if (arg.compare(0, 10, "--connect=") == 0) {
+             connectSocket = arg.substr(10);
+         } else if (arg == "--stats") {
+             stats = true;
+         } else if (arg == "--stats=json") {
+             stats = true;
+             statsJson = true;
+         } else if (arg == "--shutdown-server") {
+             shutdownServer = true;
+         } else if (arg == "-o" && i + 1 < argc) {
+             outputPath = argv[++i];
+         } else {
+             sources.push_back(arg);
+         }
+     }
+
+     if (!serverSocket.empty()) {
+         try {
+             CompileServer server(serverSocket, cacheDir, jobs);
+             server.run();
+             if (cacheStats) {
+                 std::cerr << "cache: " << server.cache().hits() << " hits, " << server.cache().misses() << " misses" << std::endl;
+             }
+         } catch (const std::runtime_error& e) {
+             std::cerr << "Error: " << e.what() << std::endl;
+             return 1;
+         }
+         return 0;
+     }
+     if (!connectSocket.empty() && shutdownServer) {
+         try {
+             requestShutdown(connectSocket);
+         } catch (const std::runtime_error& e) {
+             std::cerr << "Error: " << e.what() << std::endl;
+             return 1;
+         }
+         return 0;
+     }
+
+     bool batch = !outputDir.empty();
+     // 服务器只生成汇编或目标文件，不能代为执行
+     bool remoteRun = !connectSocket.empty() && (runVm || dumpBytecode || runInProcess);
+     if (sources.empty() || (!batch && sources.size() > 1) || remoteRun) {
+         std::cerr << "Usage: " << argv[0] << " [-O0|-O1|-O2|-Os] [--passes=LIST] [--inline] [--inline-report] [--tail-calls] [--memoize] [--verify-passes] [--pass-report] [--regcall[=N]] [--target=i386|x86-64] [-c [-o out.o]] [--run] [--fast-print] [--vm] [--dump-bytecode] [--cache-dir=DIR] [--cache-stats] [--stats[=json]] [--stream] [--pipeline] [--profile-generate[=FILE]] [--profile-use[=FILE]] <source_file>" << std::endl;
+         std::cerr << "       " << argv[0] << " [options] --out-dir=DIR [-jN] <source_file|@listfile>..." << std::endl;
+         std::cerr << "       " << argv[0] << " --server=SOCKET [--cache-dir=DIR] [-jN]" << std::endl;
+         std::cerr << "       " << argv[0] << " --connect=SOCKET [options] [-o out] <source_file> | --connect=SOCKET --shutdown-server" << std::endl;
          return 1;
      }
+     if (inlineReport) {
+         options.inlineReport = &std::cerr;
+     }
+     if (passReport) {
+         options.passReport = &std::cerr;
+     }
+     try {
+         PassManager::checkNames(options.passes);
+         if (!options.profileUse.empty()) {
+             options.profile = Profile::load(options.profileUse);
+         }
+     } catch (const std::runtime_error& e) {
+         std::cerr << "Error: " << e.what() << std::endl;
+         return 1;
+     }
+
+     CompileStats compileStats;
+     if (stats) {
+         options.stats = &compileStats;
+     }
+     auto printStats = [&]() {
+         if (!stats) return;
+         if (statsJson) {
+             compileStats.printJson(std::cerr, peakResidentKb());
+         } else {
+             compileStats.printText(std::cerr, peakResidentKb());
+         }
+     };
+
+     std::unique_ptr<FunctionCache> cache;
+     if (!cacheDir.empty()) {
+         cache.reset(new FunctionCache(cacheDir));
+         options.cache = cache.get();
+     }
 
-     std::ifstream inputFile(argv[1]);
+     if (batch) {
+         std::vector<BatchResult> results;
+         try {
+             results = compileBatch(expandInputs(sources), outputDir, options, jobs);
+         } catch (const std::runtime_error& e) {
+             std::cerr << "Error: " << e.what() << std::endl;
+             return 1;
+         }
+         // 按输入顺序报告，输出与线程调度无关
+         int failed = 0;
+         for (const auto& result : results) {
+             std::cerr << result.report;
+             compileStats.merge(result.stats);
+             if (!result.ok) {
+                 for (const auto& diagnostic : result.diagnostics) {
+                     std::cerr << formatDiagnostic(result.input, diagnostic) << std::endl;
+                 }
+                 failed++;
+             }
+         }
+         if (cache && cacheStats) {
+             std::cerr << "cache: " << cache->hits() << " hits, " << cache->misses() << " misses" << std::endl;
+         }
+         printStats();
+         return failed == 0 ? 0 : 1;
+     }
+
+     // 单个文件时-jN是词法分析和语法分析的线程数（只有很大的源码才会并行）
+     options.threads = jobs;
+
+     const std::string& sourcePath = sources[0];
+     std::ifstream inputFile(sourcePath);
      if (!inputFile.is_open()) {
-         std::cerr << "Error: Could not open file " << argv[1] << std::endl;
+         std::cerr << "Error: Could not open file " << sourcePath << std::endl;
          return 1;
      }
 
@@ -44,6 +219,34 @@ int main(int argc, char* argv[]) {
          std::istreambuf_iterator<char>()
      );
 
+     // 生成的汇编文本或目标文件
+     std::string output;
+     if (!connectSocket.empty()) {
+         try {
+             if (!requestCompile(connectSocket, forwarded, source, sourcePath, output)) {
+                 std::cerr << output;
+                 return 1;
+             }
+         } catch (const std::runtime_error& e) {
+             std::cerr << "Error: " << e.what() << std::endl;
+             return 1;
+         }
+     } else if (!runVm && !dumpBytecode && !runInProcess) {
+         // --stream时汇编文本直接写到stdout，不在内存中保留整个输出
+         bool direct = options.streaming && !options.emitObject;
+         CompileResult result = direct ? compile(source, options, std::cout) : compile(source, options);
+         if (cache && cacheStats) {
+             std::cerr << "cache: " << cache->hits() << " hits, " << cache->misses() << " misses" << std::endl;
+         }
+         printStats();
+         if (!result.ok) {
+             for (const auto& diagnostic : result.diagnostics) {
+                 std::cerr << formatDiagnostic(sourcePath, diagnostic) << std::endl;
+             }
+             return 1;
+         }
+         output = std::move(result.output);
+     } else {
 //    std::string source = "int main() {\
 //    int a = 5, b = 3;\
 //    if (a <= b) {\
@@ -54,16 +257,71 @@ int main(int argc, char* argv[]) {
     return 0;\
 }";
 
-    Lexer lexer(source);
-    std::vector<Token> tokens = lexer.tokenize();
+        // 编译中的错误与compile()一样按诊断信息输出；运行中的错误（字节码解释器中除以0等）输出Error
+        bool running = false;
+        try {
+            TokenStream tokens = lexSource(source, options);
 
 //    testParser(source);
-	
-    Parser parser(tokens);
-    auto codeGenerator = CodeGen(parser.parse());
-    codeGenerator.generateCode();
-    
-    return 0;
-}
 
+            auto program = parseProgram(tokens, options);
+
+            if (runVm || dumpBytecode) {
+                BytecodeProgram bytecode;
+                {
+                    PhaseTimer timer(options.stats, "bytecode");
+                    bytecode = BytecodeCompiler().compile(*program);
+                }
+                printStats();
+                if (dumpBytecode) {
+                    bytecode.disassemble(std::cout);
+                    return 0;
+                }
+                running = true;
+                return VM(bytecode).run();
+            }
 
+            // --run 时汇编代码逐行交给内置汇编器，在内存中执行
+            options.targetX64 = true;
+            Assembler assembler(true);
+            CodeGenOptions codeGenOptions = options.codeGen;
+            codeGenOptions.assembler = &assembler;
+            generateProgram(std::move(program), tokens, options, codeGenOptions);
+            {
+                PhaseTimer timer(options.stats, "jit");
+                assembler.finish();
+            }
+            JitProgram jit(assembler);
+            printStats();
+            running = true;
+            return jit.run();
+        } catch (const SyntaxError& e) {
+            std::cerr << formatDiagnostic(sourcePath, diagnosticAt(source, e.what(), e.offset)) << std::endl;
+            return 1;
+        } catch (const std::exception& e) {
+            if (running) {
+                std::cerr << "Error: " << e.what() << std::endl;
+            } else {
+                Diagnostic diagnostic;
+                diagnostic.message = e.what();
+                std::cerr << formatDiagnostic(sourcePath, diagnostic) << std::endl;
+            }
+            return 1;
+        }
+    }
+
+    if (!options.emitObject) {
+        std::cout << output;
+        return 0;
+    }
+    if (outputPath.empty()) {
+        outputPath = defaultObjectPath(sourcePath);
+    }
+    std::ofstream objectFile(outputPath, std::ios::binary);
+    if (!objectFile.is_open()) {
+        std::cerr << "Error: Could not open file " << outputPath << std::endl;
+        return 1;
+    }
+    objectFile << output;
+    return 0;
+}